@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_ADAM7_HPP_INCLUDED
+#define PNGPP_ADAM7_HPP_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+
+#include "types.hpp"
+#include "image.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief Geometry of the Adam7 interlacing scheme.
+     *
+     * Pass \c k of an interlaced %image carries the pixels at
+     * <tt>(get_x_start(k) + i * get_x_step(k), get_y_start(k) + j *
+     * get_y_step(k))</tt>.  After passes \c 0 to \c k were read, the
+     * pixels known form a grid of get_block_width(k) by
+     * get_block_height(k) blocks: the top left pixel of every block
+     * is known.
+     *
+     * \see image::read_stream(), consumer
+     */
+    class adam7
+    {
+    public:
+        enum { pass_count = 7 };
+
+        static uint_32 get_x_start(size_t pass)
+        {
+            static uint_32 const starts[pass_count] = { 0, 4, 0, 2, 0, 1, 0 };
+            assert(pass < pass_count);
+            return starts[pass];
+        }
+
+        static uint_32 get_y_start(size_t pass)
+        {
+            static uint_32 const starts[pass_count] = { 0, 0, 4, 0, 2, 0, 1 };
+            assert(pass < pass_count);
+            return starts[pass];
+        }
+
+        static uint_32 get_x_step(size_t pass)
+        {
+            static uint_32 const steps[pass_count] = { 8, 8, 4, 4, 2, 2, 1 };
+            assert(pass < pass_count);
+            return steps[pass];
+        }
+
+        static uint_32 get_y_step(size_t pass)
+        {
+            static uint_32 const steps[pass_count] = { 8, 8, 8, 4, 4, 2, 2 };
+            assert(pass < pass_count);
+            return steps[pass];
+        }
+
+        /**
+         * \brief Returns the number of columns in \a pass of an
+         * %image \a width pixels wide.
+         */
+        static uint_32 get_pass_width(uint_32 width, size_t pass)
+        {
+            uint_32 start = get_x_start(pass);
+            uint_32 step = get_x_step(pass);
+            return width > start ? (width - start + step - 1) / step : 0;
+        }
+
+        /**
+         * \brief Returns the number of rows in \a pass of an %image
+         * \a height pixels high.
+         */
+        static uint_32 get_pass_height(uint_32 height, size_t pass)
+        {
+            uint_32 start = get_y_start(pass);
+            uint_32 step = get_y_step(pass);
+            return height > start ? (height - start + step - 1) / step : 0;
+        }
+
+        /**
+         * \brief Returns the width of the blocks known after passes
+         * \c 0 to \a pass.
+         */
+        static uint_32 get_block_width(size_t pass)
+        {
+            static uint_32 const widths[pass_count] = { 8, 4, 4, 2, 2, 1, 1 };
+            assert(pass < pass_count);
+            return widths[pass];
+        }
+
+        /**
+         * \brief Returns the height of the blocks known after passes
+         * \c 0 to \a pass.
+         */
+        static uint_32 get_block_height(size_t pass)
+        {
+            static uint_32 const heights[pass_count] = { 8, 8, 4, 4, 2, 2, 1 };
+            assert(pass < pass_count);
+            return heights[pass];
+        }
+
+        /**
+         * \brief Fills \a preview with a nearest-neighbour rendition
+         * of the partially read interlaced %image \a src.
+         *
+         * Every block of the grid known after passes \c 0 to \a pass
+         * is filled with its top left pixel.  The \a preview is
+         * resized to the size of \a src.  A non-interlaced \a src is
+         * copied as it is.
+         */
+        template< typename pixel, class src_pixbuf, class dst_pixbuf >
+        static void fill_preview(image< pixel, src_pixbuf > const& src,
+                                 size_t pass,
+                                 image< pixel, dst_pixbuf >& preview)
+        {
+            size_t width = src.get_width();
+            size_t height = src.get_height();
+            preview.resize(src.get_width(), src.get_height());
+
+            // block sizes are powers of 2
+            size_t x_mask = ~size_t(0);
+            size_t y_mask = ~size_t(0);
+            if (src.get_interlace_type() != interlace_none)
+            {
+                x_mask = ~size_t(get_block_width(pass) - 1);
+                y_mask = ~size_t(get_block_height(pass) - 1);
+            }
+            for (size_t y = 0; y < height; ++y)
+            {
+                typename image< pixel, src_pixbuf >::row_const_access
+                    src_row = src[y & y_mask];
+                typename image< pixel, dst_pixbuf >::row_access
+                    dst_row = preview[y];
+                for (size_t x = 0; x < width; ++x)
+                {
+                    dst_row[x] = pixel(src_row[x & x_mask]);
+                }
+            }
+        }
+    };
+
+} // namespace png
+
+#endif // PNGPP_ADAM7_HPP_INCLUDED
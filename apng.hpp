@@ -0,0 +1,1158 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_APNG_HPP_INCLUDED
+#define PNGPP_APNG_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "types.hpp"
+#include "error.hpp"
+#include "pixel_traits.hpp"
+#include "read_options.hpp"
+#include "write_options.hpp"
+#include "image.hpp"
+#include "metadata.hpp"
+#include "memory_stream.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <thread>
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief What to do with the area of an APNG frame before the
+     * next frame is rendered.
+     */
+    enum apng_dispose_op
+    {
+        apng_dispose_none       = 0,
+        apng_dispose_background = 1,
+        apng_dispose_previous   = 2
+    };
+
+    /**
+     * \brief How an APNG frame is combined with the canvas.
+     */
+    enum apng_blend_op
+    {
+        apng_blend_source = 0,
+        apng_blend_over   = 1
+    };
+
+    /**
+     * \brief Frame control (fcTL) of an APNG frame: its area on the
+     * canvas, its delay and its dispose and blend operations.
+     */
+    class apng_frame
+    {
+    public:
+        apng_frame()
+            : m_width(0),
+              m_height(0),
+              m_x_offset(0),
+              m_y_offset(0),
+              m_delay_num(0),
+              m_delay_den(0),
+              m_dispose_op(apng_dispose_none),
+              m_blend_op(apng_blend_source)
+        {
+        }
+
+        uint_32 get_width() const
+        {
+            return m_width;
+        }
+
+        void set_width(uint_32 width)
+        {
+            m_width = width;
+        }
+
+        uint_32 get_height() const
+        {
+            return m_height;
+        }
+
+        void set_height(uint_32 height)
+        {
+            m_height = height;
+        }
+
+        uint_32 get_x_offset() const
+        {
+            return m_x_offset;
+        }
+
+        void set_x_offset(uint_32 x_offset)
+        {
+            m_x_offset = x_offset;
+        }
+
+        uint_32 get_y_offset() const
+        {
+            return m_y_offset;
+        }
+
+        void set_y_offset(uint_32 y_offset)
+        {
+            m_y_offset = y_offset;
+        }
+
+        /**
+         * \brief Returns the numerator of the frame delay in seconds.
+         */
+        uint_16 get_delay_num() const
+        {
+            return m_delay_num;
+        }
+
+        /**
+         * \brief Returns the denominator of the frame delay in
+         * seconds; 0 stands for 100.
+         */
+        uint_16 get_delay_den() const
+        {
+            return m_delay_den;
+        }
+
+        void set_delay(uint_16 num, uint_16 den)
+        {
+            m_delay_num = num;
+            m_delay_den = den;
+        }
+
+        apng_dispose_op get_dispose_op() const
+        {
+            return m_dispose_op;
+        }
+
+        void set_dispose_op(apng_dispose_op op)
+        {
+            m_dispose_op = op;
+        }
+
+        apng_blend_op get_blend_op() const
+        {
+            return m_blend_op;
+        }
+
+        void set_blend_op(apng_blend_op op)
+        {
+            m_blend_op = op;
+        }
+
+    private:
+        uint_32 m_width;
+        uint_32 m_height;
+        uint_32 m_x_offset;
+        uint_32 m_y_offset;
+        uint_16 m_delay_num;
+        uint_16 m_delay_den;
+        apng_dispose_op m_dispose_op;
+        apng_blend_op m_blend_op;
+    };
+
+    namespace detail
+    {
+
+        /**
+         * \brief The CRC-32 table of the PNG specification.
+         */
+        template< typename T >
+        struct crc_table
+        {
+            static uint_32 const values[256];
+        };
+
+        template< typename T >
+        uint_32 const crc_table< T >::values[256] =
+        {
+            0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419,
+            0x706af48f, 0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4,
+            0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07,
+            0x90bf1d91, 0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de,
+            0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7, 0x136c9856,
+            0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+            0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4,
+            0xa2677172, 0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
+            0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940, 0x32d86ce3,
+            0x45df5c75, 0xdcd60dcf, 0xabd13d59, 0x26d930ac, 0x51de003a,
+            0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423, 0xcfba9599,
+            0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+            0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190,
+            0x01db7106, 0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f,
+            0x9fbfe4a5, 0xe8b8d433, 0x7807c9a2, 0x0f00f934, 0x9609a88e,
+            0xe10e9818, 0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
+            0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e, 0x6c0695ed,
+            0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+            0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3,
+            0xfbd44c65, 0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2,
+            0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a,
+            0x346ed9fc, 0xad678846, 0xda60b8d0, 0x44042d73, 0x33031de5,
+            0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa, 0xbe0b1010,
+            0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+            0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17,
+            0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6,
+            0x03b6e20c, 0x74b1d29a, 0xead54739, 0x9dd277af, 0x04db2615,
+            0x73dc1683, 0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8,
+            0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1, 0xf00f9344,
+            0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+            0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a,
+            0x67dd4acc, 0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
+            0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252, 0xd1bb67f1,
+            0xa6bc5767, 0x3fb506dd, 0x48b2364b, 0xd80d2bda, 0xaf0a1b4c,
+            0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55, 0x316e8eef,
+            0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+            0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe,
+            0xb2bd0b28, 0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31,
+            0x2cd99e8b, 0x5bdeae1d, 0x9b64c2b0, 0xec63f226, 0x756aa39c,
+            0x026d930a, 0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
+            0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38, 0x92d28e9b,
+            0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+            0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1,
+            0x18b74777, 0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c,
+            0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45, 0xa00ae278,
+            0xd70dd2ee, 0x4e048354, 0x3903b3c2, 0xa7672661, 0xd06016f7,
+            0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc, 0x40df0b66,
+            0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+            0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605,
+            0xcdd70693, 0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8,
+            0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b,
+            0x2d02ef8d
+        };
+
+        inline uint_32 update_crc(uint_32 crc, byte const* data, size_t size)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                crc = crc_table< void >::values[(crc ^ data[i]) & 0xff]
+                    ^ (crc >> 8);
+            }
+            return crc;
+        }
+
+        inline void put_uint_32(byte* p, uint_32 value)
+        {
+            p[0] = byte(value >> 24);
+            p[1] = byte(value >> 16);
+            p[2] = byte(value >> 8);
+            p[3] = byte(value);
+        }
+
+        inline void append_uint_32(std::vector< byte >& out, uint_32 value)
+        {
+            byte bytes[4];
+            put_uint_32(bytes, value);
+            out.insert(out.end(), bytes, bytes + 4);
+        }
+
+        /**
+         * \brief Appends a complete chunk to \a out.
+         */
+        inline void append_chunk(std::vector< byte >& out, char const* type,
+                                 byte const* data, size_t size)
+        {
+            append_uint_32(out, uint_32(size));
+            size_t start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data, data + size);
+            append_uint_32(out, update_crc(0xffffffff, & out[start], size + 4)
+                           ^ 0xffffffff);
+        }
+
+        /**
+         * \brief Combines a pixel with the canvas as APNG_BLEND_OP_OVER
+         * does; pixels without alpha replace the canvas.
+         */
+        template< typename pixel >
+        void blend_over(pixel& dst, pixel const& src)
+        {
+            typedef pixel_traits< pixel > traits;
+            typedef typename traits::component_type component;
+            if (!(traits::get_color_type() & color_mask_alpha))
+            {
+                dst = src;
+                return;
+            }
+
+            size_t const alpha = traits::channels - 1;
+            component const* s = reinterpret_cast< component const* >(& src);
+            component* d = reinterpret_cast< component* >(& dst);
+            double const max = traits::bit_depth == 16 ? 65535.0 : 255.0;
+            if (s[alpha] == max)
+            {
+                dst = src;
+                return;
+            }
+            if (s[alpha] == 0)
+            {
+                return;
+            }
+
+            double sa = s[alpha] / max;
+            double da = d[alpha] / max * (1 - sa);
+            double out_alpha = sa + da;
+            for (size_t i = 0; i < alpha; ++i)
+            {
+                d[i] = component((s[i] * sa + d[i] * da) / out_alpha + 0.5);
+            }
+            d[alpha] = component(out_alpha * max + 0.5);
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief The base class template for reading animated PNG (APNG)
+     * images frame by frame.
+     *
+     * Each frame is decoded as soon as its data has arrived and
+     * composed onto a canvas %image following its dispose and blend
+     * operations; then the derived class is called:
+     *
+     * \code
+     * void frame_ready(png::image< pixel > const& canvas,
+     *                  png::apng_frame const& frame, size_t index);
+     * \endcode
+     *
+     * The canvas and the frame buffers are reused for all frames, so
+     * memory use does not depend on the number of frames.  The
+     * derived class may also define
+     *
+     * \code
+     * void start_animation(png::uint_32 width, png::uint_32 height,
+     *                      size_t frame_count, size_t play_count);
+     * \endcode
+     *
+     * which is called before the first frame.  A PNG without an acTL
+     * chunk is read as a single frame animation.
+     *
+     * Frames are decoded by libpng from the stream's own zlib data;
+     * the chunk CRCs are checked on the fly unless read_options says
+     * to trust them.  The zlib Adler-32 checksum of each frame is
+     * verified by libpng, again unless read_options says otherwise.
+     *
+     * \see apng_generator
+     */
+    template< typename pixel, class pixcon >
+    class apng_consumer
+    {
+    public:
+        typedef image< pixel > image_type;
+
+        /**
+         * \brief Reads the animation from the stream.
+         */
+        template< typename istream >
+        void read(istream& stream)
+        {
+            read(stream, read_options());
+        }
+
+        /**
+         * \brief Reads the animation from the stream using custom
+         * read options.
+         */
+        template< typename istream >
+        void read(istream& stream, read_options const& options)
+        {
+            byte header[8];
+            read_bytes(stream, header, 8);
+            detail::check_signature(header);
+
+            m_trust_checksums = options.get_trust_checksums();
+            m_frame_options = options;
+            m_frame_options.set_trust_chunk_crcs(true);
+            m_ihdr.clear();
+            m_header.clear();
+            m_animated = false;
+            m_seen_image = false;
+            m_has_control = false;
+            m_in_frame = false;
+            m_next_sequence = 0;
+            m_frame_index = 0;
+
+            pixcon* pixel_con = static_cast< pixcon* >(this);
+            for (;;)
+            {
+                read_bytes(stream, header, 8);
+                uint_32 length = detail::read_uint_32(header);
+                if (length > 0x7fffffff)
+                {
+                    throw error("invalid chunk length");
+                }
+                m_crc = detail::update_crc(0xffffffff, header + 4, 4);
+                byte const* type = header + 4;
+
+                if (std::memcmp(type, "IDAT", 4) == 0)
+                {
+                    if (!m_seen_image)
+                    {
+                        start_image(pixel_con);
+                    }
+                    if (m_has_control)
+                    {
+                        append_frame_data(stream, length);
+                    }
+                    else
+                    {
+                        read_payload(stream, length, m_chunk);
+                    }
+                }
+                else if (std::memcmp(type, "fdAT", 4) == 0)
+                {
+                    if (!m_seen_image || !m_has_control || length < 4)
+                    {
+                        throw error("unexpected fdAT chunk");
+                    }
+                    byte sequence[4];
+                    read_bytes(stream, sequence, 4);
+                    m_crc = detail::update_crc(m_crc, sequence, 4);
+                    check_sequence(detail::read_uint_32(sequence));
+                    append_frame_data(stream, length - 4);
+                }
+                else
+                {
+                    read_payload(stream, length, m_chunk);
+                    byte const* data = m_chunk.empty() ? 0 : & m_chunk[0];
+                    if (std::memcmp(type, "IEND", 4) == 0)
+                    {
+                        if (!m_seen_image)
+                        {
+                            throw error("no image data");
+                        }
+                        finish_frame(pixel_con);
+                        return;
+                    }
+                    else if (std::memcmp(type, "IHDR", 4) == 0)
+                    {
+                        if (length != 13 || !m_ihdr.empty())
+                        {
+                            throw error("invalid IHDR chunk");
+                        }
+                        m_ihdr = m_chunk;
+                    }
+                    else if (std::memcmp(type, "acTL", 4) == 0)
+                    {
+                        if (length != 8 || m_seen_image)
+                        {
+                            throw error("invalid acTL chunk");
+                        }
+                        m_animated = true;
+                        m_frame_count = detail::read_uint_32(data);
+                        m_play_count = detail::read_uint_32(data + 4);
+                    }
+                    else if (std::memcmp(type, "fcTL", 4) == 0)
+                    {
+                        if (length != 26)
+                        {
+                            throw error("invalid fcTL chunk");
+                        }
+                        finish_frame(pixel_con);
+                        check_sequence(detail::read_uint_32(data));
+                        read_control(data + 4);
+                    }
+                    else if (!m_seen_image)
+                    {
+                        // PLTE, tRNS and the like apply to every frame
+                        m_header.insert(m_header.end(), header, header + 8);
+                        m_header.insert(m_header.end(),
+                                        m_chunk.begin(), m_chunk.end());
+                        detail::append_uint_32(m_header, m_crc ^ 0xffffffff);
+                    }
+                }
+            }
+        }
+
+        /**
+         * \brief Returns the number of frames as declared by the acTL
+         * chunk.
+         */
+        size_t get_frame_count() const
+        {
+            return m_frame_count;
+        }
+
+        /**
+         * \brief Returns the number of times to play the animation;
+         * 0 means forever.
+         */
+        size_t get_play_count() const
+        {
+            return m_play_count;
+        }
+
+        image_type const& get_canvas() const
+        {
+            return m_canvas;
+        }
+
+        void start_animation(uint_32 /*width*/, uint_32 /*height*/,
+                             size_t /*frame_count*/, size_t /*play_count*/)
+        {
+        }
+
+    protected:
+        apng_consumer()
+            : m_frame_count(0),
+              m_play_count(0),
+              m_trust_checksums(false),
+              m_animated(false),
+              m_seen_image(false),
+              m_has_control(false),
+              m_in_frame(false),
+              m_next_sequence(0),
+              m_frame_index(0),
+              m_length_pos(0),
+              m_crc(0)
+        {
+        }
+
+    private:
+        template< typename istream >
+        static void read_bytes(istream& stream, byte* bytes, size_t count)
+        {
+            stream.read(reinterpret_cast< char* >(bytes), count);
+            if (size_t(stream.gcount()) != count)
+            {
+                throw error("truncated chunk");
+            }
+        }
+
+        /**
+         * \brief Reads the rest of a chunk: \a length bytes of
+         * payload appended to \a out, then the CRC.
+         */
+        template< typename istream >
+        void read_payload(istream& stream, uint_32 length,
+                          std::vector< byte >& out, bool append = false)
+        {
+            size_t start = append ? out.size() : 0;
+            out.resize(start + length);
+            if (length != 0)
+            {
+                read_bytes(stream, & out[start], length);
+                m_crc = detail::update_crc(m_crc, & out[start], length);
+            }
+            byte crc[4];
+            read_bytes(stream, crc, 4);
+            if (!m_trust_checksums
+                && detail::read_uint_32(crc) != (m_crc ^ 0xffffffff))
+            {
+                throw error("CRC error");
+            }
+        }
+
+        void check_sequence(uint_32 sequence)
+        {
+            if (sequence != m_next_sequence)
+            {
+                throw error("APNG sequence number out of order");
+            }
+            ++m_next_sequence;
+        }
+
+        void read_control(byte const* data)
+        {
+            apng_frame& control = m_control;
+            control.set_width(detail::read_uint_32(data));
+            control.set_height(detail::read_uint_32(data + 4));
+            control.set_x_offset(detail::read_uint_32(data + 8));
+            control.set_y_offset(detail::read_uint_32(data + 12));
+            control.set_delay(uint_16((data[16] << 8) | data[17]),
+                              uint_16((data[18] << 8) | data[19]));
+            if (data[20] > apng_dispose_previous
+                || data[21] > apng_blend_over)
+            {
+                throw error("invalid fcTL chunk");
+            }
+            control.set_dispose_op(apng_dispose_op(data[20]));
+            control.set_blend_op(apng_blend_op(data[21]));
+
+            if (m_ihdr.empty()
+                || control.get_width() == 0 || control.get_height() == 0
+                || control.get_x_offset() > get_width()
+                || control.get_width() > get_width() - control.get_x_offset()
+                || control.get_y_offset() > get_height()
+                || control.get_height()
+                   > get_height() - control.get_y_offset())
+            {
+                throw error("APNG frame outside of the canvas");
+            }
+            m_has_control = true;
+        }
+
+        uint_32 get_width() const
+        {
+            return detail::read_uint_32(& m_ihdr[0]);
+        }
+
+        uint_32 get_height() const
+        {
+            return detail::read_uint_32(& m_ihdr[4]);
+        }
+
+        void start_image(pixcon* pixel_con)
+        {
+            if (m_ihdr.empty())
+            {
+                throw error("missing IHDR chunk");
+            }
+            m_seen_image = true;
+            if (!m_animated)
+            {
+                m_frame_count = 1;
+                m_play_count = 0;
+                m_control = apng_frame();
+                m_control.set_width(get_width());
+                m_control.set_height(get_height());
+                m_has_control = true;
+            }
+            m_canvas.resize(get_width(), get_height());
+            fill(0, 0, get_width(), get_height(), pixel());
+            pixel_con->start_animation(get_width(), get_height(),
+                                       m_frame_count, m_play_count);
+        }
+
+        /**
+         * \brief Appends frame data to a standalone PNG made of the
+         * header chunks and a single IDAT chunk, which libpng then
+         * decodes without knowing about APNG.
+         */
+        template< typename istream >
+        void append_frame_data(istream& stream, uint_32 length)
+        {
+            if (!m_in_frame)
+            {
+                static byte const signature[8] =
+                    { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+                byte ihdr[13];
+                std::copy(m_ihdr.begin(), m_ihdr.end(), ihdr);
+                detail::put_uint_32(ihdr, m_control.get_width());
+                detail::put_uint_32(ihdr + 4, m_control.get_height());
+
+                m_buffer.assign(signature, signature + 8);
+                detail::append_chunk(m_buffer, "IHDR", ihdr, 13);
+                m_buffer.insert(m_buffer.end(),
+                                m_header.begin(), m_header.end());
+                m_length_pos = m_buffer.size();
+                detail::append_uint_32(m_buffer, 0);
+                m_buffer.insert(m_buffer.end(), "IDAT", "IDAT" + 4);
+                m_in_frame = true;
+            }
+            read_payload(stream, length, m_buffer, true);
+        }
+
+        void finish_frame(pixcon* pixel_con)
+        {
+            if (!m_in_frame)
+            {
+                return;
+            }
+            m_in_frame = false;
+            m_has_control = false;
+
+            size_t data_size = m_buffer.size() - m_length_pos - 8;
+            if (data_size > 0x7fffffff)
+            {
+                throw error("APNG frame too large");
+            }
+            detail::put_uint_32(& m_buffer[m_length_pos], uint_32(data_size));
+            // the frame data was checked against the CRCs of its own
+            // chunks, so libpng is told to trust the CRC of this one
+            // (but not the Adler-32 checksum of the zlib stream)
+            detail::append_uint_32(m_buffer, 0);
+            detail::append_chunk(m_buffer, "IEND", 0, 0);
+
+            detail::memory_streambuf buffer(& m_buffer[0], m_buffer.size());
+            std::istream stream(& buffer);
+            m_frame.read(stream, m_frame_options);
+
+            compose();
+            pixel_con->frame_ready(m_canvas, m_control, m_frame_index);
+            ++m_frame_index;
+        }
+
+        void fill(uint_32 x0, uint_32 y0, uint_32 width, uint_32 height,
+                  pixel const& value)
+        {
+            for (uint_32 y = y0; y < y0 + height; ++y)
+            {
+                typename image_type::row_access row = m_canvas[y];
+                std::fill(row.begin() + x0, row.begin() + x0 + width, value);
+            }
+        }
+
+        /**
+         * \brief Disposes of the previous frame and renders the
+         * current one onto the canvas.
+         */
+        void compose()
+        {
+            apng_frame const& previous = m_previous;
+            if (m_frame_index != 0)
+            {
+                if (previous.get_dispose_op() == apng_dispose_background)
+                {
+                    fill(previous.get_x_offset(), previous.get_y_offset(),
+                         previous.get_width(), previous.get_height(), pixel());
+                }
+                else if (previous.get_dispose_op() == apng_dispose_previous)
+                {
+                    for (uint_32 y = 0; y < previous.get_height(); ++y)
+                    {
+                        std::copy(m_saved[y].begin(), m_saved[y].end(),
+                                  m_canvas[previous.get_y_offset() + y].begin()
+                                  + previous.get_x_offset());
+                    }
+                }
+            }
+
+            m_previous = m_control;
+            uint_32 const x0 = m_control.get_x_offset();
+            uint_32 const y0 = m_control.get_y_offset();
+            if (m_control.get_dispose_op() == apng_dispose_previous)
+            {
+                if (m_frame_index == 0)
+                {
+                    m_previous.set_dispose_op(apng_dispose_background);
+                }
+                else
+                {
+                    m_saved.resize(m_control.get_width(),
+                                   m_control.get_height());
+                    for (uint_32 y = 0; y < m_control.get_height(); ++y)
+                    {
+                        typename image_type::row_access row = m_canvas[y0 + y];
+                        std::copy(row.begin() + x0,
+                                  row.begin() + x0 + m_control.get_width(),
+                                  m_saved[y].begin());
+                    }
+                }
+            }
+
+            bool const over = m_control.get_blend_op() == apng_blend_over;
+            for (uint_32 y = 0; y < m_control.get_height(); ++y)
+            {
+                typename image_type::row_const_access src = m_frame[y];
+                typename image_type::row_access dst = m_canvas[y0 + y];
+                for (uint_32 x = 0; x < m_control.get_width(); ++x)
+                {
+                    if (over)
+                    {
+                        detail::blend_over(dst[x0 + x], src[x]);
+                    }
+                    else
+                    {
+                        dst[x0 + x] = src[x];
+                    }
+                }
+            }
+        }
+
+        size_t m_frame_count;
+        size_t m_play_count;
+        read_options m_frame_options;
+        bool m_trust_checksums;
+        bool m_animated;
+        bool m_seen_image;
+        bool m_has_control;
+        bool m_in_frame;
+        uint_32 m_next_sequence;
+        size_t m_frame_index;
+        size_t m_length_pos;
+        uint_32 m_crc;
+        std::vector< byte > m_ihdr;
+        std::vector< byte > m_header;
+        std::vector< byte > m_chunk;
+        std::vector< byte > m_buffer;
+        apng_frame m_control;
+        apng_frame m_previous;
+        image_type m_frame;
+        image_type m_saved;
+        image_type m_canvas;
+    };
+
+    /**
+     * \brief The base class template for writing animated PNG (APNG)
+     * images frame by frame.
+     *
+     * The derived class supplies the frames on request:
+     *
+     * \code
+     * void get_frame(size_t index, png::image< pixel >& frame,
+     *                png::apng_frame& control);
+     * \endcode
+     *
+     * The %image passed in is reused between calls and must be
+     * resized to the frame size; the width and height of \a control
+     * are taken from it.  The first frame covers the whole canvas and
+     * doubles as the default %image shown by decoders without APNG
+     * support.
+     *
+     * Every frame is an independent zlib stream, so frames are
+     * compressed in parallel when std::thread is available, a batch
+     * of up to get_thread_count() frames at a time; only that many
+     * frames are held in memory.
+     *
+     * APNG has a single PLTE and tRNS for all the frames, so with an
+     * indexed pixel type every frame must carry the palette and tRNS
+     * of the first one; otherwise std::logic_error is thrown.
+     *
+     * \see apng_consumer
+     */
+    template< typename pixel, class pixgen >
+    class apng_generator
+    {
+    public:
+        typedef image< pixel > image_type;
+
+        /**
+         * \brief Writes the animation to the stream.
+         */
+        template< typename ostream >
+        void write(ostream& stream)
+        {
+            write(stream, write_options());
+        }
+
+        /**
+         * \brief Writes the animation to the stream using custom
+         * compression settings for every frame.
+         */
+        template< typename ostream >
+        void write(ostream& stream, write_options const& options)
+        {
+            if (m_frame_count == 0)
+            {
+                throw std::logic_error("APNG needs at least one frame");
+            }
+            size_t batch = get_thread_count();
+            std::vector< encoder > encoders(std::min(batch, m_frame_count));
+            for (size_t i = 0; i < encoders.size(); ++i)
+            {
+                encoders[i].m_options = options;
+            }
+
+            uint_32 sequence = 0;
+            std::vector< byte > out;
+            palette plte;
+            tRNS trns;
+            pixgen* pixel_gen = static_cast< pixgen* >(this);
+            for (size_t start = 0; start < m_frame_count; start += batch)
+            {
+                size_t count = std::min(batch, m_frame_count - start);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    encoder& enc = encoders[i];
+                    enc.m_control = apng_frame();
+                    pixel_gen->get_frame(start + i, enc.m_image,
+                                         enc.m_control);
+                    enc.m_control.set_width(enc.m_image.get_width());
+                    enc.m_control.set_height(enc.m_image.get_height());
+                    check_frame(start + i, enc.m_control);
+                    if (start + i == 0)
+                    {
+                        plte = enc.m_image.get_palette();
+                        trns = enc.m_image.get_tRNS();
+                    }
+                    else
+                    {
+                        check_palette(enc.m_image, plte, trns);
+                    }
+                }
+                run_encoders(encoders, count);
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    out.clear();
+                    if (start + i == 0)
+                    {
+                        write_header(out, encoders[0].m_output);
+                    }
+                    write_frame(out, encoders[i], sequence, start + i == 0);
+                    stream.write(reinterpret_cast< char const* >(& out[0]),
+                                 out.size());
+                }
+            }
+
+            out.clear();
+            detail::append_chunk(out, "IEND", 0, 0);
+            stream.write(reinterpret_cast< char const* >(& out[0]), out.size());
+            stream.flush();
+        }
+
+        /**
+         * \brief Returns the number of frames compressed at once.
+         */
+        size_t get_thread_count() const
+        {
+#ifdef PNGPP_HAS_STD_THREAD
+            if (m_thread_count == 0)
+            {
+                size_t count = std::thread::hardware_concurrency();
+                return count == 0 ? 1 : count;
+            }
+            return m_thread_count;
+#else
+            return 1;
+#endif
+        }
+
+        /**
+         * \brief Sets the number of frames compressed at once; 0
+         * picks the number of hardware threads.
+         */
+        void set_thread_count(size_t count)
+        {
+            m_thread_count = count;
+        }
+
+    protected:
+        /**
+         * \brief Constructs a generator of an animation of \a
+         * frame_count frames on a canvas of \a width by \a height
+         * pixels, played \a play_count times (0 for forever).
+         */
+        apng_generator(uint_32 width, uint_32 height, size_t frame_count,
+                       size_t play_count = 0)
+            : m_width(width),
+              m_height(height),
+              m_frame_count(frame_count),
+              m_play_count(play_count),
+              m_thread_count(0)
+        {
+        }
+
+    private:
+        /**
+         * \brief Compresses one frame into a standalone PNG.
+         */
+        struct encoder
+        {
+            void run()
+            {
+                try
+                {
+                    std::ostringstream stream;
+                    m_image.write_stream(stream, m_options);
+                    m_output = stream.str();
+                }
+                catch (std::exception const& ex)
+                {
+                    m_error = ex.what();
+                }
+            }
+
+            image_type m_image;
+            apng_frame m_control;
+            write_options m_options;
+            std::string m_output;
+            std::string m_error;
+        };
+
+        static void run_encoders(std::vector< encoder >& encoders,
+                                 size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                encoders[i].m_error.clear();
+            }
+#ifdef PNGPP_HAS_STD_THREAD
+            std::vector< std::thread > threads;
+            for (size_t i = 1; i < count; ++i)
+            {
+                threads.push_back(std::thread(& encoder::run, & encoders[i]));
+            }
+            encoders[0].run();
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+#else
+            for (size_t i = 0; i < count; ++i)
+            {
+                encoders[i].run();
+            }
+#endif
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (!encoders[i].m_error.empty())
+                {
+                    throw error(encoders[i].m_error);
+                }
+            }
+        }
+
+        void check_frame(size_t index, apng_frame const& control) const
+        {
+            if (index == 0
+                && (control.get_width() != m_width
+                    || control.get_height() != m_height
+                    || control.get_x_offset() != 0
+                    || control.get_y_offset() != 0))
+            {
+                throw std::logic_error("the first APNG frame must cover"
+                                       " the whole canvas");
+            }
+            if (control.get_width() == 0 || control.get_height() == 0
+                || control.get_x_offset() > m_width
+                || control.get_width() > m_width - control.get_x_offset()
+                || control.get_y_offset() > m_height
+                || control.get_height() > m_height - control.get_y_offset())
+            {
+                throw std::logic_error("APNG frame outside of the canvas");
+            }
+        }
+
+        /**
+         * \brief Checks a frame has the palette and tRNS of the first
+         * frame, which are the only ones written.
+         */
+        static void check_palette(image_type const& frame,
+                                  palette const& plte, tRNS const& trns)
+        {
+            palette const& frame_plte = frame.get_palette();
+            bool same = frame_plte.size() == plte.size()
+                && frame.get_tRNS() == trns;
+            for (size_t i = 0; same && i < plte.size(); ++i)
+            {
+                same = frame_plte[i].red == plte[i].red
+                    && frame_plte[i].green == plte[i].green
+                    && frame_plte[i].blue == plte[i].blue;
+            }
+            if (!same)
+            {
+                throw std::logic_error("APNG frames must share the palette"
+                                       " and tRNS of the first frame");
+            }
+        }
+
+        /**
+         * \brief Writes the signature, the IHDR and any other chunks
+         * preceding the image data of the first frame, and acTL.
+         */
+        void write_header(std::vector< byte >& out,
+                          std::string const& png) const
+        {
+            out.insert(out.end(), png.begin(), png.begin() + 8);
+            byte const* data = reinterpret_cast< byte const* >(png.data());
+            size_t pos = 8;
+            while (pos + 12 <= png.size())
+            {
+                uint_32 length = detail::read_uint_32(data + pos);
+                if (std::memcmp(data + pos + 4, "IDAT", 4) == 0)
+                {
+                    break;
+                }
+                out.insert(out.end(), data + pos, data + pos + length + 12);
+                if (std::memcmp(data + pos + 4, "IHDR", 4) == 0)
+                {
+                    byte actl[8];
+                    detail::put_uint_32(actl, uint_32(m_frame_count));
+                    detail::put_uint_32(actl + 4, uint_32(m_play_count));
+                    detail::append_chunk(out, "acTL", actl, 8);
+                }
+                pos += size_t(length) + 12;
+            }
+        }
+
+        /**
+         * \brief Writes the fcTL chunk of a frame and its image data,
+         * taken from the IDAT chunks of its standalone PNG, as IDAT
+         * for the first frame and as fdAT for the others.
+         */
+        static void write_frame(std::vector< byte >& out, encoder const& enc,
+                                uint_32& sequence, bool first)
+        {
+            apng_frame const& control = enc.m_control;
+            byte fctl[26];
+            detail::put_uint_32(fctl, sequence++);
+            detail::put_uint_32(fctl + 4, control.get_width());
+            detail::put_uint_32(fctl + 8, control.get_height());
+            detail::put_uint_32(fctl + 12, control.get_x_offset());
+            detail::put_uint_32(fctl + 16, control.get_y_offset());
+            fctl[20] = byte(control.get_delay_num() >> 8);
+            fctl[21] = byte(control.get_delay_num());
+            fctl[22] = byte(control.get_delay_den() >> 8);
+            fctl[23] = byte(control.get_delay_den());
+            fctl[24] = byte(control.get_dispose_op());
+            fctl[25] = byte(control.get_blend_op());
+            detail::append_chunk(out, "fcTL", fctl, 26);
+
+            std::string const& png = enc.m_output;
+            byte const* data = reinterpret_cast< byte const* >(png.data());
+            size_t pos = 8;
+            while (pos + 12 <= png.size())
+            {
+                uint_32 length = detail::read_uint_32(data + pos);
+                if (std::memcmp(data + pos + 4, "IDAT", 4) == 0)
+                {
+                    if (first)
+                    {
+                        out.insert(out.end(), data + pos,
+                                   data + pos + length + 12);
+                    }
+                    else
+                    {
+                        size_t start = out.size();
+                        detail::append_uint_32(out, length + 4);
+                        out.insert(out.end(), "fdAT", "fdAT" + 4);
+                        detail::append_uint_32(out, sequence++);
+                        out.insert(out.end(), data + pos + 8,
+                                   data + pos + 8 + length);
+                        detail::append_uint_32(out, detail::update_crc
+                                               (0xffffffff, & out[start + 4],
+                                                length + 8) ^ 0xffffffff);
+                    }
+                }
+                pos += size_t(length) + 12;
+            }
+        }
+
+        uint_32 m_width;
+        uint_32 m_height;
+        size_t m_frame_count;
+        size_t m_play_count;
+        size_t m_thread_count;
+    };
+
+} // namespace png
+
+#endif // PNGPP_APNG_HPP_INCLUDED
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_BENCH_BENCH_HPP_INCLUDED
+#define PNGPP_BENCH_BENCH_HPP_INCLUDED
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#include <png.hpp>
+
+/**
+ * Helpers shared by the benchmarks.
+ */
+namespace bench
+{
+
+    /**
+     * \brief Returns the wall clock time in seconds.
+     */
+    inline double now()
+    {
+#ifdef _WIN32
+        return double(std::clock()) / CLOCKS_PER_SEC;
+#else
+        timeval tv;
+        gettimeofday(& tv, 0);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+    }
+
+    /**
+     * \brief Returns the contents of a file.
+     */
+    inline std::string read_file(std::string const& filename)
+    {
+        std::ifstream file(filename.c_str(), std::ios::binary);
+        if (!file.is_open())
+        {
+            throw png::std_error(filename);
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    /**
+     * \brief A stream buffer reading from a string without copying
+     * it.
+     */
+    class memory_buffer
+        : public std::streambuf
+    {
+    public:
+        explicit memory_buffer(std::string const& data)
+        {
+            char* begin = const_cast< char* >(data.data());
+            setg(begin, begin, begin + data.size());
+        }
+    };
+
+    /**
+     * \brief Quotes a string for JSON output.
+     */
+    inline std::string json_string(std::string const& value)
+    {
+        std::string result = "\"";
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            char c = value[i];
+            if (c == '"' || c == '\\')
+            {
+                result += '\\';
+                result += c;
+            }
+            else if (static_cast< unsigned char >(c) < 0x20)
+            {
+                char escaped[8];
+                std::sprintf(escaped, "\\u%04x", c);
+                result += escaped;
+            }
+            else
+            {
+                result += c;
+            }
+        }
+        return result + "\"";
+    }
+
+    /**
+     * \brief Splits a comma separated list.
+     */
+    inline std::vector< std::string > split_list(std::string const& list)
+    {
+        std::vector< std::string > items;
+        std::string::size_type begin = 0;
+        while (begin <= list.size())
+        {
+            std::string::size_type end = list.find(',', begin);
+            if (end == std::string::npos)
+            {
+                end = list.size();
+            }
+            if (end > begin)
+            {
+                items.push_back(list.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        return items;
+    }
+
+} // namespace bench
+
+#endif // PNGPP_BENCH_BENCH_HPP_INCLUDED
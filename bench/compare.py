@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+Compares two JSON result files written by `throughput -o` and flags
+configurations which got slower than the baseline by more than the
+threshold.  Exits with status 1 if any regression is found or if
+configurations of the baseline are missing.
+"""
+import argparse
+import json
+import sys
+
+KEY = ("corpus", "pixel", "buffer", "source", "operation")
+
+
+def load(filename):
+    with open(filename) as f:
+        return {tuple(r[k] for k in KEY): r for r in json.load(f)["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown in percent to flag (default: 10)")
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+
+    regressions = 0
+    for key in sorted(results):
+        if key not in baseline:
+            continue
+        old = baseline[key]["mpixel_per_s"]
+        new = results[key]["mpixel_per_s"]
+        change = (new / old - 1) * 100 if old > 0 else 0.0
+        flag = ""
+        if change < -args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-24s %-14s %-19s %-7s %-7s %9.1f %9.1f %+7.1f%%%s"
+              % (key + (old, new, change, flag)))
+
+    missing = sorted(set(baseline) - set(results))
+    for key in missing:
+        print("%-24s %-14s %-19s %-7s %-7s missing" % key)
+
+    print("%d regression(s) over %.0f%%, %d missing"
+          % (regressions, args.threshold, len(missing)))
+    return 1 if regressions or missing else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_BENCH_CORPUS_HPP_INCLUDED
+#define PNGPP_BENCH_CORPUS_HPP_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+
+namespace bench
+{
+
+    /**
+     * \brief Kinds of synthetic %image content.
+     */
+    enum content
+    {
+        content_noise,          ///< independent random samples
+        content_gradient,       ///< smooth gradients over the whole image
+        content_ui,             ///< flat windows with borders and text
+        content_photo,          ///< smooth multi-scale texture with grain
+        content_sparse_alpha    ///< a few discs on a transparent background
+    };
+
+    size_t const content_count = 5;
+
+    inline char const* content_name(content kind)
+    {
+        static char const* const names[content_count] =
+        {
+            "noise", "gradient", "ui", "photo", "sparse_alpha"
+        };
+        return names[kind];
+    }
+
+    inline content parse_content(std::string const& name)
+    {
+        for (size_t i = 0; i < content_count; ++i)
+        {
+            if (name == content_name(content(i)))
+            {
+                return content(i);
+            }
+        }
+        throw std::invalid_argument("unknown content: " + name);
+    }
+
+    namespace detail
+    {
+
+        /**
+         * \brief Hashes a lattice point to 32 random bits.
+         */
+        inline png::uint_32 hash(png::uint_32 x, png::uint_32 y,
+                                 png::uint_32 seed)
+        {
+            png::uint_32 h = (seed * 0x9e3779b9u) ^ (x * 0x85ebca6bu)
+                ^ (y * 0xc2b2ae35u);
+            h &= 0xffffffffu;
+            h ^= h >> 16;
+            h = (h * 0x7feb352du) & 0xffffffffu;
+            h ^= h >> 15;
+            h = (h * 0x846ca68bu) & 0xffffffffu;
+            h ^= h >> 16;
+            return h;
+        }
+
+        inline double unit(png::uint_32 h)
+        {
+            return h / 4294967296.0;
+        }
+
+        /**
+         * \brief Bilinearly interpolated lattice noise with lattice
+         * cells of \a scale pixels, in [0, 1).
+         */
+        inline double value_noise(png::uint_32 x, png::uint_32 y,
+                                  png::uint_32 scale, png::uint_32 seed)
+        {
+            png::uint_32 cx = x / scale;
+            png::uint_32 cy = y / scale;
+            double fx = double(x % scale) / scale;
+            double fy = double(y % scale) / scale;
+            fx = fx * fx * (3 - 2 * fx);
+            fy = fy * fy * (3 - 2 * fy);
+            double top = unit(hash(cx, cy, seed)) * (1 - fx)
+                + unit(hash(cx + 1, cy, seed)) * fx;
+            double bottom = unit(hash(cx, cy + 1, seed)) * (1 - fx)
+                + unit(hash(cx + 1, cy + 1, seed)) * fx;
+            return top * (1 - fy) + bottom * fy;
+        }
+
+        inline png::uint_16 to_sample(double value)
+        {
+            if (value <= 0)
+            {
+                return 0;
+            }
+            if (value >= 1)
+            {
+                return 65535;
+            }
+            return png::uint_16(value * 65535 + 0.5);
+        }
+
+        inline void set_rgba(png::uint_16* rgba, png::uint_32 r,
+                             png::uint_32 g, png::uint_32 b, png::uint_32 a)
+        {
+            rgba[0] = png::uint_16(r);
+            rgba[1] = png::uint_16(g);
+            rgba[2] = png::uint_16(b);
+            rgba[3] = png::uint_16(a);
+        }
+
+        inline void ui_pixel(png::uint_32 x, png::uint_32 y,
+                             png::uint_32 seed, png::uint_16* rgba)
+        {
+            static png::byte const colors[6][3] =
+            {
+                { 0xf0, 0xf0, 0xf0 }, { 0xff, 0xff, 0xff },
+                { 0x2b, 0x2b, 0x2b }, { 0xe8, 0xf0, 0xfe },
+                { 0xfd, 0xf6, 0xe3 }, { 0x1e, 0x1e, 0x2e }
+            };
+            png::uint_32 const window_width = 320;
+            png::uint_32 const window_height = 200;
+            png::uint_32 const title_height = 24;
+            png::uint_32 cx = x / window_width;
+            png::uint_32 cy = y / window_height;
+            png::uint_32 lx = x % window_width;
+            png::uint_32 ly = y % window_height;
+            png::uint_32 h = hash(cx, cy, seed);
+            png::byte const* background = colors[h % 6];
+            bool dark = background[0] < 0x80;
+            png::uint_32 value[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                value[i] = background[i];
+            }
+            if (lx == 0 || ly == 0)
+            {
+                value[0] = value[1] = value[2] = 0x80;
+            }
+            else if (ly < title_height)
+            {
+                value[0] = 0x30 + (h >> 8) % 0x60;
+                value[1] = 0x50 + (h >> 16) % 0x60;
+                value[2] = 0x90 + (h >> 24) % 0x60;
+            }
+            else
+            {
+                // lines of blocky 5x8 glyphs in 6x16 cells
+                png::uint_32 line = (ly - title_height) / 16;
+                png::uint_32 row = (ly - title_height) % 16;
+                png::uint_32 column = (lx - 8) / 6;
+                png::uint_32 line_length = hash(line, cy, h) % 48;
+                if (lx >= 8 && row >= 4 && row < 12 && lx % 6 != 1
+                    && column < line_length)
+                {
+                    png::uint_32 glyph = hash(column + cx * 64, line, h);
+                    bool space = glyph % 7 == 0;
+                    if (!space && (glyph >> ((row - 4) * 4 + lx % 6 % 4)) & 1)
+                    {
+                        png::uint_32 ink = dark ? 0xd0 : 0x20;
+                        value[0] = value[1] = value[2] = ink;
+                    }
+                }
+            }
+            set_rgba(rgba, value[0] * 257, value[1] * 257, value[2] * 257,
+                     65535);
+        }
+
+        inline void photo_pixel(png::uint_32 x, png::uint_32 y,
+                                png::uint_32 seed, png::uint_16* rgba)
+        {
+            double luminance = 0.55 * value_noise(x, y, 128, seed)
+                + 0.30 * value_noise(x, y, 32, seed + 1)
+                + 0.12 * value_noise(x, y, 8, seed + 2)
+                + 0.03 * unit(hash(x, y, seed + 3));
+            double tint = value_noise(x, y, 256, seed + 4);
+            set_rgba(rgba,
+                     to_sample(luminance * (0.8 + 0.4 * tint)),
+                     to_sample(luminance),
+                     to_sample(luminance * (1.2 - 0.4 * tint)),
+                     65535);
+        }
+
+        inline void sparse_alpha_pixel(png::uint_32 x, png::uint_32 y,
+                                       png::uint_32 seed, png::uint_16* rgba)
+        {
+            png::uint_32 const cell = 64;
+            png::uint_32 h = hash(x / cell, y / cell, seed);
+            set_rgba(rgba, 0, 0, 0, 0);
+            if (h % 8 != 0)
+            {
+                return;
+            }
+            double center_x = 24 + (h >> 3) % 16 + 0.5;
+            double center_y = 24 + (h >> 7) % 16 + 0.5;
+            double radius = 4 + (h >> 11) % 20;
+            double dx = x % cell + 0.5 - center_x;
+            double dy = y % cell + 0.5 - center_y;
+            double coverage = radius + 0.5 - std::sqrt(dx * dx + dy * dy);
+            if (coverage <= 0)
+            {
+                return;
+            }
+            png::uint_32 color = hash(x / cell, y / cell, seed + 1);
+            set_rgba(rgba, (color & 0xff) * 257, (color >> 8 & 0xff) * 257,
+                     (color >> 16 & 0xff) * 257, to_sample(coverage));
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief Computes a pixel of synthetic content as 16-bit RGBA.
+     *
+     * Every pixel only depends on its position, the %image size and
+     * the seed, so any row can be produced on its own and the same
+     * arguments always give the same %image.
+     */
+    inline void content_pixel(content kind, png::uint_32 x, png::uint_32 y,
+                              png::uint_32 width, png::uint_32 height,
+                              png::uint_32 seed, png::uint_16* rgba)
+    {
+        switch (kind)
+        {
+        case content_noise:
+        {
+            png::uint_32 h1 = detail::hash(x, y, seed);
+            png::uint_32 h2 = detail::hash(x, y, seed + 1);
+            detail::set_rgba(rgba, h1 & 0xffff, h1 >> 16,
+                             h2 & 0xffff, h2 >> 16);
+            break;
+        }
+        case content_gradient:
+        {
+            double fx = width > 1 ? double(x) / (width - 1) : 0;
+            double fy = height > 1 ? double(y) / (height - 1) : 0;
+            detail::set_rgba(rgba, detail::to_sample(fx),
+                             detail::to_sample(fy),
+                             detail::to_sample((fx + fy) / 2),
+                             detail::to_sample(1 - fy / 2));
+            break;
+        }
+        case content_ui:
+            detail::ui_pixel(x, y, seed, rgba);
+            break;
+        case content_photo:
+            detail::photo_pixel(x, y, seed, rgba);
+            break;
+        case content_sparse_alpha:
+            detail::sparse_alpha_pixel(x, y, seed, rgba);
+            break;
+        }
+    }
+
+    /**
+     * \brief Streams synthetic content in the color type and bit
+     * depth of \a pixel.
+     *
+     * Rows are produced on demand, so memory use does not depend on
+     * the %image height and gigapixel images can be written.  Gray
+     * samples are the luminance of the RGB content; palette images
+     * use a gray ramp below 8 bits and a 6x7x6 color cube at 8 bits.
+     * Only the gray+alpha and RGBA formats keep the alpha channel.
+     */
+    template< typename pixel >
+    class corpus_generator
+        : public png::generator< pixel, corpus_generator< pixel > >
+    {
+        typedef png::generator< pixel, corpus_generator< pixel > > base;
+
+    public:
+        corpus_generator(content kind, png::uint_32 width,
+                         png::uint_32 height, png::uint_32 seed = 1)
+            : base(width, height),
+              m_content(kind),
+              m_seed(seed),
+              m_color_type(png::pixel_traits< pixel >::get_color_type()),
+              m_bit_depth(png::pixel_traits< pixel >::get_bit_depth()),
+              m_row((size_t(width) * get_channels() * m_bit_depth + 7) / 8)
+        {
+            if (m_color_type == png::color_type_palette)
+            {
+                this->get_info().set_palette(make_palette());
+            }
+        }
+
+        png::byte* get_next_row(png::uint_32 pos)
+        {
+            std::fill(m_row.begin(), m_row.end(), 0);
+            png::uint_32 width = this->get_info().get_width();
+            png::uint_32 height = this->get_info().get_height();
+            size_t index = 0;
+            for (png::uint_32 x = 0; x < width; ++x)
+            {
+                png::uint_16 rgba[4];
+                content_pixel(m_content, x, pos, width, height, m_seed, rgba);
+                png::uint_16 samples[4];
+                size_t count = to_samples(rgba, samples);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    store(index++, samples[i]);
+                }
+            }
+            return m_row.empty() ? 0 : & m_row[0];
+        }
+
+    private:
+        size_t get_channels() const
+        {
+            switch (m_color_type)
+            {
+            case png::color_type_gray_alpha:
+                return 2;
+            case png::color_type_rgb:
+                return 3;
+            case png::color_type_rgb_alpha:
+                return 4;
+            default:
+                return 1;
+            }
+        }
+
+        png::palette make_palette() const
+        {
+            png::palette palette;
+            if (m_bit_depth == 8)
+            {
+                for (int r = 0; r < 6; ++r)
+                    for (int g = 0; g < 7; ++g)
+                        for (int b = 0; b < 6; ++b)
+                            palette.push_back(png::color(png::byte(r * 51),
+                                                         png::byte(g * 85 / 2),
+                                                         png::byte(b * 51)));
+            }
+            else
+            {
+                int levels = 1 << m_bit_depth;
+                for (int i = 0; i < levels; ++i)
+                {
+                    png::byte level = png::byte(i * 255 / (levels - 1));
+                    palette.push_back(png::color(level, level, level));
+                }
+            }
+            return palette;
+        }
+
+        /**
+         * \brief Converts 16-bit RGBA to the %image samples, scaled
+         * to the bit depth.
+         */
+        size_t to_samples(png::uint_16 const* rgba,
+                          png::uint_16* samples) const
+        {
+            int shift = 16 - m_bit_depth;
+            png::uint_32 luminance = (6968u * rgba[0] + 23434u * rgba[1]
+                                      + 2366u * rgba[2] + 16384) >> 15;
+            switch (m_color_type)
+            {
+            case png::color_type_gray:
+                samples[0] = png::uint_16(luminance >> shift);
+                return 1;
+            case png::color_type_gray_alpha:
+                samples[0] = png::uint_16(luminance >> shift);
+                samples[1] = png::uint_16(rgba[3] >> shift);
+                return 2;
+            case png::color_type_rgb:
+            case png::color_type_rgb_alpha:
+            {
+                size_t count = get_channels();
+                for (size_t i = 0; i < count; ++i)
+                {
+                    samples[i] = png::uint_16(rgba[i] >> shift);
+                }
+                return count;
+            }
+            default:
+                if (m_bit_depth == 8)
+                {
+                    samples[0] = png::uint_16((rgba[0] * 6 >> 16) * 42
+                                              + (rgba[1] * 7 >> 16) * 6
+                                              + (rgba[2] * 6 >> 16));
+                }
+                else
+                {
+                    samples[0] = png::uint_16(luminance >> shift);
+                }
+                return 1;
+            }
+        }
+
+        void store(size_t index, png::uint_16 sample)
+        {
+            if (m_bit_depth == 16)
+            {
+                // the writer swaps 16-bit samples to network order
+                std::memcpy(& m_row[index * 2], & sample, 2);
+            }
+            else if (m_bit_depth == 8)
+            {
+                m_row[index] = png::byte(sample);
+            }
+            else
+            {
+                size_t bit = index * m_bit_depth;
+                m_row[bit / 8] |= png::byte(sample
+                                            << (8 - m_bit_depth - bit % 8));
+            }
+        }
+
+        content m_content;
+        png::uint_32 m_seed;
+        png::color_type m_color_type;
+        int m_bit_depth;
+        std::vector< png::byte > m_row;
+    };
+
+    /**
+     * \brief Writes an %image of synthetic content as \a pixel.
+     */
+    template< typename pixel >
+    void write_corpus_image(std::ostream& stream, content kind,
+                            png::uint_32 width, png::uint_32 height,
+                            png::uint_32 seed,
+                            png::write_options const& options)
+    {
+        corpus_generator< pixel > generator(kind, width, height, seed);
+        generator.write(stream, options);
+    }
+
+    /**
+     * \brief A PNG color type and bit depth the corpus can be written
+     * in.
+     */
+    struct corpus_format
+    {
+        char const* name;
+        void (*write)(std::ostream&, content, png::uint_32, png::uint_32,
+                      png::uint_32, png::write_options const&);
+    };
+
+    /**
+     * \brief Returns every valid color type and bit depth pair.
+     */
+    inline corpus_format const* corpus_formats(size_t& count)
+    {
+        static corpus_format const formats[] =
+        {
+            { "gray1", & write_corpus_image< png::gray_pixel_1 > },
+            { "gray2", & write_corpus_image< png::gray_pixel_2 > },
+            { "gray4", & write_corpus_image< png::gray_pixel_4 > },
+            { "gray8", & write_corpus_image< png::gray_pixel > },
+            { "gray16", & write_corpus_image< png::gray_pixel_16 > },
+            { "ga8", & write_corpus_image< png::ga_pixel > },
+            { "ga16", & write_corpus_image< png::ga_pixel_16 > },
+            { "rgb8", & write_corpus_image< png::rgb_pixel > },
+            { "rgb16", & write_corpus_image< png::rgb_pixel_16 > },
+            { "rgba8", & write_corpus_image< png::rgba_pixel > },
+            { "rgba16", & write_corpus_image< png::rgba_pixel_16 > },
+            { "palette1", & write_corpus_image< png::index_pixel_1 > },
+            { "palette2", & write_corpus_image< png::index_pixel_2 > },
+            { "palette4", & write_corpus_image< png::index_pixel_4 > },
+            { "palette8", & write_corpus_image< png::index_pixel > }
+        };
+        count = sizeof(formats) / sizeof(formats[0]);
+        return formats;
+    }
+
+    inline corpus_format const& find_corpus_format(std::string const& name)
+    {
+        size_t count;
+        corpus_format const* formats = corpus_formats(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (name == formats[i].name)
+            {
+                return formats[i];
+            }
+        }
+        throw std::invalid_argument("unknown format: " + name);
+    }
+
+} // namespace bench
+
+#endif // PNGPP_BENCH_CORPUS_HPP_INCLUDED
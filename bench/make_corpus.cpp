@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+/**
+ * Writes a reproducible benchmark corpus: every requested content
+ * kind in every requested color type and bit depth, named
+ * CONTENT-FORMAT-WIDTHxHEIGHT.png.  The same arguments always give
+ * byte-identical files, so the corpus can be regenerated instead of
+ * checked in.  Rows are generated while writing, which makes
+ * gigapixel sizes possible, e.g. -s 32768.
+ */
+
+struct settings
+{
+    settings()
+        : width(1024),
+          height(1024),
+          seed(1),
+          level(-1),
+          output_dir(".")
+    {
+    }
+
+    png::uint_32 width;
+    png::uint_32 height;
+    png::uint_32 seed;
+    int level;
+    std::string output_dir;
+    std::vector< std::string > formats;
+    std::vector< std::string > contents;
+};
+
+void
+parse_size(std::string const& size, settings& config)
+{
+    std::string::size_type x = size.find('x');
+    config.width = png::uint_32(std::atol(size.c_str()));
+    config.height = x == std::string::npos
+        ? config.width
+        : png::uint_32(std::atol(size.c_str() + x + 1));
+    if (config.width == 0 || config.height == 0)
+    {
+        throw std::runtime_error("invalid size: " + size);
+    }
+}
+
+settings
+parse_arguments(int argc, char* argv[])
+{
+    settings config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-s" && has_value)
+        {
+            parse_size(argv[++i], config);
+        }
+        else if (arg == "-f" && has_value)
+        {
+            config.formats = bench::split_list(argv[++i]);
+        }
+        else if (arg == "-c" && has_value)
+        {
+            config.contents = bench::split_list(argv[++i]);
+        }
+        else if (arg == "-r" && has_value)
+        {
+            config.seed = png::uint_32(std::atol(argv[++i]));
+        }
+        else if (arg == "-l" && has_value)
+        {
+            config.level = std::atoi(argv[++i]);
+        }
+        else if (arg == "-d" && has_value)
+        {
+            config.output_dir = argv[++i];
+        }
+        else
+        {
+            throw std::runtime_error("usage: make_corpus [-s SIZE|WxH]"
+                                     " [-f FORMAT,...] [-c CONTENT,...]"
+                                     " [-r SEED] [-l LEVEL] [-d DIR]");
+        }
+    }
+    if (config.formats.empty())
+    {
+        size_t count;
+        bench::corpus_format const* formats = bench::corpus_formats(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            config.formats.push_back(formats[i].name);
+        }
+    }
+    if (config.contents.empty())
+    {
+        for (size_t i = 0; i < bench::content_count; ++i)
+        {
+            config.contents.push_back(bench::content_name(bench::content(i)));
+        }
+    }
+    return config;
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    settings config = parse_arguments(argc, argv);
+
+    png::write_options options;
+    options.set_compression_level(config.level);
+
+    for (size_t i = 0; i < config.contents.size(); ++i)
+    {
+        bench::content kind = bench::parse_content(config.contents[i]);
+        for (size_t j = 0; j < config.formats.size(); ++j)
+        {
+            bench::corpus_format const& format
+                = bench::find_corpus_format(config.formats[j]);
+            std::ostringstream name;
+            name << config.output_dir << "/" << bench::content_name(kind)
+                 << "-" << format.name << "-" << config.width << "x"
+                 << config.height << ".png";
+            std::ofstream file(name.str().c_str(), std::ios::binary);
+            if (!file.is_open())
+            {
+                throw png::std_error(name.str());
+            }
+            format.write(file, kind, config.width, config.height,
+                         config.seed, options);
+            file.close();
+            if (!file)
+            {
+                throw png::std_error(name.str());
+            }
+            std::cout << name.str() << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "make_corpus: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+/**
+ * Measures how many RGBA frames per second a single core encodes with
+ * each write_mode, as when dumping screen or video frames for later
+ * inspection.  Frames are 1920x1080 synthetic content from corpus.hpp
+ * by default and go to a reused memory buffer or, with -f, to a file,
+ * which measures the file system as well.
+ *
+ * Exits with a failure if write_mode_realtime falls below the frame
+ * rate given with -r (60 by default, 0 to only report).
+ */
+
+struct settings
+{
+    settings()
+        : width(1920),
+          height(1080),
+          min_time(1.0),
+          min_fps(60),
+          to_file(false),
+          temp_dir("/tmp")
+    {
+        for (size_t i = 0; i < bench::content_count; ++i)
+        {
+            contents.push_back(bench::content(i));
+        }
+    }
+
+    png::uint_32 width;
+    png::uint_32 height;
+    double min_time;
+    double min_fps;
+    bool to_file;
+    std::string temp_dir;
+    std::vector< bench::content > contents;
+};
+
+typedef png::image< png::rgba_pixel,
+                    png::solid_pixel_buffer< png::rgba_pixel > > frame;
+
+/**
+ * A stream buffer collecting a whole encoded frame in memory, reusing
+ * its storage from frame to frame like a capture ring would.
+ */
+class frame_buffer
+    : public std::streambuf
+{
+public:
+    void clear()
+    {
+        m_data.clear();
+    }
+
+    size_t size() const
+    {
+        return m_data.size();
+    }
+
+protected:
+    std::streamsize xsputn(char const* data, std::streamsize size)
+    {
+        m_data.append(data, size_t(size));
+        return size;
+    }
+
+    int_type overflow(int_type c)
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            m_data += traits_type::to_char_type(c);
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    std::string m_data;
+};
+
+struct mode_info
+{
+    png::write_mode mode;
+    char const* name;
+};
+
+mode_info const modes[] =
+{
+    { png::write_mode_default, "default" },
+    { png::write_mode_realtime, "realtime" },
+    { png::write_mode_realtime_rle, "realtime_rle" }
+};
+
+/**
+ * Encodes \a image with \a mode for at least the configured time and
+ * returns the frame rate; \a frame_size receives the encoded size.
+ */
+double
+measure(settings const& config, frame& image, png::write_mode mode,
+        size_t& frame_size)
+{
+    png::write_options const options(mode);
+    std::string const path = config.temp_dir + "/pngpp-bench-frame.png";
+    frame_buffer buffer;
+    std::ostream stream(& buffer);
+
+    size_t frames = 0;
+    double seconds;
+    double start = bench::now();
+    do
+    {
+        if (config.to_file)
+        {
+            image.write(path, options);
+        }
+        else
+        {
+            buffer.clear();
+            image.write_stream(stream, options);
+            frame_size = buffer.size();
+        }
+        ++frames;
+        seconds = bench::now() - start;
+    }
+    while (seconds < config.min_time);
+
+    if (config.to_file)
+    {
+        frame_size = bench::read_file(path).size();
+        std::remove(path.c_str());
+    }
+    return frames / seconds;
+}
+
+settings
+parse_arguments(int argc, char* argv[])
+{
+    settings config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-s" && has_value)
+        {
+            std::string size = argv[++i];
+            std::string::size_type x = size.find('x');
+            config.width = png::uint_32(std::atol(size.c_str()));
+            config.height = x == std::string::npos
+                ? config.width
+                : png::uint_32(std::atol(size.c_str() + x + 1));
+            if (config.width == 0 || config.height == 0)
+            {
+                throw std::runtime_error("invalid size: " + size);
+            }
+        }
+        else if (arg == "-t" && has_value)
+        {
+            config.min_time = std::atof(argv[++i]);
+        }
+        else if (arg == "-r" && has_value)
+        {
+            config.min_fps = std::atof(argv[++i]);
+        }
+        else if (arg == "-f")
+        {
+            config.to_file = true;
+        }
+        else if (arg == "-d" && has_value)
+        {
+            config.temp_dir = argv[++i];
+        }
+        else if (arg == "-c" && has_value)
+        {
+            std::vector< std::string > names = bench::split_list(argv[++i]);
+            config.contents.clear();
+            for (size_t j = 0; j < names.size(); ++j)
+            {
+                config.contents.push_back(bench::parse_content(names[j]));
+            }
+        }
+        else
+        {
+            throw std::runtime_error("usage: realtime [-s SIZE|WxH]"
+                                     " [-t SECONDS] [-r MINFPS] [-f]"
+                                     " [-d TEMPDIR] [-c CONTENT,...]");
+        }
+    }
+    return config;
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    settings const config = parse_arguments(argc, argv);
+    double const raw_size = 4.0 * config.width * config.height;
+
+    bool too_slow = false;
+    for (size_t i = 0; i < config.contents.size(); ++i)
+    {
+        std::ostringstream png;
+        bench::write_corpus_image< png::rgba_pixel >(png, config.contents[i],
+                                                     config.width,
+                                                     config.height, 1,
+                                                     png::write_options());
+        std::istringstream in(png.str());
+        frame image;
+        image.read_stream(in);
+
+        for (size_t j = 0; j < sizeof(modes) / sizeof(modes[0]); ++j)
+        {
+            size_t frame_size = 0;
+            double fps = measure(config, image, modes[j].mode, frame_size);
+            std::cout << std::left << std::setw(14)
+                      << bench::content_name(config.contents[i])
+                      << std::setw(14) << modes[j].name << std::right
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(8) << fps << " fps"
+                      << std::setw(10) << fps * raw_size / 1e6 << " MB/s"
+                      << std::setw(8) << 100.0 * frame_size / raw_size
+                      << " % of raw";
+            if (modes[j].mode == png::write_mode_realtime
+                && fps < config.min_fps)
+            {
+                std::cout << "  below " << config.min_fps << " fps";
+                too_slow = true;
+            }
+            std::cout << std::endl;
+        }
+    }
+    return too_slow ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "realtime: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+/**
+ * Measures decode and encode throughput for every pixel type, both
+ * pixel buffer types and both in-memory and file I/O, over the
+ * pngsuite and the synthetic contents of corpus.hpp.  Results go to
+ * stdout and, as JSON, to the file given with -o, for compare.py to
+ * check against a baseline.
+ *
+ * Throughput is given in megabytes of decoded pixel data per second
+ * and in megapixels per second.  With -p, hardware counters are read
+ * through png::perf_profiler as well and cycles per pixel and
+ * instructions per cycle are reported for every measurement.
+ */
+
+struct settings
+{
+    settings()
+        : min_time(0.2),
+          size(1024),
+          profile(false),
+          temp_dir("/tmp")
+    {
+        for (size_t i = 0; i < bench::content_count; ++i)
+        {
+            contents.push_back(bench::content(i));
+        }
+    }
+
+    double min_time;
+    png::uint_32 size;
+    bool profile;
+    std::string temp_dir;
+    std::string json_file;
+    std::vector< bench::content > contents;
+    std::vector< std::string > files;
+};
+
+struct result
+{
+    std::string corpus;
+    std::string pixel;
+    std::string buffer;
+    std::string source;
+    std::string operation;
+    size_t iterations;
+    double seconds;
+    double pixels;
+    double bytes;
+    png::perf_counters counters;
+};
+
+/**
+ * Profiles the calling thread until it goes out of scope if profiling
+ * is enabled.
+ */
+class optional_profiler
+{
+public:
+    optional_profiler(settings const& config, png::perf_counters& counters)
+        : m_profiler(config.profile ? new png::perf_profiler(counters) : 0)
+    {
+    }
+
+    ~optional_profiler()
+    {
+        delete m_profiler;
+    }
+
+    void stop()
+    {
+        if (m_profiler)
+        {
+            m_profiler->stop();
+        }
+    }
+
+private:
+    optional_profiler(optional_profiler const&);
+    optional_profiler& operator=(optional_profiler const&);
+
+    png::perf_profiler* m_profiler;
+};
+
+/**
+ * A set of images: their PNG encodings and where they are on disk.
+ */
+struct corpus
+{
+    std::string name;
+    std::vector< std::string > data;
+    std::vector< std::string > paths;
+};
+
+template< typename pixel > char const* pixel_name();
+template<> char const* pixel_name< png::gray_pixel >() { return "gray_pixel"; }
+template<> char const* pixel_name< png::gray_pixel_16 >() { return "gray_pixel_16"; }
+template<> char const* pixel_name< png::ga_pixel >() { return "ga_pixel"; }
+template<> char const* pixel_name< png::ga_pixel_16 >() { return "ga_pixel_16"; }
+template<> char const* pixel_name< png::rgb_pixel >() { return "rgb_pixel"; }
+template<> char const* pixel_name< png::rgb_pixel_16 >() { return "rgb_pixel_16"; }
+template<> char const* pixel_name< png::rgba_pixel >() { return "rgba_pixel"; }
+template<> char const* pixel_name< png::rgba_pixel_16 >() { return "rgba_pixel_16"; }
+
+template< typename pixel >
+struct buffer_names
+{
+    static char const* get(png::pixel_buffer< pixel > const*)
+    {
+        return "pixel_buffer";
+    }
+
+    static char const* get(png::solid_pixel_buffer< pixel > const*)
+    {
+        return "solid_pixel_buffer";
+    }
+};
+
+/**
+ * Writes synthetic content of the pixel type to memory and to a
+ * temporary file.
+ */
+template< typename pixel >
+corpus
+make_synthetic(settings const& config, bench::content kind)
+{
+    corpus result;
+    result.name = std::string(bench::content_name(kind)) + "-"
+        + pixel_name< pixel >();
+    std::ostringstream stream;
+    bench::write_corpus_image< pixel >(stream, kind, config.size, config.size,
+                                       1, png::write_options());
+    result.data.push_back(stream.str());
+    result.paths.push_back(config.temp_dir + "/pngpp-bench-"
+                           + result.name + ".png");
+    std::ofstream file(result.paths.back().c_str(), std::ios::binary);
+    file.write(result.data.back().data(), result.data.back().size());
+    if (!file)
+    {
+        throw png::std_error(result.paths.back());
+    }
+    return result;
+}
+
+template< typename pixel, class pixbuf >
+void
+decode(corpus const& images, size_t i, bool from_file,
+       png::image< pixel, pixbuf >& image)
+{
+    if (from_file)
+    {
+        image.read(images.paths[i]);
+    }
+    else
+    {
+        bench::memory_buffer buffer(images.data[i]);
+        std::istream stream(& buffer);
+        image.read_stream(stream);
+    }
+}
+
+template< typename pixel, class pixbuf >
+result
+measure_decode(settings const& config, corpus const& images, bool from_file)
+{
+    result r;
+    r.iterations = 0;
+    r.pixels = 0;
+    png::image< pixel, pixbuf > image;
+    optional_profiler profile(config, r.counters);
+    double start = bench::now();
+    do
+    {
+        for (size_t i = 0; i < images.data.size(); ++i)
+        {
+            decode(images, i, from_file, image);
+            r.pixels += double(image.get_width()) * image.get_height();
+        }
+        ++r.iterations;
+        r.seconds = bench::now() - start;
+    }
+    while (r.seconds < config.min_time);
+    r.operation = "decode";
+    return r;
+}
+
+template< typename pixel, class pixbuf >
+result
+measure_encode(settings const& config, corpus const& images, bool to_file)
+{
+    std::vector< png::image< pixel, pixbuf > > decoded(images.data.size());
+    for (size_t i = 0; i < images.data.size(); ++i)
+    {
+        decode(images, i, false, decoded[i]);
+    }
+    std::string const path = config.temp_dir + "/pngpp-bench-output.png";
+
+    result r;
+    r.iterations = 0;
+    r.pixels = 0;
+    optional_profiler profile(config, r.counters);
+    double start = bench::now();
+    do
+    {
+        for (size_t i = 0; i < decoded.size(); ++i)
+        {
+            if (to_file)
+            {
+                decoded[i].write(path);
+            }
+            else
+            {
+                std::ostringstream stream;
+                decoded[i].write_stream(stream);
+            }
+            r.pixels += double(decoded[i].get_width())
+                * decoded[i].get_height();
+        }
+        ++r.iterations;
+        r.seconds = bench::now() - start;
+    }
+    while (r.seconds < config.min_time);
+    profile.stop();
+    std::remove(path.c_str());
+    r.operation = "encode";
+    return r;
+}
+
+void
+report(result const& r, std::vector< result >& results)
+{
+    results.push_back(r);
+    std::cout << std::left << std::setw(28) << r.corpus << ' '
+              << std::setw(15) << r.pixel
+              << std::setw(20) << r.buffer
+              << std::setw(8) << r.source
+              << std::setw(8) << r.operation << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << r.bytes / r.seconds / 1e6 << " MB/s"
+              << std::setw(10) << r.pixels / r.seconds / 1e6 << " Mpix/s";
+    if (r.counters.runs != 0)
+    {
+        std::cout << std::setw(10) << r.counters.cycles / r.pixels
+                  << " cyc/pix" << std::setprecision(2)
+                  << std::setw(6) << r.counters.get_ipc() << " IPC";
+    }
+    std::cout << std::endl;
+}
+
+template< typename pixel, class pixbuf >
+void
+run(settings const& config, corpus const& images,
+    std::vector< result >& results)
+{
+    for (int from_file = 0; from_file < 2; ++from_file)
+    {
+        result r[2] =
+        {
+            measure_decode< pixel, pixbuf >(config, images, from_file != 0),
+            measure_encode< pixel, pixbuf >(config, images, from_file != 0)
+        };
+        for (size_t i = 0; i < 2; ++i)
+        {
+            r[i].corpus = images.name;
+            r[i].pixel = pixel_name< pixel >();
+            r[i].buffer = buffer_names< pixel >::get((pixbuf const*) 0);
+            r[i].source = from_file ? "file" : "memory";
+            r[i].bytes = r[i].pixels * sizeof(pixel);
+            report(r[i], results);
+        }
+    }
+}
+
+template< typename pixel >
+void
+run_pixel(settings const& config, corpus const& pngsuite,
+          std::vector< result >& results)
+{
+    std::vector< corpus > corpora;
+    if (!pngsuite.data.empty())
+    {
+        corpora.push_back(pngsuite);
+    }
+    if (config.size != 0)
+    {
+        for (size_t i = 0; i < config.contents.size(); ++i)
+        {
+            corpora.push_back(make_synthetic< pixel >(config,
+                                                      config.contents[i]));
+        }
+    }
+    for (size_t i = 0; i < corpora.size(); ++i)
+    {
+        run< pixel, png::pixel_buffer< pixel > >(config, corpora[i], results);
+        run< pixel, png::solid_pixel_buffer< pixel > >(config, corpora[i],
+                                                       results);
+    }
+    for (size_t i = 0; i < corpora.size(); ++i)
+    {
+        if (corpora[i].name != pngsuite.name)
+        {
+            std::remove(corpora[i].paths[0].c_str());
+        }
+    }
+}
+
+void
+write_json(std::string const& filename, std::vector< result > const& results)
+{
+    std::ofstream file(filename.c_str());
+    if (!file.is_open())
+    {
+        throw png::std_error(filename);
+    }
+    file << "{\n  \"libpng\": " << bench::json_string(PNG_LIBPNG_VER_STRING)
+         << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        result const& r = results[i];
+        file << "    {\"corpus\": " << bench::json_string(r.corpus)
+             << ", \"pixel\": " << bench::json_string(r.pixel)
+             << ", \"buffer\": " << bench::json_string(r.buffer)
+             << ", \"source\": " << bench::json_string(r.source)
+             << ", \"operation\": " << bench::json_string(r.operation)
+             << ", \"iterations\": " << r.iterations
+             << std::setprecision(6)
+             << ", \"seconds\": " << r.seconds
+             << ", \"mb_per_s\": " << r.bytes / r.seconds / 1e6
+             << ", \"mpixel_per_s\": " << r.pixels / r.seconds / 1e6;
+        png::perf_counters const& c = r.counters;
+        if (c.runs != 0)
+        {
+            // negative counts mark events the CPU could not count
+            file << ", \"cycles_per_pixel\": " << c.cycles / r.pixels
+                 << ", \"ipc\": " << c.get_ipc()
+                 << ", \"cache_misses_per_pixel\": "
+                 << (c.cache_misses < 0 ? -1 : c.cache_misses / r.pixels)
+                 << ", \"branch_misses_per_pixel\": "
+                 << (c.branch_misses < 0 ? -1 : c.branch_misses / r.pixels);
+        }
+        file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    if (!file)
+    {
+        throw png::std_error(filename);
+    }
+}
+
+settings
+parse_arguments(int argc, char* argv[])
+{
+    settings config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-o" && has_value)
+        {
+            config.json_file = argv[++i];
+        }
+        else if (arg == "-t" && has_value)
+        {
+            config.min_time = std::atof(argv[++i]);
+        }
+        else if (arg == "-s" && has_value)
+        {
+            config.size = png::uint_32(std::atol(argv[++i]));
+        }
+        else if (arg == "-p")
+        {
+            config.profile = true;
+        }
+        else if (arg == "-d" && has_value)
+        {
+            config.temp_dir = argv[++i];
+        }
+        else if (arg == "-c" && has_value)
+        {
+            std::vector< std::string > names = bench::split_list(argv[++i]);
+            config.contents.clear();
+            for (size_t j = 0; j < names.size(); ++j)
+            {
+                config.contents.push_back(bench::parse_content(names[j]));
+            }
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            throw std::runtime_error("usage: throughput [-o JSON] [-t SECONDS]"
+                                     " [-s SIZE] [-d TEMPDIR] [-p]"
+                                     " [-c CONTENT,...] [PNG...]");
+        }
+        else
+        {
+            config.files.push_back(arg);
+        }
+    }
+    return config;
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    settings config = parse_arguments(argc, argv);
+    if (config.profile && !png::perf_profiler::is_available())
+    {
+        std::cerr << "throughput: hardware counters are not available,"
+                  << " profiling disabled" << std::endl;
+        config.profile = false;
+    }
+
+    corpus pngsuite;
+    pngsuite.name = "pngsuite";
+    pngsuite.paths = config.files;
+    for (size_t i = 0; i < config.files.size(); ++i)
+    {
+        pngsuite.data.push_back(bench::read_file(config.files[i]));
+    }
+
+    std::vector< result > results;
+    run_pixel< png::gray_pixel >(config, pngsuite, results);
+    run_pixel< png::gray_pixel_16 >(config, pngsuite, results);
+    run_pixel< png::ga_pixel >(config, pngsuite, results);
+    run_pixel< png::ga_pixel_16 >(config, pngsuite, results);
+    run_pixel< png::rgb_pixel >(config, pngsuite, results);
+    run_pixel< png::rgb_pixel_16 >(config, pngsuite, results);
+    run_pixel< png::rgba_pixel >(config, pngsuite, results);
+    run_pixel< png::rgba_pixel_16 >(config, pngsuite, results);
+
+    if (!config.json_file.empty())
+    {
+        write_json(config.json_file, results);
+    }
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "throughput: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <png.hpp>
+
+/**
+ * Measures the cost of checksum verification: every input is decoded
+ * from memory repeatedly, with and without png::read_options'
+ * trust_checksums, and the CPU times are reported.
+ */
+
+double
+seconds(std::clock_t start)
+{
+    return double(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+double
+decode(std::string const& png, png::read_options const& options,
+       size_t iterations)
+{
+    std::clock_t start = std::clock();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        std::istringstream stream(png);
+        png::image< png::rgba_pixel > image;
+        image.read(stream, options);
+    }
+    return seconds(start);
+}
+
+void
+measure(std::string const& name, std::string const& png,
+        size_t iterations, double& total_checked, double& total_trusted)
+{
+    png::read_options trusted;
+    trusted.set_trust_checksums(true);
+
+    decode(png, trusted, 1);
+    double checked = decode(png, png::read_options(), iterations);
+    double trusted_time = decode(png, trusted, iterations);
+    total_checked += checked;
+    total_trusted += trusted_time;
+
+    std::cout << std::left << std::setw(32) << name << std::right
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << checked * 1000 / iterations
+              << std::setw(10) << trusted_time * 1000 / iterations
+              << std::setw(9) << std::setprecision(1)
+              << (checked > 0 ? 100 * (1 - trusted_time / checked) : 0.0)
+              << "%" << std::endl;
+}
+
+/**
+ * Makes a large RGB image with both flat and noisy areas, stored
+ * with fast compression as an application cache would.
+ */
+std::string
+make_large_image(size_t width, size_t height)
+{
+    png::image< png::rgb_pixel > image(width, height);
+    unsigned seed = 1;
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            seed = seed * 1103515245 + 12345;
+            png::byte noise = png::byte(seed >> 24);
+            image[y][x] = x < width / 2
+                ? png::rgb_pixel(png::byte(x), png::byte(y), 128)
+                : png::rgb_pixel(noise, png::byte(noise / 2), png::byte(y));
+        }
+    }
+    png::write_options options;
+    options.set_compression_level(1);
+    std::ostringstream stream;
+    image.write_stream(stream, options);
+    return stream.str();
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    std::cout << std::left << std::setw(32) << "input" << std::right
+              << std::setw(10) << "checked" << std::setw(10) << "trusted"
+              << std::setw(10) << "saved" << std::endl
+              << std::setw(32) << "" << std::setw(10) << "ms"
+              << std::setw(10) << "ms" << std::endl;
+
+    double total_checked = 0;
+    double total_trusted = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file.is_open())
+        {
+            throw png::std_error(argv[i]);
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        measure(argv[i], contents.str(), 200, total_checked, total_trusted);
+    }
+    measure("4096x4096 rgb (level 1)", make_large_image(4096, 4096), 5,
+            total_checked, total_trusted);
+
+    std::cout << "total: checked " << std::setprecision(3) << total_checked
+              << " s, trusted " << total_trusted << " s" << std::endl;
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "trust_checksums: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -81,6 +81,11 @@
 #define PNGPP_HAS_STD_MOVE
 #endif
 
+// gcc ships a usable std::thread, std::mutex and std::atomic since 4.7
+#if (PNGPP_GCC_VERSION >= 40700)
+#define PNGPP_HAS_STD_THREAD
+#endif
+
 #undef PNGPP_GCC_VERSION
 
 #elif defined(_MSC_VER)
@@ -92,6 +97,21 @@
 #define PNGPP_HAS_STD_MOVE
 #endif
 
+// std::thread, std::mutex and std::atomic are available since VS2012
+#if (_MSC_VER >= 1700)
+#define PNGPP_HAS_STD_THREAD
+#endif
+
+#endif
+
+// POSIX memory mapped files
+#if defined(__unix__) || defined(__APPLE__)
+#define PNGPP_HAS_MMAP
+#endif
+
+// Linux hardware performance counters (perf_event_open)
+#if defined(__linux__)
+#define PNGPP_HAS_PERF_EVENT
 #endif
 
 
@@ -35,6 +35,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <istream>
+#include <vector>
 
 #include "config.hpp"
 #include "error.hpp"
@@ -70,6 +71,7 @@ namespace png
      * \code
      * png::byte* get_next_row(png::uint_32 pos);
      * void reset(size_t pass);
+     * void end_pass(size_t pass);
      * \endcode
      *
      * The \c get_next_row() method is called every time a new row of
@@ -89,6 +91,11 @@ namespace png
      * any calls to \c get_next_row().  The value of \c 0 is passed
      * for the \c pass number.
      *
+     * The optional \c end_pass() method is called when all rows of a
+     * pass were read, so that the pixels of the interlaced %image
+     * decoded so far may be shown (see adam7).  For non-interlaced
+     * images it is called once, after the last row.
+     *
      * An optional template parameter \c info_holder encapsulates
      * image_info storage policy.  Using def_image_info_holder results
      * in image_info object stored as a sub-object of the consumer
@@ -157,7 +164,191 @@ namespace png
         template< typename istream, class transformation >
         void read(istream& stream, transformation const& transform)
         {
+            read(stream, transform, read_options());
+        }
+
+        /**
+         * \brief Reads an image from the stream using default io
+         * transformation and custom read options.
+         */
+        template< typename istream >
+        void read(istream& stream, read_options const& options)
+        {
+            read(stream, transform_identity(), options);
+        }
+
+        /**
+         * \brief Reads an image from the stream using custom io
+         * transformation and read options.
+         */
+        template< typename istream, class transformation >
+        void read(istream& stream, transformation const& transform,
+                  read_options const& options)
+        {
+            detail::stats_scope total(this->get_io_stats(), detail::stats_total);
+            detail::trace_scope trace(*this, "read");
             reader< istream > rd(stream);
+            rd.set_io_stats(this->get_io_stats());
+            rd.set_trace(this->get_trace(), this->get_trace_id());
+            rd.set_options(options);
+
+            size_t pass_count;
+            char const* message;
+            switch (start_read(rd, transform, pass_count, message))
+            {
+            case error_none:
+                break;
+            case error_mismatch:
+                throw std::logic_error(message);
+            default:
+                throw error(message);
+            }
+
+            pixcon* pixel_con = static_cast< pixcon* >(this);
+            if (pass_count > 1 && !interlacing_supported)
+            {
+                std::vector< pixel > dummy_row(this->get_info().get_width());
+                skip_interlaced_rows(rd, pass_count, dummy_row);
+                pass_count = 1;
+            }
+            read_rows(rd, pass_count, pixel_con);
+
+            rd.read_end_info();
+        }
+
+        /**
+         * \brief Reads an image from the stream without throwing on
+         * corrupt data or stream errors.
+         *
+         * Returns error_none on success; otherwise the error is also
+         * recorded in \a status, along with the message.  Reusing one
+         * \a status for many images keeps failures free of
+         * allocations and of C++ exceptions: libpng errors longjmp()
+         * straight back here.  Exceptions thrown by the
+         * transformation or by the pixel %consumer (e.g. std::bad_alloc)
+         * still propagate.
+         *
+         * Interlace passes and row batches are not traced.
+         */
+        template< typename istream >
+        error_code try_read(istream& stream, error_status& status)
+        {
+            return try_read(stream, transform_identity(), read_options(),
+                            status);
+        }
+
+        /**
+         * \brief Reads an image from the stream using custom io
+         * transformation and read options without throwing on
+         * corrupt data or stream errors.
+         */
+        template< typename istream, class transformation >
+        error_code try_read(istream& stream, transformation const& transform,
+                            read_options const& options, error_status& status)
+        {
+#ifdef PNGPP_IO_STATS
+            detail::stats_mark total
+                = detail::stats_begin(this->get_io_stats());
+#endif
+            status.clear();
+            // allocated before the last setjmp() below: objects changed
+            // between setjmp() and longjmp() are indeterminate after it
+            std::vector< pixel > dummy_row;
+            reader< istream > rd(stream);
+            rd.set_io_stats(this->get_io_stats());
+            rd.set_trace(this->get_trace(), this->get_trace_id());
+            rd.set_error_status(& status);
+            rd.set_options(options);
+
+            // the reader methods below longjmp() here on errors
+            if (setjmp(png_jmpbuf(rd.get_png_struct())))
+            {
+                return status.get_code();
+            }
+            size_t pass_count;
+            char const* message;
+            error_code code = start_read(rd, transform, pass_count, message);
+            if (code != error_none)
+            {
+                status.set(code, message);
+                return code;
+            }
+
+            pixcon* pixel_con = static_cast< pixcon* >(this);
+            bool skip_passes = pass_count > 1 && !interlacing_supported;
+            if (skip_passes)
+            {
+                dummy_row.resize(this->get_info().get_width());
+            }
+            // errors from here on come back to this point, where
+            // dummy_row holds its final value
+            if (setjmp(png_jmpbuf(rd.get_png_struct())))
+            {
+                return status.get_code();
+            }
+            if (skip_passes)
+            {
+                skip_interlaced_rows(rd, pass_count, dummy_row);
+                pass_count = 1;
+            }
+
+            // not read_rows(): no object with a destructor may live
+            // across rd.read_row(), libpng may longjmp() out of it
+            io_stats* stats = this->get_io_stats();
+            for (size_t pass = 0; pass < pass_count; ++pass)
+            {
+                {
+                    detail::stats_scope hook(stats, detail::stats_hook);
+                    pixel_con->reset(pass);
+                }
+
+                for (uint_32 pos = 0; pos < this->get_info().get_height(); ++pos)
+                {
+                    byte* row;
+                    {
+                        detail::stats_scope hook(stats, detail::stats_hook);
+                        row = pixel_con->get_next_row(pos);
+                    }
+                    rd.read_row(row);
+                }
+
+                detail::stats_scope hook(stats, detail::stats_hook);
+                pixel_con->end_pass(pass);
+            }
+
+            rd.read_end_info();
+#ifdef PNGPP_IO_STATS
+            detail::stats_end(this->get_io_stats(), total, detail::stats_total);
+#endif
+            return error_none;
+        }
+
+    protected:
+        typedef streaming_base< pixel, info_holder > base;
+
+        /**
+         * \brief Constructs a consumer object using passed image_info
+         * object to store image information.
+         */
+        explicit consumer(image_info& info)
+            : base(info)
+        {
+        }
+
+    private:
+        /**
+         * \brief Reads the header, applies the transformation and
+         * checks the result matches the pixel type: the setup shared
+         * by read() and try_read().  Returns error_none and the
+         * number of passes to read, or the error and its message.
+         * libpng errors are left to the caller's setjmp() or to the
+         * reader methods.
+         */
+        template< typename istream, class transformation >
+        error_code start_read(reader< istream >& rd,
+                              transformation const& transform,
+                              size_t& pass_count, char const*& message)
+        {
             rd.read_info();
             transform(rd);
 
@@ -167,19 +358,20 @@ namespace png
 #ifdef PNG_READ_SWAP_SUPPORTED
                 rd.set_swap();
 #else
-                throw error("Cannot read 16-bit image: recompile with PNG_READ_SWAP_SUPPORTED.");
+                message = "Cannot read 16-bit image: recompile with PNG_READ_SWAP_SUPPORTED.";
+                return error_unsupported;
 #endif
             }
 #endif
 
             // interlace handling _must_ be set up prior to info update
-            size_t pass_count;
             if (rd.get_interlace_type() != interlace_none)
             {
 #ifdef PNG_READ_INTERLACING_SUPPORTED
                 pass_count = rd.set_interlace_handling();
 #else
-                throw error("Cannot read interlaced image: interlace handling disabled.");
+                message = "Cannot read interlaced image: interlace handling disabled.";
+                return error_unsupported;
 #endif
             }
             else
@@ -191,42 +383,24 @@ namespace png
             if (rd.get_color_type() != traits::get_color_type()
                 || rd.get_bit_depth() != traits::get_bit_depth())
             {
-                throw std::logic_error("color type and/or bit depth mismatch"
-                                       " in png::consumer::read()");
+                message = "color type and/or bit depth mismatch"
+                    " in png::consumer::read()";
+                return error_mismatch;
             }
 
             this->get_info() = rd.get_image_info();
-
-            pixcon* pixel_con = static_cast< pixcon* >(this);
-            if (pass_count > 1 && !interlacing_supported)
-            {
-                skip_interlaced_rows(rd, pass_count);
-                pass_count = 1;
-            }
-            read_rows(rd, pass_count, pixel_con);
-
-            rd.read_end_info();
+            return error_none;
         }
 
-    protected:
-        typedef streaming_base< pixel, info_holder > base;
-
         /**
-         * \brief Constructs a consumer object using passed image_info
-         * object to store image information.
+         * \brief Reads all the passes but the last into \a dummy_row,
+         * which must hold a row.
          */
-        explicit consumer(image_info& info)
-            : base(info)
-        {
-        }
-
-    private:
         template< typename istream >
-        void skip_interlaced_rows(reader< istream >& rd, size_t pass_count)
+        void skip_interlaced_rows(reader< istream >& rd, size_t pass_count,
+                                  std::vector< pixel >& dummy_row)
         {
-            typedef std::vector< pixel > row;
-            typedef row_traits< row > row_traits_type;
-            row dummy_row(this->get_info().get_width());
+            typedef row_traits< std::vector< pixel > > row_traits_type;
             for (size_t pass = 1; pass < pass_count; ++pass)
             {
                 rd.read_row(reinterpret_cast< byte* >
@@ -238,14 +412,31 @@ namespace png
         void read_rows(reader< istream >& rd, size_t pass_count,
                        pixcon* pixel_con)
         {
+            io_stats* stats = this->get_io_stats();
             for (size_t pass = 0; pass < pass_count; ++pass)
             {
-                pixel_con->reset(pass);
+                detail::trace_scope pass_trace(*this, "pass", long(pass));
+                {
+                    detail::stats_scope hook(stats, detail::stats_hook);
+                    pixel_con->reset(pass);
+                }
 
-                for (uint_32 pos = 0; pos < this->get_info().get_height(); ++pos)
                 {
-                    rd.read_row(pixel_con->get_next_row(pos));
+                    detail::trace_rows rows(*this, "read_rows", pass);
+                    for (uint_32 pos = 0; pos < this->get_info().get_height(); ++pos)
+                    {
+                        byte* row;
+                        {
+                            detail::stats_scope hook(stats, detail::stats_hook);
+                            row = pixel_con->get_next_row(pos);
+                        }
+                        rd.read_row(row);
+                        rows.row_done(pos);
+                    }
                 }
+
+                detail::stats_scope hook(stats, detail::stats_hook);
+                pixel_con->end_pass(pass);
             }
         }
     };
@@ -37,6 +37,7 @@
 #include "gray_pixel.hpp"
 #include "ga_pixel.hpp"
 #include "index_pixel.hpp"
+#include "expand_palette.hpp"
 #include "reader.hpp"
 #include "writer.hpp"
 
@@ -61,8 +62,11 @@ namespace png
             void operator()(reader& io) const
             {
                 handle_16(io);
-                handle_alpha(io, alpha_traits::get_alpha_filler());
-                handle_palette(io);
+                if (!handle_palette_lut(io))
+                {
+                    handle_alpha(io, alpha_traits::get_alpha_filler());
+                    handle_palette(io);
+                }
                 handle_rgb(io);
                 handle_gray(io);
 
@@ -80,7 +84,7 @@ namespace png
                 printf("<= ");
                 dump_row(row, row_info->rowbytes);
 #endif
-                for (uint_32 i = row_info->rowbytes; i-- > 0; )
+                for (png_size_t i = row_info->rowbytes; i-- > 0; )
                 {
                     row[2*i + 1] = row[i];
                     row[2*i + 0] = 0;
@@ -103,6 +107,57 @@ namespace png
             }
 #endif
 
+            static void expand_palette_row(png_struct* png,
+                                           png_row_info* row_info,
+                                           byte* row)
+            {
+                palette_lut const* lut = static_cast< palette_lut const* >
+                    (png_get_user_transform_ptr(png));
+                if (traits::get_channels() == 4)
+                {
+                    lut->expand_row(row, row_info->width, row_info->bit_depth,
+                                    reinterpret_cast< rgba_pixel* >(row));
+                }
+                else
+                {
+                    lut->expand_row(row, row_info->width, row_info->bit_depth,
+                                    reinterpret_cast< rgb_pixel* >(row));
+                }
+                row_info->color_type = traits::get_color_type();
+                row_info->channels = traits::get_channels();
+                row_info->bit_depth = 8;
+                row_info->pixel_depth = 8 * traits::get_channels();
+                row_info->rowbytes = row_info->width * traits::get_channels();
+            }
+
+            /**
+             * \brief Expands indexed rows straight to 8-bit RGB or
+             * RGBA with a palette_lut, in place of libpng palette and
+             * tRNS expansion.  The lookup table belongs to the reader,
+             * so the transformation itself stays stateless.
+             */
+            template< class reader >
+            static bool handle_palette_lut(reader& io)
+            {
+#ifdef PNG_READ_USER_TRANSFORM_SUPPORTED
+                if (io.get_color_type() == color_type_palette
+                    && traits::get_bit_depth() == 8
+                    && (traits::get_color_type() == color_type_rgb
+                        || traits::get_color_type() == color_type_rgba))
+                {
+                    palette_lut& lut = io.get_palette_lut();
+                    lut.assign(io.get_info().get_palette(),
+                               io.get_info().get_tRNS());
+                    io.set_read_user_transform(expand_palette_row);
+                    io.set_user_transform_info(& lut, 8,
+                                               traits::get_channels());
+                    io.get_info().drop_palette();
+                    return true;
+                }
+#endif
+                return false;
+            }
+
             template< class reader >
             static void handle_16(reader& io)
             {
@@ -175,7 +230,32 @@ namespace png
                 }
                 else if (!src_palette && dst_palette)
                 {
-                    throw error("conversion to indexed colors is unsupported (yet)");
+                    palette& plte = io.get_info().get_palette();
+                    if ((io.get_color_type() & ~color_mask_alpha)
+                        == color_type_gray)
+                    {
+                        // gray levels are used as indices into a gray
+                        // ramp, see also handle_rgb() and handle_gray()
+                        int bit_depth = io.get_bit_depth();
+                        if (bit_depth < 8)
+                        {
+#ifdef PNG_READ_PACK_SUPPORTED
+                            io.set_packing();
+#else
+                            throw error("cannot convert packed gray to indexed colors; recompile with PNG_READ_PACK_SUPPORTED");
+#endif
+                        }
+                        make_gray_palette(plte, bit_depth < 8 ? bit_depth : 8);
+                    }
+                    else
+                    {
+#ifdef PNG_READ_QUANTIZE_SUPPORTED
+                        make_color_cube_palette(plte);
+                        io.set_quantize(plte, (int) plte.size());
+#else
+                        throw error("conversion to indexed colors unsupported; recompile with PNG_READ_QUANTIZE_SUPPORTED");
+#endif
+                    }
                 }
                 else if (src_palette && dst_palette
                          && io.get_bit_depth() != traits::get_bit_depth())
@@ -193,12 +273,53 @@ namespace png
                 }
             }
 
+            /**
+             * \brief Fills \a plte with all the gray levels of the
+             * given bit depth.
+             */
+            static void make_gray_palette(palette& plte, int bit_depth)
+            {
+                size_t levels = size_t(1) << bit_depth;
+                plte.resize(levels);
+                for (size_t i = 0; i < levels; ++i)
+                {
+                    byte value = byte(i * 255 / (levels - 1));
+                    plte[i] = color(value, value, value);
+                }
+            }
+
+            /**
+             * \brief Fills \a plte with a uniform 6x7x6 color cube.
+             * Used when converting to indexed colors on the fly, since
+             * the pixels are not known in advance.  Use png::quantize()
+             * to obtain a palette adapted to the %image.
+             */
+            static void make_color_cube_palette(palette& plte)
+            {
+                plte.clear();
+                plte.reserve(6 * 7 * 6);
+                for (int r = 0; r < 6; ++r)
+                {
+                    for (int g = 0; g < 7; ++g)
+                    {
+                        for (int b = 0; b < 6; ++b)
+                        {
+                            plte.push_back(color(r * 255 / 5,
+                                                 g * 255 / 6,
+                                                 b * 255 / 5));
+                        }
+                    }
+                }
+            }
+
             template< class reader >
             static void handle_rgb(reader& io)
             {
                 bool src_rgb =
                     io.get_color_type() & (color_mask_rgb | color_mask_palette);
                 bool dst_rgb = traits::get_color_type() & color_mask_rgb;
+                bool dst_palette =
+                    traits::get_color_type() == color_type_palette;
                 if (src_rgb && !dst_rgb)
                 {
 #ifdef PNG_READ_RGB_TO_GRAY_SUPPORTED
@@ -207,7 +328,7 @@ namespace png
                     throw error("grayscale data expected; recompile with PNG_READ_RGB_TO_GRAY_SUPPORTED");
 #endif
                 }
-                if (!src_rgb && dst_rgb)
+                if (!src_rgb && dst_rgb && !dst_palette)
                 {
 #ifdef PNG_READ_GRAY_TO_RGB_SUPPORTED
                     io.set_gray_to_rgb();
@@ -223,7 +344,8 @@ namespace png
                 if ((io.get_color_type() & ~color_mask_alpha)
                     == color_type_gray)
                 {
-                    if (io.get_bit_depth() < 8 && traits::get_bit_depth() >= 8)
+                    if (io.get_bit_depth() < 8 && traits::get_bit_depth() >= 8
+                        && traits::get_color_type() != color_type_palette)
                     {
 #ifdef PNG_READ_EXPAND_SUPPORTED
                         io.set_gray_1_2_4_to_8();
@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_DECODE_SERVICE_HPP_INCLUDED
+#define PNGPP_DECODE_SERVICE_HPP_INCLUDED
+
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "image.hpp"
+#include "memory_stream.hpp"
+#include "read_options.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace png
+{
+
+    namespace detail
+    {
+
+        /**
+         * \brief A bounded multi-producer multi-consumer queue which
+         * pushes and pops without locks (D. Vyukov's algorithm).
+         *
+         * Every cell carries a sequence number telling whether it is
+         * free for the push of a given round or holds the value for
+         * the pop of that round; producers and consumers claim
+         * positions with a compare-and-swap.  The capacity is rounded
+         * up to a power of two.
+         */
+        template< typename value_type >
+        class mpmc_queue
+        {
+        public:
+            explicit mpmc_queue(size_t capacity)
+                : m_cells(round_up(capacity)),
+                  m_mask(m_cells.size() - 1),
+                  m_push_pos(0),
+                  m_pop_pos(0)
+            {
+                for (size_t i = 0; i < m_cells.size(); ++i)
+                {
+                    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * \brief Appends \a value, returns \c false if the queue
+             * is full.
+             */
+            bool try_push(value_type const& value)
+            {
+                size_t pos = m_push_pos.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    cell& c = m_cells[pos & m_mask];
+                    size_t seq = c.sequence.load(std::memory_order_acquire);
+                    std::ptrdiff_t diff = std::ptrdiff_t(seq)
+                        - std::ptrdiff_t(pos);
+                    if (diff == 0)
+                    {
+                        if (m_push_pos.compare_exchange_weak
+                            (pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            c.value = value;
+                            c.sequence.store(pos + 1,
+                                             std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        pos = m_push_pos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            /**
+             * \brief Removes the oldest value into \a value, returns
+             * \c false if the queue is empty.
+             */
+            bool try_pop(value_type& value)
+            {
+                size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    cell& c = m_cells[pos & m_mask];
+                    size_t seq = c.sequence.load(std::memory_order_acquire);
+                    std::ptrdiff_t diff = std::ptrdiff_t(seq)
+                        - std::ptrdiff_t(pos + 1);
+                    if (diff == 0)
+                    {
+                        if (m_pop_pos.compare_exchange_weak
+                            (pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            value = c.value;
+                            c.sequence.store(pos + m_mask + 1,
+                                             std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        pos = m_pop_pos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+        private:
+            mpmc_queue(mpmc_queue const&);
+            mpmc_queue& operator=(mpmc_queue const&);
+
+            struct cell
+            {
+                std::atomic< size_t > sequence;
+                value_type value;
+            };
+
+            static size_t round_up(size_t capacity)
+            {
+                size_t size = 2;
+                while (size < capacity)
+                {
+                    size *= 2;
+                }
+                return size;
+            }
+
+            std::vector< cell > m_cells;
+            size_t const m_mask;
+            // on separate cache lines, producers and consumers do not
+            // contend
+            char m_pad0[64];
+            std::atomic< size_t > m_push_pos;
+            char m_pad1[64];
+            std::atomic< size_t > m_pop_pos;
+            char m_pad2[64];
+        };
+
+    } // namespace detail
+
+    /**
+     * \brief The outcome of decoding an %image with decode_service.
+     */
+    template< class image_type >
+    struct decode_result
+    {
+        decode_result()
+            : code(error_none)
+        {
+        }
+
+        /// error_none on success
+        error_code code;
+        /// the error message, if any
+        std::string message;
+        /// the decoded %image, empty on failure
+        image_type image;
+    };
+
+    /**
+     * \brief Decodes images on a pool of worker threads.
+     *
+     * Jobs are queued with decode_file() or decode_data() and
+     * complete either a std::future or a callback, which is called on
+     * the worker thread.  The queue is a lock-free bounded MPMC queue;
+     * submitting blocks (yielding) while it is full.  Idle workers
+     * sleep and are woken when jobs arrive.  The destructor finishes
+     * all queued jobs and joins the workers.
+     *
+     * Every worker keeps its own error_status and file buffer, which
+     * are reused across jobs: files are read whole into the buffer
+     * and decoded from memory with image::try_read(), so corrupt
+     * input costs no exceptions and no allocations beyond the
+     * result's message.  libpng does not support resetting a read
+     * struct, so one is still created per %image.
+     *
+     * Any number of threads may submit jobs concurrently.  In
+     * general, png++ objects may be used on different threads as
+     * long as no object is used by two threads at a time; libpng
+     * keeps all decoding state in its per-%image structs.
+     *
+     * Exceptions other than decoding errors (e.g. std::bad_alloc for
+     * huge dimensions) are reported as error_format with their
+     * message.  Callbacks must not throw; exceptions escaping them
+     * are ignored.
+     */
+    template< typename pixel, typename pixel_buffer_type = pixel_buffer< pixel > >
+    class decode_service
+    {
+    public:
+        typedef image< pixel, pixel_buffer_type > image_type;
+        typedef decode_result< image_type > result_type;
+        typedef std::function< void (result_type&) > callback;
+
+        /**
+         * \brief Starts \a thread_count workers (one per hardware
+         * thread if zero) accepting up to \a queue_capacity pending
+         * jobs.
+         */
+        explicit decode_service(size_t thread_count = 0,
+                                size_t queue_capacity = 1024)
+            : m_queue(queue_capacity),
+              m_pending(0),
+              m_sleeping(0),
+              m_stop(false)
+        {
+            if (thread_count == 0)
+            {
+                thread_count = std::thread::hardware_concurrency();
+            }
+            if (thread_count == 0)
+            {
+                thread_count = 1;
+            }
+            try
+            {
+                for (size_t i = 0; i < thread_count; ++i)
+                {
+                    m_workers.push_back(std::thread(& decode_service::work,
+                                                    this));
+                }
+            }
+            catch (...)
+            {
+                shutdown();
+                throw;
+            }
+        }
+
+        ~decode_service()
+        {
+            shutdown();
+        }
+
+        size_t get_thread_count() const
+        {
+            return m_workers.size();
+        }
+
+        /**
+         * \brief Queues decoding of the file \a filename.
+         */
+        std::future< result_type >
+        decode_file(std::string const& filename,
+                    read_options const& options = read_options())
+        {
+            std::shared_ptr< std::promise< result_type > >
+                promise(new std::promise< result_type >());
+            std::future< result_type > future = promise->get_future();
+            decode_file(filename, fulfill(promise), options);
+            return future;
+        }
+
+        /**
+         * \brief Queues decoding of the file \a filename, calling \a
+         * done with the result on the worker thread.
+         */
+        void decode_file(std::string const& filename, callback const& done,
+                         read_options const& options = read_options())
+        {
+            submit(new job(filename, std::string(), options, done));
+        }
+
+        /**
+         * \brief Queues decoding of the PNG data \a png (copied).
+         */
+        std::future< result_type >
+        decode_data(std::string const& png,
+                    read_options const& options = read_options())
+        {
+            std::shared_ptr< std::promise< result_type > >
+                promise(new std::promise< result_type >());
+            std::future< result_type > future = promise->get_future();
+            decode_data(png, fulfill(promise), options);
+            return future;
+        }
+
+        /**
+         * \brief Queues decoding of the PNG data \a png (copied),
+         * calling \a done with the result on the worker thread.
+         */
+        void decode_data(std::string const& png, callback const& done,
+                         read_options const& options = read_options())
+        {
+            submit(new job(std::string(), png, options, done));
+        }
+
+    private:
+        decode_service(decode_service const&);
+        decode_service& operator=(decode_service const&);
+
+        struct job
+        {
+            job(std::string const& file, std::string const& png,
+                read_options const& opts, callback const& callback_fn)
+                : filename(file),
+                  data(png),
+                  options(opts),
+                  done(callback_fn)
+            {
+            }
+
+            std::string filename;
+            std::string data;
+            read_options options;
+            callback done;
+        };
+
+        /**
+         * \brief State a worker reuses across jobs.
+         */
+        struct worker_state
+        {
+            error_status status;
+            std::string buffer;
+        };
+
+        static callback
+        fulfill(std::shared_ptr< std::promise< result_type > > const& promise)
+        {
+            return [promise](result_type& result)
+            {
+                promise->set_value(std::move(result));
+            };
+        }
+
+        void submit(job* new_job)
+        {
+            ++m_pending;
+            while (!m_queue.try_push(new_job))
+            {
+                std::this_thread::yield();
+            }
+            if (m_sleeping.load() != 0)
+            {
+                std::lock_guard< std::mutex > lock(m_mutex);
+                m_wake.notify_one();
+            }
+        }
+
+        void work()
+        {
+            worker_state state;
+            for (;;)
+            {
+                job* next = 0;
+                if (m_queue.try_pop(next))
+                {
+                    --m_pending;
+                    run(*next, state);
+                    delete next;
+                    continue;
+                }
+
+                std::unique_lock< std::mutex > lock(m_mutex);
+                ++m_sleeping;
+                // submit() raises m_pending before it reads
+                // m_sleeping, so a new job is either seen here or
+                // notified under the lock
+                while (!m_stop && m_pending.load() == 0)
+                {
+                    m_wake.wait(lock);
+                }
+                --m_sleeping;
+                if (m_stop && m_pending.load() == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        static void run(job& task, worker_state& state)
+        {
+            result_type result;
+            try
+            {
+                decode(task, state, result);
+            }
+            catch (std::exception const& ex)
+            {
+                result.code = error_format;
+                result.message = ex.what();
+            }
+            try
+            {
+                task.done(result);
+            }
+            catch (...)
+            {
+            }
+        }
+
+        static void decode(job& task, worker_state& state, result_type& result)
+        {
+            std::string const* png = & task.data;
+            if (!task.filename.empty())
+            {
+                if (!load(task.filename, state.buffer))
+                {
+                    result.code = error_stream;
+                    result.message = std_error(task.filename).what();
+                    return;
+                }
+                png = & state.buffer;
+            }
+            detail::memory_streambuf buffer(reinterpret_cast< byte const* >
+                                            (png->data()), png->size());
+            std::istream stream(& buffer);
+            result.code = result.image.try_read(stream, task.options,
+                                                state.status);
+            if (result.code != error_none)
+            {
+                result.message = state.status.get_message();
+                result.image = image_type();
+            }
+        }
+
+        /**
+         * \brief Reads a whole file into \a buffer, keeping its
+         * capacity.
+         */
+        static bool load(std::string const& filename, std::string& buffer)
+        {
+            std::ifstream file(filename.c_str(), std::ios::binary);
+            if (!file.is_open())
+            {
+                return false;
+            }
+            file.seekg(0, std::ios::end);
+            std::streamoff size = file.tellg();
+            file.seekg(0, std::ios::beg);
+            if (size < 0 || !file)
+            {
+                return false;
+            }
+            buffer.resize(size_t(size));
+            if (size != 0)
+            {
+                file.read(& buffer[0], size);
+            }
+            return !file.fail();
+        }
+
+        void shutdown()
+        {
+            {
+                std::lock_guard< std::mutex > lock(m_mutex);
+                m_stop = true;
+                m_wake.notify_all();
+            }
+            for (size_t i = 0; i < m_workers.size(); ++i)
+            {
+                m_workers[i].join();
+            }
+            m_workers.clear();
+        }
+
+        detail::mpmc_queue< job* > m_queue;
+        std::atomic< size_t > m_pending;
+        std::atomic< size_t > m_sleeping;
+        bool m_stop;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::vector< std::thread > m_workers;
+    };
+
+} // namespace png
+
+#endif // PNGPP_HAS_STD_THREAD
+
+#endif // PNGPP_DECODE_SERVICE_HPP_INCLUDED
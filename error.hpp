@@ -106,6 +106,81 @@ namespace png
         }
     };
 
+    /**
+     * \brief Kinds of errors reported by the non-throwing reading
+     * functions.
+     *
+     * \see error_status, image::try_read(), consumer::try_read()
+     */
+    enum error_code
+    {
+        /// no error
+        error_none,
+        /// the stream could not be opened, read or written
+        error_stream,
+        /// the PNG data is corrupt or truncated (reported by libpng)
+        error_format,
+        /// the %image does not have the color type and bit depth
+        /// expected after the transformations
+        error_mismatch,
+        /// libpng was built without a feature the %image requires
+        error_unsupported
+    };
+
+    /**
+     * \brief The outcome of a non-throwing operation: an error_code
+     * and a message.
+     *
+     * The message is kept in a fixed buffer (truncated if longer),
+     * so reporting an error allocates nothing.  Reuse one object for
+     * many operations to avoid any allocation on failure.
+     */
+    class error_status
+    {
+    public:
+        static size_t const message_size = 256;
+
+        error_status()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            m_code = error_none;
+            m_message[0] = '\0';
+        }
+
+        /**
+         * \brief Records an error, copying \a message.
+         */
+        void set(error_code code, char const* message)
+        {
+            m_code = code;
+            strncpy(m_message, message, message_size - 1);
+            m_message[message_size - 1] = '\0';
+        }
+
+        bool is_ok() const
+        {
+            return m_code == error_none;
+        }
+
+        error_code get_code() const
+        {
+            return m_code;
+        }
+
+        char const* get_message() const
+        {
+            return m_message;
+        }
+
+    private:
+        error_code m_code;
+        char m_message[message_size];
+    };
+
 } // namespace png
 
 #endif // PNGPP_ERROR_HPP_INCLUDED
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_EXPAND_PALETTE_HPP_INCLUDED
+#define PNGPP_EXPAND_PALETTE_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+#include "error.hpp"
+#include "palette.hpp"
+#include "tRNS.hpp"
+#include "rgb_pixel.hpp"
+#include "rgba_pixel.hpp"
+#include "index_pixel.hpp"
+#include "pixel_buffer.hpp"
+
+namespace png
+{
+
+    template< typename pixel, typename pixel_buffer_type > class image;
+
+    /**
+     * \brief The 256-entry lookup table used to expand indexed pixels
+     * to RGB or RGBA.
+     *
+     * The table combines the palette with the tRNS chunk, so that an
+     * indexed pixel expands with a single lookup.  Indices beyond the
+     * end of the palette expand to opaque black, as they do in libpng.
+     *
+     * Rows are expanded from the last pixel to the first, so the
+     * source and the target row may start at the same address: this
+     * is how convert_color_space expands rows in place while reading.
+     *
+     * \see expand_palette(), convert_color_space
+     */
+    class palette_lut
+    {
+    public:
+        /**
+         * \brief Constructs a table of opaque black entries.
+         */
+        palette_lut()
+        {
+            assign(palette(), tRNS());
+        }
+
+        palette_lut(palette const& plte, tRNS const& trns)
+        {
+            assign(plte, trns);
+        }
+
+        /**
+         * \brief Rebuilds the table from the palette and the tRNS
+         * transparency map.  Entries not covered by \a trns are
+         * opaque.
+         */
+        void assign(palette const& plte, tRNS const& trns)
+        {
+            for (size_t i = 0; i < 256; ++i)
+            {
+                color c = i < plte.size() ? plte[i] : color();
+                m_rgb[i] = rgb_pixel(c.red, c.green, c.blue);
+                m_rgba[i] = rgba_pixel(c.red, c.green, c.blue,
+                                       i < trns.size() ? trns[i] : 255);
+            }
+        }
+
+        rgba_pixel const& operator[](size_t index) const
+        {
+            return m_rgba[index];
+        }
+
+        /**
+         * \brief Expands a row of \a width indices stored with \a
+         * bit_depth bits per pixel (1, 2, 4 or 8) to RGBA pixels.
+         */
+        void expand_row(byte const* row, size_t width, int bit_depth,
+                        rgba_pixel* pixels) const
+        {
+            expand_row(m_rgba, row, width, bit_depth, pixels);
+        }
+
+        /**
+         * \brief Expands a row of \a width indices stored with \a
+         * bit_depth bits per pixel (1, 2, 4 or 8) to RGB pixels.
+         * The tRNS chunk is ignored.
+         */
+        void expand_row(byte const* row, size_t width, int bit_depth,
+                        rgb_pixel* pixels) const
+        {
+            expand_row(m_rgb, row, width, bit_depth, pixels);
+        }
+
+    private:
+        template< typename pixel >
+        static void expand_row(pixel const* lut, byte const* row,
+                               size_t width, int bit_depth, pixel* pixels)
+        {
+            switch (bit_depth)
+            {
+            case 1:
+                expand_packed< 1 >(lut, row, width, pixels);
+                break;
+            case 2:
+                expand_packed< 2 >(lut, row, width, pixels);
+                break;
+            case 4:
+                expand_packed< 4 >(lut, row, width, pixels);
+                break;
+            case 8:
+                for (size_t i = width; i-- > 0; )
+                {
+                    pixels[i] = lut[row[i]];
+                }
+                break;
+            default:
+                throw error("palette_lut: bit depth should be 1, 2, 4 or 8");
+            }
+        }
+
+        /**
+         * \brief Expands packed pixels, the leftmost pixel being in
+         * the high-order bits of a byte.
+         */
+        template< int bits, typename pixel >
+        static void expand_packed(pixel const* lut, byte const* row,
+                                  size_t width, pixel* pixels)
+        {
+            size_t const per_byte = 8 / bits;
+            int const mask = (1 << bits) - 1;
+
+            // the trailing partial byte first, then whole bytes
+            size_t i = width;
+            size_t tail = width % per_byte;
+            if (tail)
+            {
+                byte value = row[width / per_byte];
+                while (tail-- > 0)
+                {
+                    --i;
+                    pixels[i] = lut[(value >> (8 - bits * (tail + 1))) & mask];
+                }
+            }
+            while (i > 0)
+            {
+                byte value = row[i / per_byte - 1];
+                for (size_t k = 0; k < per_byte; ++k)
+                {
+                    --i;
+                    pixels[i] = lut[value & mask];
+                    value >>= bits;
+                }
+            }
+        }
+
+        rgb_pixel m_rgb[256];
+        rgba_pixel m_rgba[256];
+    };
+
+    namespace detail
+    {
+
+        template< typename pixel >
+        byte const* get_row_bytes(std::vector< pixel > const& row)
+        {
+            return reinterpret_cast< byte const* >(& row[0]);
+        }
+
+        template< typename pixel >
+        byte const* get_row_bytes(packed_pixel_row< pixel > const& row)
+        {
+            return row.get_data();
+        }
+
+        template< typename pixel >
+        byte const* get_row_bytes(pixel const* row)
+        {
+            return reinterpret_cast< byte const* >(row);
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief Expands an indexed %image to RGB or RGBA using its
+     * palette and tRNS chunk.
+     *
+     * The source %image may hold 8-bit index_pixel or packed 1-, 2-
+     * or 4-bit pixels, the target should hold rgb_pixel or
+     * rgba_pixel.
+     */
+    template< typename src_pixel, class src_pixbuf,
+              typename dst_pixel, class dst_pixbuf >
+    void expand_palette(image< src_pixel, src_pixbuf > const& src,
+                        image< dst_pixel, dst_pixbuf >& dst)
+    {
+        palette_lut lut(src.get_palette(), src.get_tRNS());
+        size_t width = src.get_width();
+        dst.resize(src.get_width(), src.get_height());
+        if (width == 0)
+        {
+            return;
+        }
+        int bit_depth = pixel_traits< src_pixel >::get_bit_depth();
+        for (size_t y = 0; y < src.get_height(); ++y)
+        {
+            lut.expand_row(detail::get_row_bytes(src[y]), width, bit_depth,
+                           & dst[y][0]);
+        }
+    }
+
+} // namespace png
+
+#endif // PNGPP_EXPAND_PALETTE_HPP_INCLUDED
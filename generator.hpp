@@ -128,8 +128,23 @@ namespace png
         template< typename ostream >
         void write(ostream& stream)
         {
+            write(stream, write_options());
+        }
+
+        /**
+         * \brief Writes an image to the stream using the compression
+         * settings made in \a options.
+         */
+        template< typename ostream >
+        void write(ostream& stream, write_options const& options)
+        {
+            detail::stats_scope total(this->get_io_stats(), detail::stats_total);
+            detail::trace_scope trace(*this, "write");
             writer< ostream > wr(stream);
+            wr.set_io_stats(this->get_io_stats());
+            wr.set_trace(this->get_trace(), this->get_trace_id());
             wr.set_image_info(this->get_info());
+            wr.set_options(options);
             wr.write_info();
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -164,13 +179,25 @@ namespace png
                 pass_count = 1;
             }
             pixgen* pixel_gen = static_cast< pixgen* >(this);
+            io_stats* stats = this->get_io_stats();
             for (size_t pass = 0; pass < pass_count; ++pass)
             {
-                pixel_gen->reset(pass);
+                detail::trace_scope pass_trace(*this, "pass", long(pass));
+                {
+                    detail::stats_scope hook(stats, detail::stats_hook);
+                    pixel_gen->reset(pass);
+                }
 
+                detail::trace_rows rows(*this, "compress_rows", pass);
                 for (uint_32 pos = 0; pos < this->get_info().get_height(); ++pos)
                 {
-                    wr.write_row(pixel_gen->get_next_row(pos));
+                    byte* row;
+                    {
+                        detail::stats_scope hook(stats, detail::stats_hook);
+                        row = pixel_gen->get_next_row(pos);
+                    }
+                    wr.write_row(row);
+                    rows.row_done(pos);
                 }
             }
 
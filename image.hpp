@@ -36,6 +36,7 @@
 #include "generator.hpp"
 #include "consumer.hpp"
 #include "convert_color_space.hpp"
+#include "optimizer.hpp"
 
 namespace png
 {
@@ -60,6 +61,8 @@ namespace png
      */
     template< typename pixel, typename pixel_buffer_type = pixel_buffer< pixel > >
     class image
+        : public io_stats_holder,
+          public trace_holder
     {
     public:
         /**
@@ -187,6 +190,26 @@ namespace png
             read(filename.c_str(), transform);
         }
 
+        /**
+         * \brief Reads an image from specified file using default
+         * converting transform and custom read options.
+         */
+        void read(std::string const& filename, read_options const& options)
+        {
+            read(filename.c_str(), transform_convert(), options);
+        }
+
+        /**
+         * \brief Reads an image from specified file using custom
+         * transformaton and read options.
+         */
+        template< class transformation >
+        void read(std::string const& filename, transformation const& transform,
+                  read_options const& options)
+        {
+            read(filename.c_str(), transform, options);
+        }
+
         /**
          * \brief Reads an image from specified file using default
          * converting transform.
@@ -202,6 +225,26 @@ namespace png
          */
         template< class transformation >
         void read(char const* filename, transformation const& transform)
+        {
+            read(filename, transform, read_options());
+        }
+
+        /**
+         * \brief Reads an image from specified file using default
+         * converting transform and custom read options.
+         */
+        void read(char const* filename, read_options const& options)
+        {
+            read(filename, transform_convert(), options);
+        }
+
+        /**
+         * \brief Reads an image from specified file using custom
+         * transformaton and read options.
+         */
+        template< class transformation >
+        void read(char const* filename, transformation const& transform,
+                  read_options const& options)
         {
             std::ifstream stream(filename, std::ios::binary);
             if (!stream.is_open())
@@ -209,7 +252,57 @@ namespace png
                 throw std_error(filename);
             }
             stream.exceptions(std::ios::badbit);
-            read_stream(stream, transform);
+            read(stream, transform, options);
+        }
+
+        /**
+         * \brief Reads an image from specified file without throwing
+         * on corrupt data or I/O errors.
+         *
+         * Returns error_none on success, otherwise the error recorded
+         * in \a status.  Reuse \a status to keep failures free of
+         * allocations and exceptions.
+         *
+         * \see consumer::try_read()
+         */
+        error_code try_read(std::string const& filename, error_status& status)
+        {
+            return try_read(filename.c_str(), read_options(), status);
+        }
+
+        error_code try_read(char const* filename, error_status& status)
+        {
+            return try_read(filename, read_options(), status);
+        }
+
+        error_code try_read(char const* filename, read_options const& options,
+                            error_status& status)
+        {
+            std::ifstream stream(filename, std::ios::binary);
+            if (!stream.is_open())
+            {
+                status.set(error_stream, filename);
+                return error_stream;
+            }
+            return try_read(stream, options, status);
+        }
+
+        /**
+         * \brief Reads an image from a stream without throwing on
+         * corrupt data or I/O errors.
+         */
+        error_code try_read(std::istream& stream, error_status& status)
+        {
+            return try_read(stream, read_options(), status);
+        }
+
+        error_code try_read(std::istream& stream, read_options const& options,
+                            error_status& status)
+        {
+            pixel_consumer pixcon(m_info, m_pixbuf);
+            pixcon.set_io_stats(get_io_stats());
+            pixcon.set_trace(get_trace(), get_trace_id());
+            return pixcon.try_read(stream, transform_convert(), options, status);
         }
 
         /**
@@ -231,6 +324,29 @@ namespace png
             read_stream(stream, transform);
         }
 
+        /**
+         * \brief Reads an image from a stream using default
+         * converting transform and custom read options.
+         */
+        void read(std::istream& stream, read_options const& options)
+        {
+            read(stream, transform_convert(), options);
+        }
+
+        /**
+         * \brief Reads an image from a stream using custom
+         * transformation and read options.
+         */
+        template< class transformation >
+        void read(std::istream& stream, transformation const& transform,
+                  read_options const& options)
+        {
+            pixel_consumer pixcon(m_info, m_pixbuf);
+            pixcon.set_io_stats(get_io_stats());
+            pixcon.set_trace(get_trace(), get_trace_id());
+            pixcon.read(stream, transform, options);
+        }
+
         /**
          * \brief Reads an image from a stream using default
          * converting transform.
@@ -249,6 +365,32 @@ namespace png
         void read_stream(istream& stream, transformation const& transform)
         {
             pixel_consumer pixcon(m_info, m_pixbuf);
+            pixcon.set_io_stats(get_io_stats());
+            pixcon.set_trace(get_trace(), get_trace_id());
+            pixcon.read(stream, transform);
+        }
+
+        /**
+         * \brief Reads an image from a stream using custom io
+         * transformation, calling \a observer after each pass of an
+         * interlaced %image.
+         *
+         * The \a observer is called as <tt>observer(pass)</tt> once
+         * all rows of the pass were read.  At that point the image
+         * holds the pixels of the passes read so far, at their final
+         * positions; adam7::fill_preview() makes a displayable preview
+         * out of them.  For non-interlaced images \a observer is
+         * called once, with pass 0, after the whole image was read.
+         */
+        template< class istream, class transformation, class observer >
+        void read_stream(istream& stream, transformation const& transform,
+                         observer& pass_observer)
+        {
+            pixel_consumer pixcon(m_info, m_pixbuf);
+            pixcon.set_io_stats(get_io_stats());
+            pixcon.set_trace(get_trace(), get_trace_id());
+            pixcon.set_pass_callback(& notify_observer< observer >,
+                                     & pass_observer);
             pixcon.read(stream, transform);
         }
 
@@ -274,6 +416,30 @@ namespace png
             write_stream(stream);
         }
 
+        /**
+         * \brief Writes an image to specified file using custom
+         * compression settings, e.g. \c write_mode_realtime.
+         */
+        void write(std::string const& filename, write_options const& options)
+        {
+            write(filename.c_str(), options);
+        }
+
+        /**
+         * \brief Writes an image to specified file using custom
+         * compression settings.
+         */
+        void write(char const* filename, write_options const& options)
+        {
+            std::ofstream stream(filename, std::ios::binary);
+            if (!stream.is_open())
+            {
+                throw std_error(filename);
+            }
+            stream.exceptions(std::ios::badbit);
+            write_stream(stream, options);
+        }
+
         /**
          * \brief Writes an image to a stream.
          */
@@ -281,9 +447,61 @@ namespace png
         void write_stream(ostream& stream)
         {
             pixel_generator pixgen(m_info, m_pixbuf);
+            pixgen.set_io_stats(get_io_stats());
+            pixgen.set_trace(get_trace(), get_trace_id());
             pixgen.write(stream);
         }
 
+        /**
+         * \brief Writes an image to a stream using custom compression
+         * settings.
+         */
+        template< class ostream >
+        void write_stream(ostream& stream, write_options const& options)
+        {
+            pixel_generator pixgen(m_info, m_pixbuf);
+            pixgen.set_io_stats(get_io_stats());
+            pixgen.set_trace(get_trace(), get_trace_id());
+            pixgen.write(stream, options);
+        }
+
+        /**
+         * \brief Writes an image to specified file using the smallest
+         * lossless encoding found.
+         *
+         * \see optimizer
+         */
+        void write_optimized(std::string const& filename)
+        {
+            write_optimized(filename.c_str());
+        }
+
+        /**
+         * \brief Writes an image to specified file using the smallest
+         * lossless encoding found.
+         */
+        void write_optimized(char const* filename)
+        {
+            std::ofstream stream(filename, std::ios::binary);
+            if (!stream.is_open())
+            {
+                throw std_error(filename);
+            }
+            stream.exceptions(std::ios::badbit);
+            write_optimized_stream(stream);
+        }
+
+        /**
+         * \brief Writes an image to a stream using the smallest
+         * lossless encoding found.
+         */
+        template< class ostream >
+        void write_optimized_stream(ostream& stream)
+        {
+            optimizer< pixel, pixbuf > opt(m_info, m_pixbuf);
+            opt.write(stream);
+        }
+
         /**
          * \brief Returns a reference to image pixel buffer.
          */
@@ -504,14 +722,24 @@ namespace png
                                                /* interlacing = */ true > >
         {
         public:
+            typedef void (*pass_callback)(void* context, size_t pass);
+
             pixel_consumer(image_info& info, pixbuf& pixels)
                 : streaming_impl< consumer< pixel,
                                             pixel_consumer,
                                             image_info_ref_holder,
-                                            true > >(info, pixels)
+                                            true > >(info, pixels),
+                  m_callback(0),
+                  m_context(0)
             {
             }
 
+            void set_pass_callback(pass_callback callback, void* context)
+            {
+                m_callback = callback;
+                m_context = context;
+            }
+
             void reset(size_t pass)
             {
                 if (pass == 0)
@@ -520,8 +748,26 @@ namespace png
                                           this->get_info().get_height());
                 }
             }
+
+            void end_pass(size_t pass)
+            {
+                if (m_callback)
+                {
+                    m_callback(m_context, pass);
+                }
+            }
+
+        private:
+            pass_callback m_callback;
+            void* m_context;
         };
 
+        template< class observer >
+        static void notify_observer(void* context, size_t pass)
+        {
+            (*static_cast< observer* >(context))(pass);
+        }
+
         /**
          * \brief The pixel buffer adapter for writing pixel data.
          */
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_IMAGE_CACHE_HPP_INCLUDED
+#define PNGPP_IMAGE_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdio>
+#include <istream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "image.hpp"
+#include "memory_stream.hpp"
+#include "solid_pixel_buffer.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace png
+{
+
+    /**
+     * \brief A process-wide cache of decoded images with a memory
+     * budget.
+     *
+     * get() returns the %image decoded from a file, keyed by its path;
+     * the entry also records the modification time (in nanoseconds
+     * where the system provides them) and size of the file, so that a
+     * changed file is decoded again and replaces its old entry.
+     * get_data() returns the %image decoded from PNG data in
+     * memory, keyed by a 64-bit FNV-1a hash and the size of the data;
+     * the entry keeps a copy of the data, which a hit must match, so
+     * that colliding data is never served the wrong %image.
+     * Images are kept in solid_pixel_buffer objects shared as
+     * immutable std::shared_ptr: a hit copies nothing, and an evicted
+     * %image stays valid for as long as someone holds it.
+     *
+     * The cache is split into shards, each with its own lock and LRU
+     * list, so that threads looking up different images rarely
+     * contend.  The budget is shared: a single %image may take all of
+     * it, and going over it evicts the least recently used entries of
+     * all shards.  Decoding happens outside the lock; two threads
+     * missing the same key at once both decode it and the first one
+     * to finish is kept.  Images larger than the whole budget are
+     * returned but not cached.
+     *
+     * Decoding errors are thrown as by image::read().
+     */
+    template< typename pixel >
+    class image_cache
+    {
+    public:
+        typedef image< pixel, solid_pixel_buffer< pixel > > image_type;
+        typedef std::shared_ptr< image_type const > image_ptr;
+
+        /**
+         * \brief Creates a cache holding up to \a budget bytes of
+         * pixel data (and of PNG data kept by get_data()) in \a
+         * shard_count shards.  Any single %image up to \a budget
+         * bytes is cached, whatever the shard count.
+         */
+        explicit image_cache(size_t budget, size_t shard_count = 16)
+            : m_shards(shard_count ? shard_count : 1),
+              m_budget(budget),
+              m_size(0),
+              m_tick(0),
+              m_hits(0),
+              m_misses(0),
+              m_evictions(0)
+        {
+        }
+
+        /**
+         * \brief Returns the %image in the file \a filename, decoding
+         * it if it is not cached or has changed.  The file is read
+         * into memory before it is decoded.
+         */
+        image_ptr get(std::string const& filename)
+        {
+            // the version is taken from the file as opened here before
+            // its contents are read, so a rewrite in between shows up
+            // as a newer version on the next get() instead of leaving
+            // the new pixels cached under the old version
+            std::FILE* file = std::fopen(filename.c_str(), "rb");
+            if (!file)
+            {
+                throw std_error(filename);
+            }
+            struct stat status;
+            if (fstat(fileno(file), & status) != 0)
+            {
+                std::fclose(file);
+                throw std_error(filename);
+            }
+            char version[64];
+            std::sprintf(version, "%lld.%09ld:%lld",
+                         (long long) status.st_mtime,
+                         get_mtime_nsec(status), (long long) status.st_size);
+            std::string key = "file:" + filename;
+
+            image_ptr cached = find(key, version);
+            if (cached)
+            {
+                std::fclose(file);
+                return cached;
+            }
+            std::string png;
+            try
+            {
+                png.resize(size_t(status.st_size));
+                if (!png.empty())
+                {
+                    png.resize(std::fread(& png[0], 1, png.size(), file));
+                }
+                if (std::ferror(file))
+                {
+                    throw std_error(filename);
+                }
+            }
+            catch (...)
+            {
+                std::fclose(file);
+                throw;
+            }
+            std::fclose(file);
+            return insert(key, version, decode(png));
+        }
+
+        /**
+         * \brief Returns the %image decoded from the PNG data \a png.
+         */
+        image_ptr get_data(std::string const& png)
+        {
+            char key[64];
+            std::sprintf(key, "data:%016llx:%llu",
+                         (unsigned long long) hash(png),
+                         (unsigned long long) png.size());
+
+            image_ptr cached = find(key, png);
+            if (cached)
+            {
+                return cached;
+            }
+            return insert(key, png, decode(png));
+        }
+
+        /**
+         * \brief Drops all cached images.
+         */
+        void clear()
+        {
+            for (size_t i = 0; i < m_shards.size(); ++i)
+            {
+                std::lock_guard< std::mutex > lock(m_shards[i].mutex);
+                m_shards[i].entries.clear();
+                m_shards[i].index.clear();
+                m_size -= m_shards[i].size;
+                m_shards[i].size = 0;
+            }
+        }
+
+        size_t get_budget() const
+        {
+            return m_budget;
+        }
+
+        /**
+         * \brief Returns the bytes of pixel data held, plus those of
+         * the PNG data kept to check get_data() hits.
+         */
+        size_t get_size() const
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < m_shards.size(); ++i)
+            {
+                std::lock_guard< std::mutex > lock(m_shards[i].mutex);
+                size += m_shards[i].size;
+            }
+            return size;
+        }
+
+        size_t get_hits() const
+        {
+            return m_hits.load();
+        }
+
+        size_t get_misses() const
+        {
+            return m_misses.load();
+        }
+
+        size_t get_evictions() const
+        {
+            return m_evictions.load();
+        }
+
+    private:
+        image_cache(image_cache const&);
+        image_cache& operator=(image_cache const&);
+
+        struct entry
+        {
+            std::string key;
+            std::string version;
+            image_ptr image;
+            size_t size;
+            size_t tick; // of the last use, to compare across shards
+        };
+        typedef std::list< entry > entry_list;
+
+        struct shard
+        {
+            shard()
+                : size(0)
+            {
+            }
+
+            mutable std::mutex mutex;
+            entry_list entries;
+            std::unordered_map< std::string,
+                                typename entry_list::iterator > index;
+            size_t size;
+        };
+
+        static std::shared_ptr< image_type > decode(std::string const& png)
+        {
+            std::shared_ptr< image_type > decoded(new image_type());
+            detail::memory_streambuf buffer(reinterpret_cast< byte const* >
+                                            (png.data()), png.size());
+            std::istream stream(& buffer);
+            decoded->read(stream);
+            return decoded;
+        }
+
+        static unsigned long long hash(std::string const& data)
+        {
+            unsigned long long h = 14695981039346656037ULL;
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                h ^= static_cast< unsigned char >(data[i]);
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
+        static long get_mtime_nsec(struct stat const& status)
+        {
+#if defined(__APPLE__)
+            return long(status.st_mtimespec.tv_nsec);
+#elif defined(_WIN32)
+            (void) status;
+            return 0;
+#else
+            return long(status.st_mtim.tv_nsec);
+#endif
+        }
+
+        shard& get_shard(std::string const& key)
+        {
+            return m_shards[std::hash< std::string >()(key) % m_shards.size()];
+        }
+
+        /**
+         * \brief Returns the cached %image of \a key if it has \a
+         * version; an entry of another version is dropped.
+         */
+        image_ptr find(std::string const& key, std::string const& version)
+        {
+            shard& s = get_shard(key);
+            std::lock_guard< std::mutex > lock(s.mutex);
+            typename std::unordered_map< std::string,
+                typename entry_list::iterator >::iterator
+                found = s.index.find(key);
+            if (found != s.index.end() && found->second->version != version)
+            {
+                remove(s, found);
+                found = s.index.end();
+            }
+            if (found == s.index.end())
+            {
+                ++m_misses;
+                return image_ptr();
+            }
+            ++m_hits;
+            found->second->tick = ++m_tick;
+            s.entries.splice(s.entries.begin(), s.entries, found->second);
+            return found->second->image;
+        }
+
+        /**
+         * \brief Caches \a decoded as \a version of \a key, replacing
+         * an entry of another version.
+         */
+        image_ptr insert(std::string const& key, std::string const& version,
+                         std::shared_ptr< image_type > const& decoded)
+        {
+            image_ptr result = decoded;
+            size_t size = size_t(decoded->get_width()) * decoded->get_height()
+                * sizeof(pixel) + version.size();
+            {
+                shard& s = get_shard(key);
+                std::lock_guard< std::mutex > lock(s.mutex);
+                typename std::unordered_map< std::string,
+                    typename entry_list::iterator >::iterator
+                    found = s.index.find(key);
+                if (found != s.index.end())
+                {
+                    if (found->second->version == version)
+                    {
+                        // decoded by another thread meanwhile
+                        return found->second->image;
+                    }
+                    remove(s, found);
+                }
+                if (size > m_budget)
+                {
+                    return result;
+                }
+                entry e;
+                e.key = key;
+                e.version = version;
+                e.image = result;
+                e.size = size;
+                e.tick = ++m_tick;
+                s.entries.push_front(e);
+                s.index[key] = s.entries.begin();
+                s.size += size;
+                m_size += size;
+            }
+            evict();
+            return result;
+        }
+
+        /**
+         * \brief Drops the least recently used entries of all shards
+         * until the cache fits its budget.  Only one shard is locked
+         * at a time.
+         */
+        void evict()
+        {
+            while (m_size.load() > m_budget)
+            {
+                shard* oldest = 0;
+                size_t oldest_tick = 0;
+                for (size_t i = 0; i < m_shards.size(); ++i)
+                {
+                    shard& s = m_shards[i];
+                    std::lock_guard< std::mutex > lock(s.mutex);
+                    if (!s.entries.empty()
+                        && (!oldest || s.entries.back().tick < oldest_tick))
+                    {
+                        oldest = & s;
+                        oldest_tick = s.entries.back().tick;
+                    }
+                }
+                if (!oldest)
+                {
+                    return;
+                }
+                std::lock_guard< std::mutex > lock(oldest->mutex);
+                if (!oldest->entries.empty())
+                {
+                    remove(*oldest,
+                           oldest->index.find(oldest->entries.back().key));
+                    ++m_evictions;
+                }
+            }
+        }
+
+        void remove(shard& s, typename std::unordered_map< std::string,
+                    typename entry_list::iterator >::iterator found)
+        {
+            s.size -= found->second->size;
+            m_size -= found->second->size;
+            s.entries.erase(found->second);
+            s.index.erase(found);
+        }
+
+        std::vector< shard > m_shards;
+        size_t m_budget;
+        std::atomic< size_t > m_size;
+        std::atomic< size_t > m_tick;
+        std::atomic< size_t > m_hits;
+        std::atomic< size_t > m_misses;
+        std::atomic< size_t > m_evictions;
+    };
+
+} // namespace png
+
+#endif // PNGPP_HAS_STD_THREAD
+
+#endif // PNGPP_IMAGE_CACHE_HPP_INCLUDED
@@ -37,6 +37,8 @@
 #include "error.hpp"
 #include "info.hpp"
 #include "end_info.hpp"
+#include "io_stats.hpp"
+#include "trace.hpp"
 
 static void
 trace_io_transform(char const* fmt, ...)
@@ -60,6 +62,8 @@ namespace png
      * \see  reader, writer
      */
     class io_base
+        : public io_stats_holder,
+          public trace_holder
     {
         io_base(io_base const&);
         io_base& operator=(io_base const&);
@@ -68,7 +72,8 @@ namespace png
         explicit io_base(png_struct* png)
             : m_png(png),
               m_info(*this, m_png),
-              m_end_info(*this, m_png)
+              m_end_info(*this, m_png),
+              m_error_status(0)
         {
         }
 
@@ -189,6 +194,30 @@ namespace png
 
         //////////////////////////////////////////////////////////////////////
 
+        /**
+         * \brief Reports errors to \a status instead of throwing.
+         *
+         * The reading and writing methods then no longer set up
+         * their own setjmp() point, and libpng errors longjmp() to
+         * the one the caller must have set on get_png_struct().
+         * Error messages go to the buffer of \a status, so no
+         * std::string is built on failure.  Pass 0 to restore
+         * throwing.
+         *
+         * \see consumer::try_read()
+         */
+        void set_error_status(error_status* status)
+        {
+            m_error_status = status;
+        }
+
+        error_status* get_error_status() const
+        {
+            return m_error_status;
+        }
+
+        //////////////////////////////////////////////////////////////////////
+
         bool has_chunk(chunk id)
         {
             return png_get_valid(m_png,
@@ -396,6 +425,27 @@ namespace png
         }
 #endif
 
+#if defined(PNG_READ_QUANTIZE_SUPPORTED)
+        /**
+         * \brief Instructs libpng to map RGB pixels to the nearest
+         * color of \a plte.  libpng keeps a pointer to the palette
+         * (and may reorder it when the palette has more than \a
+         * maximum_colors entries), so \a plte must outlive reading.
+         */
+        void set_quantize(palette& plte, int maximum_colors,
+                          uint_16 const* histogram = 0,
+                          bool full_quantize = true) const
+        {
+            TRACE_IO_TRANSFORM("png_set_quantize: num_palette=%d,"
+                               " maximum_colors=%d, full_quantize=%d\n",
+                               (int) plte.size(), maximum_colors,
+                               full_quantize);
+
+            png_set_quantize(m_png, & plte[0], (int) plte.size(),
+                             maximum_colors, histogram, full_quantize);
+        }
+#endif
+
 #if defined(PNG_READ_USER_TRANSFORM_SUPPORTED)
         void set_read_user_transform(png_user_transform_ptr transform_fn)
         {
@@ -421,14 +471,25 @@ namespace png
             return png_get_io_ptr(m_png);
         }
 
-        void set_error(char const* message)
+        void set_error(char const* message, error_code code = error_format)
         {
             assert(message);
-            m_error = message;
+            if (m_error_status)
+            {
+                m_error_status->set(code, message);
+            }
+            else
+            {
+                m_error = message;
+            }
         }
 
         void reset_error()
         {
+            if (m_error_status)
+            {
+                m_error_status->clear();
+            }
             m_error.clear();
         }
 
@@ -441,7 +502,7 @@ namespace png
 
         bool is_error() const
         {
-            return !m_error.empty();
+            return m_error_status ? !m_error_status->is_ok() : !m_error.empty();
         }
 
         void raise_error()
@@ -460,6 +521,7 @@ namespace png
         info m_info;
         end_info m_end_info;
         std::string m_error;
+        error_status* m_error_status;
     };
 
 } // namespace png
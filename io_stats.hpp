@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_IO_STATS_HPP_INCLUDED
+#define PNGPP_IO_STATS_HPP_INCLUDED
+
+#include <cstddef>
+#include "config.hpp"
+
+#if defined(PNGPP_IO_STATS) || defined(PNGPP_TRACE)
+#if __cplusplus >= 201103L
+#include <chrono>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/time.h>
+#else
+#include <ctime>
+#endif
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief Byte counts and timings of reading or writing an %image.
+     *
+     * Collecting is opt-in: define \c PNGPP_IO_STATS before including
+     * png++ (consistently in every translation unit) and pass an
+     * io_stats object to image::set_io_stats(), or to the
+     * set_io_stats() of a consumer, generator, reader or writer.
+     * Without the macro the setters do nothing and no code is
+     * generated.  Values are added up, so one object may collect
+     * several operations.
+     *
+     * All times are wall clock times in seconds.
+     */
+    struct io_stats
+    {
+        io_stats()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            bytes = 0;
+            io_calls = 0;
+            io_time = 0;
+            libpng_time = 0;
+            hook_time = 0;
+            total_time = 0;
+        }
+
+        /// bytes pulled from or pushed to the stream
+        size_t bytes;
+        /// number of read or write callbacks made by libpng
+        size_t io_calls;
+        /// time spent in the read or write callbacks
+        double io_time;
+        /// time spent in libpng reading or writing rows (inflating or
+        /// deflating, filtering and transformations), excluding io_time
+        double libpng_time;
+        /// time spent in the consumer or generator row hooks
+        double hook_time;
+        /// time spent in consumer::read() or generator::write()
+        double total_time;
+    };
+
+    /**
+     * \brief Holds the io_stats object to fill, if statistics are
+     * enabled; an empty class otherwise.
+     */
+    class io_stats_holder
+    {
+    public:
+#ifdef PNGPP_IO_STATS
+        io_stats_holder()
+            : m_io_stats(0)
+        {
+        }
+
+        void set_io_stats(io_stats* stats)
+        {
+            m_io_stats = stats;
+        }
+
+        io_stats* get_io_stats() const
+        {
+            return m_io_stats;
+        }
+
+    private:
+        io_stats* m_io_stats;
+#else
+        void set_io_stats(io_stats* /*stats*/)
+        {
+        }
+
+        io_stats* get_io_stats() const
+        {
+            return 0;
+        }
+#endif
+    };
+
+    namespace detail
+    {
+
+        enum stats_kind
+        {
+            stats_io,
+            stats_libpng,
+            stats_hook,
+            stats_total
+        };
+
+#if defined(PNGPP_IO_STATS) || defined(PNGPP_TRACE)
+        /**
+         * \brief Returns a monotonic time in seconds.  Also used by
+         * trace_file.
+         */
+        inline double stats_clock()
+        {
+#if __cplusplus >= 201103L
+            return std::chrono::duration< double >
+                (std::chrono::steady_clock::now().time_since_epoch()).count();
+#elif defined(__unix__) || defined(__APPLE__)
+            timeval now;
+            gettimeofday(& now, 0);
+            return now.tv_sec + now.tv_usec * 1e-6;
+#else
+            return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+        }
+#endif
+
+#ifdef PNGPP_IO_STATS
+        /**
+         * \brief A point in time, with the I/O time accumulated so
+         * far.  Plain data, so that it is safe to use in functions
+         * libpng may longjmp() out of.
+         */
+        struct stats_mark
+        {
+            double time;
+            double io_time;
+        };
+
+        inline stats_mark stats_begin(io_stats const* stats)
+        {
+            stats_mark mark = { 0, 0 };
+            if (stats)
+            {
+                mark.time = stats_clock();
+                mark.io_time = stats->io_time;
+            }
+            return mark;
+        }
+
+        inline void stats_end(io_stats* stats, stats_mark const& mark,
+                              stats_kind kind, size_t bytes = 0)
+        {
+            if (!stats)
+            {
+                return;
+            }
+            double elapsed = stats_clock() - mark.time;
+            switch (kind)
+            {
+            case stats_io:
+                stats->io_time += elapsed;
+                stats->bytes += bytes;
+                ++stats->io_calls;
+                break;
+            case stats_libpng:
+                stats->libpng_time += elapsed - (stats->io_time - mark.io_time);
+                break;
+            case stats_hook:
+                stats->hook_time += elapsed;
+                break;
+            case stats_total:
+                stats->total_time += elapsed;
+                break;
+            }
+        }
+#endif
+
+        /**
+         * \brief Adds the time until it goes out of scope to \a
+         * stats.  Must not be used where libpng may longjmp().
+         */
+        class stats_scope
+        {
+        public:
+#ifdef PNGPP_IO_STATS
+            stats_scope(io_stats* stats, stats_kind kind)
+                : m_stats(stats),
+                  m_kind(kind),
+                  m_mark(stats_begin(stats))
+            {
+            }
+
+            ~stats_scope()
+            {
+                stats_end(m_stats, m_mark, m_kind);
+            }
+
+        private:
+            stats_scope(stats_scope const&);
+            stats_scope& operator=(stats_scope const&);
+
+            io_stats* m_stats;
+            stats_kind m_kind;
+            stats_mark m_mark;
+#else
+            stats_scope(io_stats* /*stats*/, stats_kind /*kind*/)
+            {
+            }
+#endif
+        };
+
+    } // namespace detail
+
+} // namespace png
+
+#endif // PNGPP_IO_STATS_HPP_INCLUDED
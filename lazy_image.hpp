@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_LAZY_IMAGE_HPP_INCLUDED
+#define PNGPP_LAZY_IMAGE_HPP_INCLUDED
+
+#include <fstream>
+#include <istream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "reader.hpp"
+#include "read_options.hpp"
+#include "pixel_buffer.hpp"
+#include "convert_color_space.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief An %image whose rows are decoded only when accessed.
+     *
+     * The header is read and validated on construction; rows are
+     * decoded by get_row() and get_pixel() when first needed and kept
+     * in a least recently used cache of at most \c cache_size bytes
+     * (but at least one row).  Access that moves forward continues
+     * decoding where it stopped, so a top to bottom scan decodes
+     * every row exactly once.  A row above the decoding position
+     * which has been evicted restarts decoding from the beginning of
+     * the stream, since libpng cannot save and restore the inflate
+     * state.  Rows decoded on the way are cached too.
+     *
+     * Interlaced images are decoded whole whenever a missing row is
+     * accessed, as no row is complete before the last pass.
+     *
+     * Pixels are converted to \c pixel as image::read() does.  The
+     * row references returned stay valid until the next access.
+     *
+     * \code
+     * png::lazy_image< png::rgb_pixel > image("huge.png", 1 << 20);
+     * png::rgb_pixel corner = image.get_pixel(image.get_width() - 1,
+     *                                         image.get_height() - 1);
+     * \endcode
+     */
+    template< typename pixel >
+    class lazy_image
+    {
+    public:
+        typedef pixel_buffer< pixel > pixbuf;
+        typedef typename pixbuf::row_type row_type;
+        typedef typename pixbuf::row_const_access row_const_access;
+        typedef typename pixbuf::row_traits row_traits;
+        typedef convert_color_space< pixel > transform_convert;
+
+        /**
+         * \brief Opens the file \a filename and reads its header.
+         */
+        explicit lazy_image(std::string const& filename,
+                            size_t cache_size = 16 << 20,
+                            read_options const& options = read_options())
+            : m_file(filename.c_str(), std::ios::binary),
+              m_stream(& m_file),
+              m_options(options),
+              m_cache_size(cache_size)
+        {
+            if (!m_file.is_open())
+            {
+                throw std_error(filename);
+            }
+            m_file.exceptions(std::ios::badbit);
+            open();
+        }
+
+        /**
+         * \brief Reads the header from \a stream, which must be
+         * seekable and outlive the lazy_image.
+         */
+        explicit lazy_image(std::istream& stream,
+                            size_t cache_size = 16 << 20,
+                            read_options const& options = read_options())
+            : m_stream(& stream),
+              m_options(options),
+              m_cache_size(cache_size)
+        {
+            open();
+        }
+
+        ~lazy_image()
+        {
+            delete m_reader;
+        }
+
+        uint_32 get_width() const
+        {
+            return m_info.get_width();
+        }
+
+        uint_32 get_height() const
+        {
+            return m_info.get_height();
+        }
+
+        interlace_type get_interlace_type() const
+        {
+            return m_info.get_interlace_type();
+        }
+
+        /**
+         * \brief Returns the %image info, with the color type and
+         * bit depth of \c pixel.
+         */
+        image_info const& get_info() const
+        {
+            return m_info;
+        }
+
+        /**
+         * \brief Returns the row at \a index, decoding it if needed.
+         * Throws std::out_of_range for rows past the bottom.
+         */
+        row_const_access get_row(size_t index)
+        {
+            if (index >= get_height())
+            {
+                throw std::out_of_range("lazy_image::get_row");
+            }
+            typename row_list::iterator cached = m_index[index];
+            if (cached != m_rows.end())
+            {
+                m_rows.splice(m_rows.begin(), m_rows, cached);
+                return cached->pixels;
+            }
+            decode_to(uint_32(index));
+            return m_rows.front().pixels;
+        }
+
+        /**
+         * \brief Returns the pixel at (x,y), decoding its row if
+         * needed.
+         */
+        pixel get_pixel(size_t x, size_t y)
+        {
+            return get_row(y).at(x);
+        }
+
+        /**
+         * \brief Returns the number of rows decoded so far, counting
+         * rows decoded again.
+         */
+        size_t get_decoded_rows() const
+        {
+            return m_decoded_rows;
+        }
+
+        /**
+         * \brief Returns how often decoding started over.
+         */
+        size_t get_restarts() const
+        {
+            return m_restarts;
+        }
+
+        /**
+         * \brief Returns the number of rows held in the cache.
+         */
+        size_t get_cached_rows() const
+        {
+            return m_rows.size();
+        }
+
+    private:
+        lazy_image(lazy_image const&);
+        lazy_image& operator=(lazy_image const&);
+
+        struct cached_row
+        {
+            uint_32 index;
+            row_type pixels;
+        };
+        typedef std::list< cached_row > row_list;
+
+        /**
+         * \brief Reads the header and prepares to decode rows.
+         */
+        void open()
+        {
+            m_reader = 0;
+            m_next_row = 0;
+            m_decoded_rows = 0;
+            m_restarts = 0;
+            // the destructor does not run if the constructor throws
+            try
+            {
+                m_start = m_stream->tellg();
+                start();
+                m_info = m_reader->get_image_info();
+                m_index.assign(get_height(), m_rows.end());
+            }
+            catch (...)
+            {
+                delete m_reader;
+                m_reader = 0;
+                throw;
+            }
+
+            size_t row_size = get_width() * sizeof(pixel);
+            m_max_rows = row_size ? m_cache_size / row_size : get_height();
+            if (m_max_rows == 0)
+            {
+                m_max_rows = 1;
+            }
+        }
+
+        /**
+         * \brief Creates a reader at the start of the stream, set up
+         * like consumer::read() does.
+         */
+        void start()
+        {
+            delete m_reader;
+            m_reader = 0;
+            m_stream->clear();
+            m_stream->seekg(m_start);
+            m_reader = new reader< std::istream >(*m_stream);
+            m_reader->set_options(m_options);
+            m_reader->read_info();
+            transform_convert()(*m_reader);
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+            if (pixel_traits< pixel >::get_bit_depth() == 16)
+            {
+#ifdef PNG_READ_SWAP_SUPPORTED
+                m_reader->set_swap();
+#else
+                throw error("Cannot read 16-bit image: recompile with PNG_READ_SWAP_SUPPORTED.");
+#endif
+            }
+#endif
+
+            m_pass_count = 1;
+            if (m_reader->get_interlace_type() != interlace_none)
+            {
+#ifdef PNG_READ_INTERLACING_SUPPORTED
+                m_pass_count = m_reader->set_interlace_handling();
+#else
+                throw error("Cannot read interlaced image: interlace handling disabled.");
+#endif
+            }
+
+            m_reader->update_info();
+            if (m_reader->get_color_type() != pixel_traits< pixel >::get_color_type()
+                || m_reader->get_bit_depth() != pixel_traits< pixel >::get_bit_depth())
+            {
+                throw std::logic_error("color type and/or bit depth mismatch"
+                                       " in png::lazy_image");
+            }
+            m_next_row = 0;
+        }
+
+        /**
+         * \brief Decodes rows up to \a index, which ends up at the
+         * front of the cache.
+         */
+        void decode_to(uint_32 index)
+        {
+            try
+            {
+                if (m_pass_count > 1)
+                {
+                    decode_interlaced(index);
+                    return;
+                }
+                if (index < m_next_row)
+                {
+                    ++m_restarts;
+                    start();
+                }
+                while (m_next_row <= index)
+                {
+                    cached_row& row = insert(m_next_row);
+                    m_reader->read_row(reinterpret_cast< byte* >
+                                       (row_traits::get_data(row.pixels)));
+                    ++m_next_row;
+                    ++m_decoded_rows;
+                }
+            }
+            catch (...)
+            {
+                // the reader cannot continue after an error, and the
+                // row being decoded is garbage
+                if (m_next_row < get_height()
+                    && m_index[m_next_row] != m_rows.end())
+                {
+                    m_rows.erase(m_index[m_next_row]);
+                    m_index[m_next_row] = m_rows.end();
+                }
+                delete m_reader;
+                m_reader = 0;
+                m_next_row = get_height();
+                throw;
+            }
+        }
+
+        void decode_interlaced(uint_32 index)
+        {
+            if (m_next_row != 0)
+            {
+                ++m_restarts;
+                start();
+            }
+            pixbuf pixels(get_width(), get_height());
+            for (size_t pass = 0; pass < m_pass_count; ++pass)
+            {
+                for (uint_32 pos = 0; pos < get_height(); ++pos)
+                {
+                    m_reader->read_row(reinterpret_cast< byte* >
+                                       (row_traits::get_data(pixels[pos])));
+                }
+            }
+            m_next_row = get_height();
+            m_decoded_rows += get_height();
+
+            // keep the rows after index, then the rows up to it, so
+            // that index is the most recent
+            for (uint_32 pos = index + 1; pos < get_height(); ++pos)
+            {
+                if (m_index[pos] == m_rows.end())
+                {
+                    insert(pos).pixels = pixels[pos];
+                }
+            }
+            for (uint_32 pos = 0; pos <= index; ++pos)
+            {
+                if (m_index[pos] == m_rows.end())
+                {
+                    insert(pos).pixels = pixels[pos];
+                }
+            }
+            m_rows.splice(m_rows.begin(), m_rows, m_index[index]);
+        }
+
+        /**
+         * \brief Adds an entry for row \a index at the front of the
+         * cache, reusing the least recently used row if the cache is
+         * full.
+         */
+        cached_row& insert(uint_32 index)
+        {
+            if (m_index[index] != m_rows.end())
+            {
+                // decoded again after a restart
+                m_rows.splice(m_rows.begin(), m_rows, m_index[index]);
+                return m_rows.front();
+            }
+            if (m_rows.size() >= m_max_rows)
+            {
+                m_index[m_rows.back().index] = m_rows.end();
+                m_rows.splice(m_rows.begin(), m_rows, --m_rows.end());
+            }
+            else
+            {
+                m_rows.push_front(cached_row());
+                m_rows.front().pixels.resize(get_width());
+            }
+            m_rows.front().index = index;
+            m_index[index] = m_rows.begin();
+            return m_rows.front();
+        }
+
+        std::ifstream m_file;
+        std::istream* m_stream;
+        std::streampos m_start;
+        read_options m_options;
+        size_t m_cache_size;
+        size_t m_max_rows;
+        reader< std::istream >* m_reader;
+        image_info m_info;
+        size_t m_pass_count;
+        uint_32 m_next_row;
+        size_t m_decoded_rows;
+        size_t m_restarts;
+        row_list m_rows;
+        std::vector< typename row_list::iterator > m_index;
+    };
+
+} // namespace png
+
+#endif // PNGPP_LAZY_IMAGE_HPP_INCLUDED
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_MAPPED_PIXEL_BUFFER_HPP_INCLUDED
+#define PNGPP_MAPPED_PIXEL_BUFFER_HPP_INCLUDED
+
+#include "config.hpp"
+
+#ifdef PNGPP_HAS_MMAP
+
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "error.hpp"
+#include "pixel_traits.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief Pixel buffer stored in a memory mapped file.
+     *
+     * The layout is that of solid_pixel_buffer: rows follow each
+     * other without gaps.  The pages are backed by a file rather than
+     * by swap space, so images larger than the physical memory can be
+     * decoded into the buffer: the operating system writes the pages
+     * out as the memory gets tight.
+     *
+     * By default the buffer lives in an unnamed temporary file,
+     * created in \c $TMPDIR (or \c /tmp) and removed as soon as it is
+     * opened.  The file grows sparsely, so disk space is only taken
+     * by the rows actually written.  Alternatively, a named file may
+     * be given: its contents are mapped as they are and left in place
+     * after the buffer is destroyed.
+     *
+     * Use it with the image class template:
+     *
+     * \code
+     * png::image< png::rgb_pixel, png::mapped_pixel_buffer< png::rgb_pixel > >
+     *     image("huge.png");
+     * \endcode
+     *
+     * To decode into a named file instead, open() it through
+     * image::get_pixbuf() before reading:
+     *
+     * \code
+     * png::image< png::rgb_pixel, png::mapped_pixel_buffer< png::rgb_pixel > >
+     *     image;
+     * image.get_pixbuf().open("huge.raw");
+     * image.read("huge.png");
+     * image.get_pixbuf().sync();
+     * \endcode
+     *
+     * Available on POSIX systems only.
+     */
+    template< typename pixel >
+    class mapped_pixel_buffer
+    {
+        mapped_pixel_buffer(mapped_pixel_buffer const&);
+        mapped_pixel_buffer& operator=(mapped_pixel_buffer const&);
+
+    public:
+        typedef pixel_traits< pixel > pixel_traits_t;
+        struct row_traits
+        {
+            typedef pixel* row_access;
+            typedef const pixel* row_const_access;
+
+            static byte* get_data(row_access row)
+            {
+                return reinterpret_cast<byte*>(row);
+            }
+        };
+
+        /**
+         * \brief A row of pixel data.
+         */
+        typedef typename row_traits::row_access row_access;
+        typedef typename row_traits::row_const_access row_const_access;
+        typedef row_access row_type;
+
+        /**
+         * \brief Constructs an empty 0x0 pixel buffer object backed
+         * by a temporary file.
+         */
+        mapped_pixel_buffer()
+            : m_width(0),
+              m_height(0),
+              m_stride(0),
+              m_fd(-1),
+              m_bytes(0),
+              m_size(0)
+        {
+            open_temporary();
+        }
+
+        /**
+         * \brief Constructs a pixel buffer object backed by a
+         * temporary file.
+         */
+        mapped_pixel_buffer(uint_32 width, uint_32 height)
+            : m_width(0),
+              m_height(0),
+              m_stride(0),
+              m_fd(-1),
+              m_bytes(0),
+              m_size(0)
+        {
+            open_temporary();
+            try
+            {
+                resize(width, height);
+            }
+            catch (...)
+            {
+                ::close(m_fd);
+                throw;
+            }
+        }
+
+        /**
+         * \brief Constructs a pixel buffer object backed by the named
+         * file, which is created if it does not exist.
+         */
+        mapped_pixel_buffer(uint_32 width, uint_32 height,
+                            std::string const& filename)
+            : m_width(0),
+              m_height(0),
+              m_stride(0),
+              m_fd(-1),
+              m_bytes(0),
+              m_size(0)
+        {
+            m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+            if (m_fd < 0)
+            {
+                throw std_error(filename);
+            }
+            m_filename = filename;
+            try
+            {
+                resize(width, height);
+            }
+            catch (...)
+            {
+                ::close(m_fd);
+                throw;
+            }
+        }
+
+        /**
+         * \brief Moves the buffer to the named file, which is created
+         * if it does not exist, keeping the geometry.  The file is
+         * truncated or extended to the buffer size and its contents
+         * are mapped as they are: the current pixels are not copied.
+         * Throws png::std_error if the file cannot be opened, resized
+         * or mapped, leaving a 0x0 buffer backed by the file.
+         */
+        void open(std::string const& filename)
+        {
+            int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+            if (fd < 0)
+            {
+                throw std_error(filename);
+            }
+            unmap();
+            ::close(m_fd);
+            m_fd = fd;
+            m_filename = filename;
+
+            resize(m_width, m_height);
+        }
+
+        ~mapped_pixel_buffer()
+        {
+            unmap();
+            ::close(m_fd);
+        }
+
+        uint_32 get_width() const
+        {
+            return m_width;
+        }
+
+        uint_32 get_height() const
+        {
+            return m_height;
+        }
+
+        /**
+         * \brief Resizes the pixel buffer, and the file backing it.
+         *
+         * The bytes are kept in place, as with solid_pixel_buffer.
+         * Newly added bytes are zero.  Throws png::error if the
+         * buffer size does not fit in size_t or off_t, and
+         * png::std_error if the file cannot be resized or mapped, in
+         * which case the buffer is left 0x0.
+         */
+        void resize(uint_32 width, uint_32 height)
+        {
+            size_t stride = size_t(width) * bytes_per_pixel;
+            size_t const max_size =
+                size_t(std::numeric_limits< off_t >::max()) < size_t(-1)
+                ? size_t(std::numeric_limits< off_t >::max()) : size_t(-1);
+            if (stride / bytes_per_pixel != width
+                || (height != 0 && stride > max_size / height))
+            {
+                throw error("image size exceeds the address space");
+            }
+            size_t size = stride * height;
+
+            unmap();
+            m_width = 0;
+            m_height = 0;
+            m_stride = 0;
+            m_size = 0;
+            if (::ftruncate(m_fd, off_t(size)) != 0)
+            {
+                throw std_error(get_filename());
+            }
+            if (size != 0)
+            {
+                void* bytes = ::mmap(0, size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED, m_fd, 0);
+                if (bytes == MAP_FAILED)
+                {
+                    throw std_error(get_filename());
+                }
+                m_bytes = static_cast< byte* >(bytes);
+            }
+            m_size = size;
+            m_width = width;
+            m_height = height;
+            m_stride = stride;
+        }
+
+        /**
+         * \brief Returns a reference to the row of image data at
+         * specified index.
+         *
+         * Checks the index before returning a row: an instance of
+         * std::out_of_range is thrown if \c index is greater than \c
+         * height.
+         */
+        row_access get_row(size_t index)
+        {
+            check_row(index);
+            return (*this)[index];
+        }
+
+        /**
+         * \brief Returns a const reference to the row of image data at
+         * specified index.
+         *
+         * The checking version.
+         */
+        row_const_access get_row(size_t index) const
+        {
+            check_row(index);
+            return (*this)[index];
+        }
+
+        /**
+         * \brief The non-checking version of get_row() method.
+         */
+        row_access operator[](size_t index)
+        {
+            return reinterpret_cast< row_access >(m_bytes + index * m_stride);
+        }
+
+        /**
+         * \brief The non-checking version of get_row() method.
+         */
+        row_const_access operator[](size_t index) const
+        {
+            return reinterpret_cast< row_const_access >
+                (m_bytes + index * m_stride);
+        }
+
+        /**
+         * \brief Replaces the row at specified index.
+         */
+        void put_row(size_t index, row_const_access r)
+        {
+            row_access row = get_row(index);
+            for (size_t i = 0; i < m_width; ++i)
+                *row++ = *r++;
+        }
+
+        /**
+         * \brief Returns a pixel at (x,y) position.
+         */
+        pixel get_pixel(size_t x, size_t y) const
+        {
+            return get_row(y)[x];
+        }
+
+        /**
+         * \brief Replaces a pixel at (x,y) position.
+         */
+        void set_pixel(size_t x, size_t y, pixel p)
+        {
+            get_row(y)[x] = p;
+        }
+
+        /**
+         * \brief Provides access to the mapped bytes, get_size() of
+         * them.
+         */
+        byte const* get_data() const
+        {
+            return m_bytes;
+        }
+
+        size_t get_size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * \brief Writes the modified pages to the file.  Only useful
+         * for a named file.
+         */
+        void sync()
+        {
+            if (m_bytes && ::msync(m_bytes, m_size, MS_SYNC) != 0)
+            {
+                throw std_error(get_filename());
+            }
+        }
+
+    protected:
+        static const size_t bytes_per_pixel = pixel_traits_t::channels *
+                pixel_traits_t::bit_depth / CHAR_BIT;
+
+        void open_temporary()
+        {
+            char const* dir = ::getenv("TMPDIR");
+            std::string name = std::string(dir && *dir ? dir : "/tmp")
+                + "/png++-XXXXXX";
+            m_fd = ::mkstemp(& name[0]);
+            if (m_fd < 0)
+            {
+                throw std_error(name);
+            }
+            ::unlink(name.c_str());
+        }
+
+        void unmap()
+        {
+            if (m_bytes)
+            {
+                ::munmap(m_bytes, m_size);
+                m_bytes = 0;
+            }
+        }
+
+        void check_row(size_t index) const
+        {
+            if (index >= m_height)
+            {
+                throw std::out_of_range("mapped_pixel_buffer row index");
+            }
+        }
+
+        std::string get_filename() const
+        {
+            return m_filename.empty() ? "temporary file" : m_filename;
+        }
+
+    protected:
+        uint_32 m_width;
+        uint_32 m_height;
+        size_t m_stride;
+        int m_fd;
+        byte* m_bytes;
+        size_t m_size;
+        std::string m_filename;
+
+#ifdef PNGPP_HAS_STATIC_ASSERT
+        static_assert(pixel_traits_t::bit_depth % CHAR_BIT == 0,
+            "Bit_depth should consist of integer number of bytes");
+
+        static_assert(sizeof(pixel) * CHAR_BIT ==
+            pixel_traits_t::channels * pixel_traits_t::bit_depth,
+            "pixel type should contain channels data only");
+#endif
+    };
+
+} // namespace png
+
+#endif // PNGPP_HAS_MMAP
+
+#endif // PNGPP_MAPPED_PIXEL_BUFFER_HPP_INCLUDED
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_METADATA_HPP_INCLUDED
+#define PNGPP_METADATA_HPP_INCLUDED
+
+#include <cstring>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+#include "error.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief A view of a raw chunk found by scan_metadata().
+     *
+     * The data is only valid during the callback it is passed to.
+     */
+    class metadata_chunk
+    {
+    public:
+        metadata_chunk(byte const* type, byte const* data, uint_32 size,
+                       bool after_image)
+            : m_data(data),
+              m_size(size),
+              m_after_image(after_image)
+        {
+            std::memcpy(m_type, type, 4);
+            m_type[4] = '\0';
+        }
+
+        /**
+         * \brief Returns the four letter chunk type, e.g. "tEXt".
+         */
+        char const* get_type() const
+        {
+            return m_type;
+        }
+
+        bool is(char const* type) const
+        {
+            return std::memcmp(m_type, type, 4) == 0;
+        }
+
+        bool is_ancillary() const
+        {
+            return (m_type[0] & 0x20) != 0;
+        }
+
+        /**
+         * \brief Returns whether the chunk follows the %image data,
+         * i.e. belongs to the end info.
+         */
+        bool is_after_image() const
+        {
+            return m_after_image;
+        }
+
+        byte const* get_data() const
+        {
+            return m_data;
+        }
+
+        uint_32 get_size() const
+        {
+            return m_size;
+        }
+
+    private:
+        char m_type[5];
+        byte const* m_data;
+        uint_32 m_size;
+        bool m_after_image;
+    };
+
+    /**
+     * \brief Extracts the keyword and text of a tEXt chunk or of an
+     * uncompressed iTXt chunk.
+     *
+     * Returns \c false for other chunks, including zTXt and
+     * compressed iTXt, whose text must be inflated by the caller.
+     */
+    inline bool read_text(metadata_chunk const& chunk,
+                          std::string& keyword, std::string& text)
+    {
+        char const* data = reinterpret_cast< char const* >(chunk.get_data());
+        char const* end = data + chunk.get_size();
+        char const* separator = static_cast< char const* >
+            (std::memchr(data, '\0', chunk.get_size()));
+        if (separator == 0)
+        {
+            return false;
+        }
+        if (chunk.is("tEXt"))
+        {
+            keyword.assign(data, separator);
+            text.assign(separator + 1, end);
+            return true;
+        }
+        if (chunk.is("iTXt") && end - separator > 2 && separator[1] == 0)
+        {
+            // skip compression flag and method, language tag and
+            // translated keyword
+            char const* p = separator + 3;
+            for (int field = 0; field < 2; ++field)
+            {
+                p = static_cast< char const* >(std::memchr(p, '\0', end - p));
+                if (p == 0)
+                {
+                    return false;
+                }
+                ++p;
+            }
+            keyword.assign(data, separator);
+            text.assign(p, end);
+            return true;
+        }
+        return false;
+    }
+
+    namespace detail
+    {
+
+        inline uint_32 read_uint_32(byte const* p)
+        {
+            return (uint_32(p[0]) << 24) | (uint_32(p[1]) << 16)
+                | (uint_32(p[2]) << 8) | uint_32(p[3]);
+        }
+
+        inline void check_signature(byte const* data)
+        {
+            static byte const signature[8] =
+                { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+            if (std::memcmp(data, signature, 8) != 0)
+            {
+                throw error("not a PNG file");
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief Walks the chunks of a PNG file held in memory, calling
+     * <tt>callback(chunk)</tt> with a metadata_chunk for every chunk
+     * except IDAT and IEND.
+     *
+     * The chunks point into \a data; nothing is copied, inflated or
+     * checksummed.  The callback returns \c false to stop the scan.
+     */
+    template< class callback >
+    void scan_metadata(byte const* data, size_t size, callback& handler)
+    {
+        if (size < 8)
+        {
+            throw error("not a PNG file");
+        }
+        detail::check_signature(data);
+
+        bool after_image = false;
+        size_t pos = 8;
+        while (pos < size)
+        {
+            if (size - pos < 12)
+            {
+                throw error("truncated chunk");
+            }
+            uint_32 length = detail::read_uint_32(data + pos);
+            byte const* type = data + pos + 4;
+            if (length > size - pos - 12)
+            {
+                throw error("truncated chunk");
+            }
+            if (std::memcmp(type, "IEND", 4) == 0)
+            {
+                return;
+            }
+            if (std::memcmp(type, "IDAT", 4) == 0)
+            {
+                after_image = true;
+            }
+            else if (!handler(metadata_chunk(type, data + pos + 8, length,
+                                             after_image)))
+            {
+                return;
+            }
+            pos += size_t(length) + 12;
+        }
+    }
+
+    /**
+     * \brief Walks the chunks of a PNG stream, calling
+     * <tt>callback(chunk)</tt> with a metadata_chunk for every chunk
+     * except IDAT and IEND.
+     *
+     * The %image data is skipped with seekg() if the stream supports
+     * seeking, and read past otherwise; it is never inflated, so the
+     * end info chunks following it are reached cheaply.  Each chunk
+     * payload is read into a buffer reused across chunks.  The
+     * callback returns \c false to stop the scan.
+     */
+    template< class callback >
+    void scan_metadata(std::istream& stream, callback& handler)
+    {
+        byte header[8];
+        if (!stream.read(reinterpret_cast< char* >(header), 8))
+        {
+            throw error("not a PNG file");
+        }
+        detail::check_signature(header);
+
+        bool const seekable = stream.tellg() != std::streampos(-1);
+        std::vector< byte > payload;
+        bool after_image = false;
+        while (stream.read(reinterpret_cast< char* >(header), 8))
+        {
+            uint_32 length = detail::read_uint_32(header);
+            if (length > 0x7fffffff)
+            {
+                throw error("invalid chunk length");
+            }
+            byte const* type = header + 4;
+            if (std::memcmp(type, "IEND", 4) == 0)
+            {
+                return;
+            }
+            if (std::memcmp(type, "IDAT", 4) == 0)
+            {
+                after_image = true;
+                std::streamoff skip = std::streamoff(length) + 4;
+                if (seekable)
+                {
+                    stream.seekg(skip, std::ios::cur);
+                }
+                else
+                {
+                    stream.ignore(skip);
+                    if (stream.gcount() != skip)
+                    {
+                        throw error("truncated chunk");
+                    }
+                }
+                if (!stream)
+                {
+                    throw error("truncated chunk");
+                }
+                continue;
+            }
+
+            payload.resize(size_t(length) + 4);
+            if (!stream.read(reinterpret_cast< char* >(& payload[0]),
+                             payload.size()))
+            {
+                throw error("truncated chunk");
+            }
+            if (!handler(metadata_chunk(type, & payload[0], length,
+                                        after_image)))
+            {
+                return;
+            }
+        }
+        throw error("truncated chunk");
+    }
+
+} // namespace png
+
+#endif // PNGPP_METADATA_HPP_INCLUDED
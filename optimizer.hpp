@@ -0,0 +1,604 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_OPTIMIZER_HPP_INCLUDED
+#define PNGPP_OPTIMIZER_HPP_INCLUDED
+
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "image_info.hpp"
+#include "pixel_traits.hpp"
+#include "writer.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <thread>
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief Writes pixel data in the smallest lossless PNG encoding
+     * found.
+     *
+     * The pixels are scanned once to find out whether the alpha
+     * channel is fully opaque, whether all the colors are gray and
+     * whether there are no more than 256 distinct colors.  Based on
+     * that, up to two candidate formats are picked: the truecolor or
+     * grayscale format with the unused channels and bits dropped, and
+     * an indexed format with a palette (and a tRNS chunk, if needed)
+     * of the smallest possible bit depth.
+     *
+     * Each candidate format is compressed with a few combinations of
+     * row filters and zlib strategies, in parallel when std::thread
+     * is available, and the smallest output is written to the stream.
+     * The output image::write() would produce is among the
+     * candidates, so the result is never larger than that.  The pixel
+     * values decoded from the result into the source pixel type are
+     * exactly those of the source.  For that reason 16-bit pixel
+     * types are always written with 16-bit samples: reading 8-bit
+     * samples into them would not restore the low bytes.
+     *
+     * Indexed and packed pixel types are written in their own format,
+     * only the compression settings are tried for them.
+     *
+     * \see image::write_optimized()
+     */
+    template< typename pixel, class pixbuf >
+    class optimizer
+    {
+    public:
+        typedef pixel_traits< pixel > traits;
+        typedef typename traits::component_type component;
+        typedef typename pixbuf::row_traits row_traits;
+
+        /**
+         * \brief Constructs an optimizer for the %image described by
+         * \a info, with pixels stored in \a pixels.  The geometry,
+         * interlace type and gamma of \a info are preserved.
+         */
+        optimizer(image_info const& info, pixbuf& pixels)
+            : m_info(info),
+              m_pixbuf(& pixels)
+        {
+        }
+
+        /**
+         * \brief Writes the smallest encoding of the %image to \a
+         * stream.
+         */
+        template< class ostream >
+        void write(ostream& stream)
+        {
+            std::vector< format > formats;
+            find_formats(formats);
+
+            static setting const settings[] =
+            {
+                { 9, filter_none, compression_strategy_default },
+                { 9, filter_all, compression_strategy_default },
+                { 9, filter_all, compression_strategy_filtered }
+            };
+            size_t const setting_count = sizeof(settings) / sizeof(*settings);
+
+            // what write() would produce, so the result is never larger
+            static setting const defaults = { -1, 0, compression_strategy_default };
+            std::vector< encoder > encoders;
+            encoders.push_back(encoder(this, formats[0], defaults));
+            for (size_t i = 1; i < formats.size(); ++i)
+            {
+                for (size_t j = 0; j < setting_count; ++j)
+                {
+                    encoders.push_back(encoder(this, formats[i],
+                                               settings[j]));
+                }
+            }
+
+#ifdef PNGPP_HAS_STD_THREAD
+            std::vector< std::thread > threads;
+            for (size_t i = 1; i < encoders.size(); ++i)
+            {
+                threads.push_back(std::thread(& encoder::run, & encoders[i]));
+            }
+            encoders[0].run();
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+#else
+            for (size_t i = 0; i < encoders.size(); ++i)
+            {
+                encoders[i].run();
+            }
+#endif
+
+            size_t best = 0;
+            for (size_t i = 0; i < encoders.size(); ++i)
+            {
+                if (!encoders[i].m_error.empty())
+                {
+                    throw error(encoders[i].m_error);
+                }
+                if (encoders[i].m_output.size()
+                    < encoders[best].m_output.size())
+                {
+                    best = i;
+                }
+            }
+            std::string const& output = encoders[best].m_output;
+            stream.write(output.data(), output.size());
+            stream.flush();
+        }
+
+    private:
+        enum format_kind
+        {
+            format_raw,         // pixel rows as they are
+            format_direct,      // truecolor or grayscale, 8 or 16 bits
+            format_gray_packed, // grayscale, 1, 2 or 4 bits
+            format_indexed      // palette indices
+        };
+
+        struct format
+        {
+            format_kind kind;
+            color_type type;
+            int bit_depth;
+        };
+
+        /**
+         * \brief Compression settings; a negative level stands for
+         * the libpng defaults.
+         */
+        struct setting
+        {
+            int level;
+            int filters;
+            compression_strategy strategy;
+        };
+
+        /**
+         * \brief Encodes the %image in one format with one setting,
+         * collecting the output or the error message.
+         */
+        struct encoder
+        {
+            encoder(optimizer const* owner, format const& fmt,
+                    setting const& set)
+                : m_owner(owner),
+                  m_format(fmt),
+                  m_setting(set)
+            {
+            }
+
+            void run()
+            {
+                try
+                {
+                    std::ostringstream stream;
+                    m_owner->encode(stream, m_format, m_setting);
+                    m_output = stream.str();
+                }
+                catch (std::exception const& ex)
+                {
+                    m_error = ex.what();
+                }
+            }
+
+            optimizer const* m_owner;
+            format m_format;
+            setting m_setting;
+            std::string m_output;
+            std::string m_error;
+        };
+
+        enum
+        {
+            channels = traits::channels,
+            bit_depth = traits::bit_depth
+        };
+
+        static bool has_color()
+        {
+            return (traits::get_color_type() & color_mask_rgb) != 0;
+        }
+
+        static bool has_alpha()
+        {
+            return (traits::get_color_type() & color_mask_alpha) != 0;
+        }
+
+        /**
+         * \brief Returns the low byte of a \a component; only used for
+         * 8-bit formats.
+         */
+        static byte get_byte(component value)
+        {
+            return byte(value & 0xff);
+        }
+
+        /**
+         * \brief Packs 8-bit channels of a pixel into a palette key.
+         */
+        static uint_32 get_key(component const* pix)
+        {
+            uint_32 key = 0;
+            for (int i = 0; i < channels; ++i)
+            {
+                key = (key << 8) | get_byte(pix[i]);
+            }
+            return key;
+        }
+
+        component const* get_row(size_t y) const
+        {
+            return reinterpret_cast< component const* >
+                (row_traits::get_data(m_pixbuf->get_row(y)));
+        }
+
+        /**
+         * \brief Scans the pixels and lists the candidate formats.
+         * The first one is the format of the source, to be encoded
+         * with the libpng defaults.
+         */
+        void find_formats(std::vector< format >& formats)
+        {
+            color_type src_type = traits::get_color_type();
+            if (src_type == color_type_palette || bit_depth < 8)
+            {
+                format fmt = { format_raw, src_type, bit_depth };
+                formats.push_back(fmt);
+                formats.push_back(fmt);
+                return;
+            }
+            format source = { format_direct, src_type, bit_depth };
+            formats.push_back(source);
+
+            bool opaque = true;
+            bool gray = true;
+            // gray levels representable with 4, 2 and 1 bits
+            bool levels_4 = true;
+            bool levels_2 = true;
+            bool levels_1 = true;
+            bool indexable = bit_depth == 8;
+
+            m_keys.assign(key_table_size, 0);
+            m_indices.assign(key_table_size, -1);
+            std::vector< uint_32 > colors;
+
+            component const max_value = std::numeric_limits< component >::max();
+            size_t width = m_info.get_width();
+            for (size_t y = 0; y < m_info.get_height(); ++y)
+            {
+                component const* row = get_row(y);
+                uint_32 last_key = 0;
+                bool have_last = false;
+                for (size_t x = 0; x < width; ++x, row += channels)
+                {
+                    if (has_alpha() && row[channels - 1] != max_value)
+                    {
+                        opaque = false;
+                    }
+                    if (has_color() && (row[0] != row[1] || row[0] != row[2]))
+                    {
+                        gray = false;
+                    }
+                    if (levels_4)
+                    {
+                        byte level = get_byte(row[0]);
+                        levels_4 = level % 17 == 0;
+                        levels_2 = levels_2 && level % 85 == 0;
+                        levels_1 = levels_1 && level % 255 == 0;
+                    }
+                    if (indexable)
+                    {
+                        uint_32 key = get_key(row);
+                        if (!have_last || key != last_key)
+                        {
+                            if (find_key(key) < 0)
+                            {
+                                if (colors.size() == 256)
+                                {
+                                    indexable = false;
+                                    continue;
+                                }
+                                insert_key(key, 0);
+                                colors.push_back(key);
+                            }
+                            last_key = key;
+                            have_last = true;
+                        }
+                    }
+                }
+            }
+
+            int direct_type = (gray ? color_type_gray : color_type_rgb)
+                | (opaque ? 0 : color_mask_alpha);
+            int direct_depth = bit_depth;
+            format direct = { format_direct, color_type(direct_type),
+                              direct_depth };
+            if (gray && opaque && direct_depth == 8)
+            {
+                direct.kind = levels_1 || levels_2 || levels_4
+                    ? format_gray_packed : format_direct;
+                direct.bit_depth = levels_1 ? 1 : levels_2 ? 2 : levels_4 ? 4 : 8;
+            }
+            formats.push_back(direct);
+
+            if (indexable)
+            {
+                make_palette(colors);
+                size_t count = colors.size();
+                int depth = count <= 2 ? 1 : count <= 4 ? 2 : count <= 16 ? 4 : 8;
+                // a gray image of the same depth needs no PLTE
+                if (!(direct.type == color_type_gray
+                      && direct.bit_depth <= depth))
+                {
+                    format indexed = { format_indexed, color_type_palette,
+                                       depth };
+                    formats.push_back(indexed);
+                }
+            }
+        }
+
+        /**
+         * \brief Assigns palette indices to \a colors, translucent
+         * colors first, and builds the palette and tRNS.
+         */
+        void make_palette(std::vector< uint_32 > const& colors)
+        {
+            m_palette.clear();
+            m_tRNS.clear();
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (size_t i = 0; i < colors.size(); ++i)
+                {
+                    uint_32 key = colors[i];
+                    byte alpha = has_alpha() ? byte(key & 0xff) : 0xff;
+                    if ((alpha != 0xff) != (pass == 0))
+                    {
+                        continue;
+                    }
+                    uint_32 rgb = has_alpha() ? key >> 8 : key;
+                    color entry = has_color()
+                        ? color(byte(rgb >> 16), byte(rgb >> 8), byte(rgb))
+                        : color(byte(rgb), byte(rgb), byte(rgb));
+                    insert_key(key, int(m_palette.size()));
+                    m_palette.push_back(entry);
+                    if (pass == 0)
+                    {
+                        m_tRNS.push_back(alpha);
+                    }
+                }
+            }
+        }
+
+        enum { key_table_size = 1024 };
+
+        static size_t hash_key(uint_32 key)
+        {
+            return ((key * 0x9e3779b1u) >> 22) & (key_table_size - 1);
+        }
+
+        int find_key(uint_32 key) const
+        {
+            for (size_t i = hash_key(key); ; i = (i + 1) & (key_table_size - 1))
+            {
+                if (m_indices[i] < 0)
+                {
+                    return -1;
+                }
+                if (m_keys[i] == key)
+                {
+                    return m_indices[i];
+                }
+            }
+        }
+
+        void insert_key(uint_32 key, int index)
+        {
+            for (size_t i = hash_key(key); ; i = (i + 1) & (key_table_size - 1))
+            {
+                if (m_indices[i] < 0 || m_keys[i] == key)
+                {
+                    m_keys[i] = key;
+                    m_indices[i] = index;
+                    return;
+                }
+            }
+        }
+
+        /**
+         * \brief Appends \a value of \a depth bits to a packed row.
+         */
+        static void pack(byte*& out, size_t x, int depth, byte value)
+        {
+            size_t per_byte = 8 / depth;
+            int shift = int(8 - depth * (x % per_byte + 1));
+            if (x % per_byte == 0)
+            {
+                *out = 0;
+            }
+            *out |= byte(value << shift);
+            if (x % per_byte == per_byte - 1)
+            {
+                ++out;
+            }
+        }
+
+        void convert_row(component const* row, byte* out,
+                         format const& fmt) const
+        {
+            size_t width = m_info.get_width();
+            switch (fmt.kind)
+            {
+            case format_raw:
+                std::memcpy(out, row, (width * channels * bit_depth + 7) / 8);
+                break;
+
+            case format_direct:
+                {
+                    bool color = (fmt.type & color_mask_rgb) != 0;
+                    bool alpha = (fmt.type & color_mask_alpha) != 0;
+                    for (size_t x = 0; x < width; ++x, row += channels)
+                    {
+                        component values[4];
+                        int count = 0;
+                        values[count++] = row[0];
+                        if (color)
+                        {
+                            values[count++] = row[1];
+                            values[count++] = row[2];
+                        }
+                        if (alpha)
+                        {
+                            values[count++] = row[channels - 1];
+                        }
+                        for (int i = 0; i < count; ++i)
+                        {
+                            if (fmt.bit_depth == 16)
+                            {
+                                *out++ = byte(values[i] >> 8);
+                            }
+                            *out++ = get_byte(values[i]);
+                        }
+                    }
+                }
+                break;
+
+            case format_gray_packed:
+                {
+                    int scale = 255 / ((1 << fmt.bit_depth) - 1);
+                    for (size_t x = 0; x < width; ++x, row += channels)
+                    {
+                        pack(out, x, fmt.bit_depth,
+                             byte(get_byte(row[0]) / scale));
+                    }
+                }
+                break;
+
+            case format_indexed:
+                {
+                    uint_32 last_key = get_key(row);
+                    byte index = byte(find_key(last_key));
+                    for (size_t x = 0; x < width; ++x, row += channels)
+                    {
+                        uint_32 key = get_key(row);
+                        if (key != last_key)
+                        {
+                            last_key = key;
+                            index = byte(find_key(key));
+                        }
+                        if (fmt.bit_depth == 8)
+                        {
+                            *out++ = index;
+                        }
+                        else
+                        {
+                            pack(out, x, fmt.bit_depth, index);
+                        }
+                    }
+                }
+                break;
+            }
+        }
+
+        template< class ostream >
+        void encode(ostream& stream, format const& fmt,
+                    setting const& set) const
+        {
+            image_info info(m_info);
+            info.set_color_type(fmt.type);
+            info.set_bit_depth(fmt.bit_depth);
+            if (fmt.kind == format_indexed)
+            {
+                info.set_palette(m_palette);
+                info.set_tRNS(m_tRNS);
+            }
+            else if (fmt.kind != format_raw)
+            {
+                info.set_palette(palette());
+                info.set_tRNS(tRNS());
+            }
+
+            writer< ostream > wr(stream);
+            wr.set_image_info(info);
+            if (set.level >= 0)
+            {
+                wr.set_compression_level(set.level);
+                wr.set_compression_strategy(set.strategy);
+                wr.set_filter(set.filters);
+            }
+            wr.write_info();
+
+            size_t pass_count = 1;
+            if (info.get_interlace_type() != interlace_none)
+            {
+#ifdef PNG_WRITE_INTERLACING_SUPPORTED
+                pass_count = wr.set_interlace_handling();
+#else
+                throw error("Cannot write interlaced image: interlace handling disabled.");
+#endif
+            }
+
+            size_t out_channels = fmt.kind == format_raw ? channels
+                : fmt.type == color_type_palette ? 1
+                : ((fmt.type & color_mask_rgb) ? 3 : 1)
+                  + ((fmt.type & color_mask_alpha) ? 1 : 0);
+            std::vector< byte > out((info.get_width() * out_channels
+                                     * fmt.bit_depth + 7) / 8 + 1);
+            for (size_t pass = 0; pass < pass_count; ++pass)
+            {
+                for (uint_32 y = 0; y < info.get_height(); ++y)
+                {
+                    convert_row(get_row(y), & out[0], fmt);
+                    wr.write_row(& out[0]);
+                }
+            }
+            wr.write_end_info();
+        }
+
+        image_info const& m_info;
+        pixbuf* m_pixbuf;
+        std::vector< uint_32 > m_keys;
+        std::vector< int > m_indices;
+        palette m_palette;
+        tRNS m_tRNS;
+    };
+
+} // namespace png
+
+#endif // PNGPP_OPTIMIZER_HPP_INCLUDED
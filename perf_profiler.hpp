@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_PERF_PROFILER_HPP_INCLUDED
+#define PNGPP_PERF_PROFILER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstring>
+#include "config.hpp"
+
+#ifdef PNGPP_HAS_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief Hardware event counts collected by perf_profiler.
+     *
+     * Counts are kept as \c double so that sums over many runs do
+     * not overflow where \c long is 32 bits.  A count is negative if
+     * the event could not be counted on this machine; \c runs is
+     * zero if no counter was available at all.
+     */
+    struct perf_counters
+    {
+        perf_counters()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            runs = 0;
+            cycles = 0;
+            instructions = 0;
+            cache_misses = 0;
+            branch_misses = 0;
+        }
+
+        /**
+         * \brief Returns instructions per cycle, or zero if unknown.
+         */
+        double get_ipc() const
+        {
+            return cycles > 0 && instructions >= 0
+                ? instructions / cycles : 0;
+        }
+
+        /// number of profiled scopes that were counted
+        size_t runs;
+        /// CPU cycles spent in user space
+        double cycles;
+        /// instructions retired in user space
+        double instructions;
+        /// last level cache misses
+        double cache_misses;
+        /// mispredicted branches
+        double branch_misses;
+    };
+
+    /**
+     * \brief Counts CPU cycles, instructions, cache misses and
+     * branch misses of the calling thread until it goes out of scope
+     * (or stop() is called) and adds them to a perf_counters object.
+     *
+     * \code
+     * png::perf_counters counters;
+     * {
+     *     png::perf_profiler profile(counters);
+     *     image.read(filename);
+     * }
+     * double cycles_per_pixel = counters.cycles / pixels;
+     * \endcode
+     *
+     * Uses Linux \c perf_event_open(); on other systems, or when the
+     * kernel refuses access (see \c /proc/sys/kernel/perf_event_paranoid),
+     * is_available() returns \c false and nothing is counted.  Only
+     * user space events of the calling thread are counted, so worker
+     * threads started inside the scope are not included.  Counts are
+     * scaled if the kernel had to multiplex the counters.
+     */
+    class perf_profiler
+    {
+    public:
+        explicit perf_profiler(perf_counters& counters)
+            : m_counters(counters),
+              m_running(false)
+        {
+            start();
+        }
+
+        ~perf_profiler()
+        {
+            stop();
+        }
+
+        /**
+         * \brief Returns whether hardware counters can be read in
+         * this process.
+         */
+        static bool is_available()
+        {
+#ifdef PNGPP_HAS_PERF_EVENT
+            int fd = open_event(PERF_COUNT_HW_CPU_CYCLES, -1);
+            if (fd < 0)
+            {
+                return false;
+            }
+            close(fd);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * \brief Stops counting and adds the counts to the
+         * perf_counters object.  Called by the destructor.
+         */
+        void stop()
+        {
+#ifdef PNGPP_HAS_PERF_EVENT
+            if (!m_running)
+            {
+                return;
+            }
+            m_running = false;
+            ioctl(m_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+            // PERF_FORMAT_GROUP layout: nr, time_enabled,
+            // time_running, then one value per opened event
+            __u64 data[3 + event_count];
+            ssize_t size = read(m_fds[0], data, sizeof(data));
+            bool valid = size >= ssize_t(3 * sizeof(__u64))
+                && data[0] <= event_count;
+            double scale = valid && data[2] != 0
+                ? double(data[1]) / double(data[2]) : 0;
+            double* totals[event_count] =
+            {
+                & m_counters.cycles,
+                & m_counters.instructions,
+                & m_counters.cache_misses,
+                & m_counters.branch_misses
+            };
+            size_t value = 3;
+            for (size_t i = 0; i < event_count; ++i)
+            {
+                if (m_fds[i] < 0)
+                {
+                    *totals[i] = -1;
+                    continue;
+                }
+                if (valid && *totals[i] >= 0)
+                {
+                    *totals[i] += double(data[value]) * scale;
+                }
+                ++value;
+                close(m_fds[i]);
+            }
+            if (valid)
+            {
+                ++m_counters.runs;
+            }
+#endif
+        }
+
+    private:
+        perf_profiler(perf_profiler const&);
+        perf_profiler& operator=(perf_profiler const&);
+
+#ifdef PNGPP_HAS_PERF_EVENT
+        static size_t const event_count = 4;
+
+        static int open_event(__u64 config, int group)
+        {
+            perf_event_attr attr;
+            std::memset(& attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.disabled = group < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP
+                | PERF_FORMAT_TOTAL_TIME_ENABLED
+                | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return int(syscall(__NR_perf_event_open, & attr, 0, -1,
+                               group, 0));
+        }
+#endif
+
+        void start()
+        {
+#ifdef PNGPP_HAS_PERF_EVENT
+            static __u64 const events[event_count] =
+            {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES
+            };
+            m_fds[0] = open_event(events[0], -1);
+            if (m_fds[0] < 0)
+            {
+                return;
+            }
+            for (size_t i = 1; i < event_count; ++i)
+            {
+                m_fds[i] = open_event(events[i], m_fds[0]);
+            }
+            m_running = true;
+            ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        perf_counters& m_counters;
+        bool m_running;
+#ifdef PNGPP_HAS_PERF_EVENT
+        int m_fds[event_count];
+#endif
+    };
+
+} // namespace png
+
+#endif // PNGPP_PERF_PROFILER_HPP_INCLUDED
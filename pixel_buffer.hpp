@@ -415,6 +415,15 @@ namespace png
             return & m_vec[0];
         }
 
+        /**
+         * \brief Returns the starting address of the row.
+         */
+        byte const* get_data() const
+        {
+            assert(m_vec.size());
+            return & m_vec[0];
+        }
+
     private:
         static size_t get_pixels_per_byte()
         {
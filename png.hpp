@@ -35,6 +35,9 @@
 
 #include "config.hpp"
 #include "types.hpp"
+#include "io_stats.hpp"
+#include "perf_profiler.hpp"
+#include "trace.hpp"
 #include "error.hpp"
 #include "color.hpp"
 #include "palette.hpp"
@@ -50,14 +53,32 @@
 #include "end_info.hpp"
 #include "io_base.hpp"
 #include "reader.hpp"
+#include "read_options.hpp"
 #include "writer.hpp"
+#include "write_options.hpp"
 #include "generator.hpp"
 #include "consumer.hpp"
 #include "pixel_buffer.hpp"
 #include "solid_pixel_buffer.hpp"
+#include "mapped_pixel_buffer.hpp"
 #include "require_color_space.hpp"
 #include "convert_color_space.hpp"
+#include "optimizer.hpp"
+#include "transcode.hpp"
 #include "image.hpp"
+#include "quantize.hpp"
+#include "expand_palette.hpp"
+#include "adam7.hpp"
+#include "thumbnail_consumer.hpp"
+#include "resize.hpp"
+#include "row_pipeline.hpp"
+#include "row_stages.hpp"
+#include "premultiply.hpp"
+#include "metadata.hpp"
+#include "apng.hpp"
+#include "decode_service.hpp"
+#include "lazy_image.hpp"
+#include "image_cache.hpp"
 
 /**
  * \mainpage
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_PREMULTIPLY_HPP_INCLUDED
+#define PNGPP_PREMULTIPLY_HPP_INCLUDED
+
+#include "types.hpp"
+#include "pixel_traits.hpp"
+#include "image.hpp"
+#include "solid_pixel_buffer.hpp"
+#include "row_pipeline.hpp"
+
+namespace png
+{
+
+    namespace detail
+    {
+
+        /**
+         * \brief Reciprocals of 8-bit alpha values: for any color c
+         * and alpha a, (c * table[a] + 32768) >> 16 is c * 255 / a
+         * rounded to the nearest integer.  The entry for zero alpha
+         * is zero, so fully transparent pixels come out black.
+         */
+        template< typename T >
+        struct unpremultiply_table
+        {
+            static uint_32 const reciprocals[256];
+        };
+
+        template< typename T >
+        uint_32 const unpremultiply_table< T >::reciprocals[256] =
+        {
+            0, 16711681, 8355841, 5570561, 4177921, 3342337,
+            2785281, 2387383, 2088961, 1856854, 1671169, 1519244,
+            1392641, 1285514, 1193692, 1114113, 1044481, 983041,
+            928427, 879563, 835585, 795795, 759622, 726595,
+            696321, 668468, 642757, 618952, 596846, 576265,
+            557057, 539087, 522241, 506415, 491521, 477477,
+            464214, 451668, 439782, 428505, 417793, 407602,
+            397898, 388644, 379811, 371371, 363298, 355568,
+            348161, 341055, 334234, 327681, 321379, 315315,
+            309476, 303849, 298423, 293188, 288133, 283249,
+            278529, 273962, 269544, 265265, 261121, 257103,
+            253208, 249429, 245761, 242199, 238739, 235376,
+            232107, 228928, 225834, 222823, 219891, 217035,
+            214253, 211541, 208897, 206318, 203801, 201346,
+            198949, 196609, 194322, 192089, 189906, 187772,
+            185686, 183645, 181649, 179696, 177784, 175913,
+            174081, 172286, 170528, 168805, 167117, 165463,
+            163841, 162250, 160690, 159159, 157658, 156184,
+            154738, 153319, 151925, 150556, 149212, 147891,
+            146594, 145319, 144067, 142835, 141625, 140435,
+            139265, 138114, 136981, 135868, 134772, 133694,
+            132633, 131589, 130561, 129548, 128552, 127571,
+            126604, 125652, 124715, 123791, 122881, 121984,
+            121100, 120228, 119370, 118523, 117688, 116865,
+            116054, 115253, 114464, 113685, 112917, 112159,
+            111412, 110674, 109946, 109227, 108518, 107818,
+            107127, 106444, 105771, 105105, 104449, 103800,
+            103159, 102526, 101901, 101283, 100673, 100070,
+            99475, 98886, 98305, 97730, 97161, 96600,
+            96045, 95496, 94953, 94417, 93886, 93362,
+            92843, 92330, 91823, 91321, 90825, 90334,
+            89848, 89368, 88892, 88422, 87957, 87496,
+            87041, 86590, 86143, 85701, 85264, 84831,
+            84403, 83979, 83559, 83143, 82732, 82324,
+            81921, 81521, 81125, 80733, 80345, 79961,
+            79580, 79203, 78829, 78459, 78092, 77729,
+            77369, 77013, 76660, 76310, 75963, 75619,
+            75278, 74941, 74606, 74275, 73946, 73620,
+            73297, 72977, 72660, 72345, 72034, 71724,
+            71418, 71114, 70813, 70514, 70218, 69924,
+            69633, 69344, 69057, 68773, 68491, 68211,
+            67934, 67659, 67386, 67116, 66847, 66581,
+            66317, 66055, 65795, 65537
+        };
+
+        /**
+         * \brief Exactly rounded alpha arithmetic for 8- and 16-bit
+         * components.
+         */
+        template< int bit_depth >
+        struct alpha_math;
+
+        template<>
+        struct alpha_math< 8 >
+        {
+            static byte multiply(uint_32 color, uint_32 alpha)
+            {
+                uint_32 t = color * alpha + 128;
+                return byte((t + (t >> 8)) >> 8);
+            }
+
+            static byte divide(uint_32 color, uint_32 alpha)
+            {
+                uint_32 t = (color * unpremultiply_table< void >
+                             ::reciprocals[alpha] + 32768) >> 16;
+                return byte(t < 255 ? t : 255);
+            }
+        };
+
+        template<>
+        struct alpha_math< 16 >
+        {
+            static uint_16 multiply(uint_32 color, uint_32 alpha)
+            {
+                uint_32 t = color * alpha + 32768;
+                return uint_16((t + (t >> 16)) >> 16);
+            }
+
+            static uint_16 divide(uint_32 color, uint_32 alpha)
+            {
+                if (alpha == 0)
+                {
+                    return 0;
+                }
+                uint_32 t = (color * 65535 + alpha / 2) / alpha;
+                return uint_16(t < 65535 ? t : 65535);
+            }
+        };
+
+    } // namespace detail
+
+    /**
+     * \brief Multiplies the color components of a row of pixels by
+     * their alpha, rounding to the nearest integer.
+     *
+     * The pixel type must be one of rgba_pixel, rgba_pixel_16,
+     * ga_pixel or ga_pixel_16.
+     */
+    template< typename pixel >
+    void premultiply_row(pixel* row, size_t width)
+    {
+        typedef pixel_traits< pixel > traits;
+        typedef typename traits::component_type component;
+        typedef detail::alpha_math< traits::bit_depth > math;
+        size_t const channels = traits::channels;
+
+        component* c = reinterpret_cast< component* >(row);
+        for (size_t x = 0; x < width; ++x, c += channels)
+        {
+            uint_32 alpha = c[channels - 1];
+            for (size_t i = 0; i < channels - 1; ++i)
+            {
+                c[i] = math::multiply(c[i], alpha);
+            }
+        }
+    }
+
+    /**
+     * \brief Divides the color components of a row of premultiplied
+     * pixels by their alpha, rounding to the nearest integer.
+     *
+     * Color components of fully transparent pixels become zero.  The
+     * 8-bit types use a table of reciprocals instead of division.
+     */
+    template< typename pixel >
+    void unpremultiply_row(pixel* row, size_t width)
+    {
+        typedef pixel_traits< pixel > traits;
+        typedef typename traits::component_type component;
+        typedef detail::alpha_math< traits::bit_depth > math;
+        size_t const channels = traits::channels;
+
+        component* c = reinterpret_cast< component* >(row);
+        for (size_t x = 0; x < width; ++x, c += channels)
+        {
+            uint_32 alpha = c[channels - 1];
+            for (size_t i = 0; i < channels - 1; ++i)
+            {
+                c[i] = math::divide(c[i], alpha);
+            }
+        }
+    }
+
+    /**
+     * \brief Premultiplies the alpha of an %image in place.
+     */
+    template< typename pixel, typename pixbuf >
+    void premultiply(image< pixel, pixbuf >& img)
+    {
+        typedef typename pixbuf::row_traits row_traits;
+        for (size_t y = 0; y < img.get_height(); ++y)
+        {
+            premultiply_row(reinterpret_cast< pixel* >
+                            (row_traits::get_data(img.get_row(y))),
+                            img.get_width());
+        }
+    }
+
+    /**
+     * \brief Premultiplies the alpha of an %image stored in a
+     * solid_pixel_buffer in one pass over the whole buffer.
+     */
+    template< typename pixel >
+    void premultiply(image< pixel, solid_pixel_buffer< pixel > >& img)
+    {
+        if (img.get_height() != 0)
+        {
+            premultiply_row(img.get_row(0),
+                            size_t(img.get_width()) * img.get_height());
+        }
+    }
+
+    /**
+     * \brief Reverts premultiplied alpha of an %image in place.
+     */
+    template< typename pixel, typename pixbuf >
+    void unpremultiply(image< pixel, pixbuf >& img)
+    {
+        typedef typename pixbuf::row_traits row_traits;
+        for (size_t y = 0; y < img.get_height(); ++y)
+        {
+            unpremultiply_row(reinterpret_cast< pixel* >
+                              (row_traits::get_data(img.get_row(y))),
+                              img.get_width());
+        }
+    }
+
+    /**
+     * \brief Reverts premultiplied alpha of an %image stored in a
+     * solid_pixel_buffer in one pass over the whole buffer.
+     */
+    template< typename pixel >
+    void unpremultiply(image< pixel, solid_pixel_buffer< pixel > >& img)
+    {
+        if (img.get_height() != 0)
+        {
+            unpremultiply_row(img.get_row(0),
+                              size_t(img.get_width()) * img.get_height());
+        }
+    }
+
+    /**
+     * \brief Row pipeline stage premultiplying alpha in place.
+     */
+    template< typename pixel >
+    class premultiply_stage
+        : public row_stage< premultiply_stage< pixel > >
+    {
+    public:
+        typedef pixel input_pixel;
+        typedef pixel output_pixel;
+
+        void start(uint_32& /*width*/, uint_32& /*height*/)
+        {
+        }
+
+        bool process(row_view< pixel >& in, row_view< pixel >& out)
+        {
+            premultiply_row(in.data, in.width);
+            out = in;
+            return true;
+        }
+    };
+
+    /**
+     * \brief Row pipeline stage reverting premultiplied alpha in
+     * place, e.g. before encoding.
+     */
+    template< typename pixel >
+    class unpremultiply_stage
+        : public row_stage< unpremultiply_stage< pixel > >
+    {
+    public:
+        typedef pixel input_pixel;
+        typedef pixel output_pixel;
+
+        void start(uint_32& /*width*/, uint_32& /*height*/)
+        {
+        }
+
+        bool process(row_view< pixel >& in, row_view< pixel >& out)
+        {
+            unpremultiply_row(in.data, in.width);
+            out = in;
+            return true;
+        }
+    };
+
+} // namespace png
+
+#endif // PNGPP_PREMULTIPLY_HPP_INCLUDED
@@ -0,0 +1,612 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_QUANTIZE_HPP_INCLUDED
+#define PNGPP_QUANTIZE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "palette.hpp"
+#include "tRNS.hpp"
+#include "rgba_pixel.hpp"
+#include "index_pixel.hpp"
+#include "image.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <thread>
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief Reduces RGBA images to indexed colors.
+     *
+     * If the source %image uses no more than the requested number of
+     * colors it is converted losslessly.  Otherwise the palette is
+     * built with the median-cut algorithm over a histogram of the
+     * source pixels, taken with 5 bits per color channel and 4 bits
+     * of alpha.  The histogram of large images is collected by
+     * several threads when std::thread is available.
+     *
+     * Pixels are mapped to the nearest palette entry.  The result of
+     * the search is cached per histogram cell, so the palette is
+     * searched once per distinct cell rather than once per pixel.
+     * Optionally, the quantization error is diffused to the
+     * neighbouring pixels (Floyd-Steinberg dithering).
+     *
+     * Translucent palette entries are placed first, so that the tRNS
+     * chunk of the resulting %image is as short as possible.
+     *
+     * \see quantize(), convert_color_space
+     */
+    class quantizer
+    {
+    public:
+        /**
+         * \brief Constructs a quantizer producing at most \a
+         * max_colors palette entries.
+         */
+        explicit quantizer(size_t max_colors = 256, bool dither = false)
+            : m_max_colors(max_colors),
+              m_dither(dither)
+        {
+        }
+
+        size_t get_max_colors() const
+        {
+            return m_max_colors;
+        }
+
+        void set_max_colors(size_t max_colors)
+        {
+            m_max_colors = max_colors;
+        }
+
+        bool get_dither() const
+        {
+            return m_dither;
+        }
+
+        void set_dither(bool dither)
+        {
+            m_dither = dither;
+        }
+
+        /**
+         * \brief Quantizes the \a src %image into \a dst, replacing
+         * its pixels, palette and tRNS.
+         */
+        template< class src_pixbuf, class dst_pixbuf >
+        void quantize(image< rgba_pixel, src_pixbuf > const& src,
+                      image< index_pixel, dst_pixbuf >& dst) const
+        {
+            if (m_max_colors < 1 || m_max_colors > 256)
+            {
+                throw error("quantizer: number of colors should be 1..256");
+            }
+
+            std::vector< rgba_pixel > colors;
+            dst.resize(src.get_width(), src.get_height());
+            if (!map_exact_colors(src, dst, colors))
+            {
+                std::vector< cell > cells;
+                make_histogram(src, cells);
+                median_cut(cells, colors);
+                map_nearest_colors(src, dst, colors);
+            }
+            set_palette(dst, colors);
+        }
+
+    private:
+        /**
+         * \brief The histogram cell: the color at the cell center and
+         * the number of pixels falling into the cell.
+         */
+        struct cell
+        {
+            byte c[4];
+            size_t count;
+        };
+
+        /**
+         * \brief A box of histogram cells, see median_cut().
+         */
+        struct box
+        {
+            size_t begin;
+            size_t end;
+            int axis;
+            double score;
+        };
+
+        struct cell_less
+        {
+            explicit cell_less(int axis)
+                : m_axis(axis)
+            {
+            }
+
+            bool operator()(cell const& lhs, cell const& rhs) const
+            {
+                return lhs.c[m_axis] < rhs.c[m_axis];
+            }
+
+            int m_axis;
+        };
+
+        enum { cell_count = 1 << 19 };
+
+        static uint_32 get_cell(int r, int g, int b, int a)
+        {
+            return (uint_32(r >> 3) << 14) | (uint_32(g >> 3) << 9)
+                | (uint_32(b >> 3) << 4) | uint_32(a >> 4);
+        }
+
+        static uint_32 get_cell(rgba_pixel const& p)
+        {
+            return get_cell(p.red, p.green, p.blue, p.alpha);
+        }
+
+        static uint_32 pack(rgba_pixel const& p)
+        {
+            return (uint_32(p.red) << 24) | (uint_32(p.green) << 16)
+                | (uint_32(p.blue) << 8) | uint_32(p.alpha);
+        }
+
+        /**
+         * \brief Maps the pixels of \a src to the exact colors.
+         * Gives up and returns \c false as soon as more than
+         * m_max_colors distinct colors are found.
+         */
+        template< class src_pixbuf, class dst_pixbuf >
+        bool map_exact_colors(image< rgba_pixel, src_pixbuf > const& src,
+                              image< index_pixel, dst_pixbuf >& dst,
+                              std::vector< rgba_pixel >& colors) const
+        {
+            // open addressing hash, kept sparse: at most 256 entries
+            size_t const slot_count = 4096;
+            std::vector< uint_32 > keys(slot_count);
+            std::vector< int > slots(slot_count, -1);
+            colors.clear();
+
+            uint_32 last_key = 0;
+            int last_index = -1;
+            for (size_t y = 0; y < src.get_height(); ++y)
+            {
+                for (size_t x = 0; x < src.get_width(); ++x)
+                {
+                    rgba_pixel const& p = src[y][x];
+                    uint_32 key = pack(p);
+                    if (last_index < 0 || key != last_key)
+                    {
+                        size_t slot = (key * 2654435761u) >> 20;
+                        while (slots[slot] >= 0 && keys[slot] != key)
+                        {
+                            slot = (slot + 1) % slot_count;
+                        }
+                        if (slots[slot] < 0)
+                        {
+                            if (colors.size() == m_max_colors)
+                            {
+                                return false;
+                            }
+                            keys[slot] = key;
+                            slots[slot] = (int) colors.size();
+                            colors.push_back(p);
+                        }
+                        last_key = key;
+                        last_index = slots[slot];
+                    }
+                    dst[y][x] = index_pixel(last_index);
+                }
+            }
+            return true;
+        }
+
+        template< class src_pixbuf >
+        struct histogram_job
+        {
+            histogram_job(image< rgba_pixel, src_pixbuf > const& src,
+                          size_t begin, size_t end,
+                          std::vector< size_t >& counts)
+                : m_src(& src),
+                  m_begin(begin),
+                  m_end(end),
+                  m_counts(& counts)
+            {
+            }
+
+            void operator()() const
+            {
+                std::vector< size_t >& counts = *m_counts;
+                counts.assign(cell_count, 0);
+                for (size_t y = m_begin; y < m_end; ++y)
+                {
+                    for (size_t x = 0; x < m_src->get_width(); ++x)
+                    {
+                        ++counts[get_cell((*m_src)[y][x])];
+                    }
+                }
+            }
+
+            image< rgba_pixel, src_pixbuf > const* m_src;
+            size_t m_begin;
+            size_t m_end;
+            std::vector< size_t >* m_counts;
+        };
+
+        /**
+         * \brief Collects the non-empty histogram cells of \a src.
+         */
+        template< class src_pixbuf >
+        static void make_histogram(image< rgba_pixel, src_pixbuf > const& src,
+                                   std::vector< cell >& cells)
+        {
+            typedef histogram_job< src_pixbuf > job;
+
+            size_t height = src.get_height();
+            size_t jobs = 1;
+#ifdef PNGPP_HAS_STD_THREAD
+            // not worth spawning threads for small images
+            if (size_t(src.get_width()) * height >= (1 << 20))
+            {
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+                jobs = std::min(jobs, height);
+            }
+#endif
+            std::vector< std::vector< size_t > > counts(jobs);
+#ifdef PNGPP_HAS_STD_THREAD
+            std::vector< std::thread > threads;
+            for (size_t i = 1; i < jobs; ++i)
+            {
+                threads.push_back(std::thread(job(src, height * i / jobs,
+                                                  height * (i + 1) / jobs,
+                                                  counts[i])));
+            }
+#endif
+            job(src, 0, height / jobs, counts[0])();
+#ifdef PNGPP_HAS_STD_THREAD
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+#endif
+            cells.clear();
+            for (uint_32 i = 0; i < cell_count; ++i)
+            {
+                size_t count = 0;
+                for (size_t j = 0; j < jobs; ++j)
+                {
+                    count += counts[j][i];
+                }
+                if (count)
+                {
+                    // replicate the high bits to span the whole range
+                    uint_32 r = (i >> 14) & 0x1f;
+                    uint_32 g = (i >> 9) & 0x1f;
+                    uint_32 b = (i >> 4) & 0x1f;
+                    uint_32 a = i & 0xf;
+                    cell c;
+                    c.c[0] = byte((r << 3) | (r >> 2));
+                    c.c[1] = byte((g << 3) | (g >> 2));
+                    c.c[2] = byte((b << 3) | (b >> 2));
+                    c.c[3] = byte((a << 4) | a);
+                    c.count = count;
+                    cells.push_back(c);
+                }
+            }
+        }
+
+        static void measure_box(std::vector< cell > const& cells, box& b)
+        {
+            int lo[4] = { 255, 255, 255, 255 };
+            int hi[4] = { 0, 0, 0, 0 };
+            double population = 0;
+            for (size_t i = b.begin; i < b.end; ++i)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    lo[k] = std::min(lo[k], int(cells[i].c[k]));
+                    hi[k] = std::max(hi[k], int(cells[i].c[k]));
+                }
+                population += cells[i].count;
+            }
+            b.axis = 0;
+            for (int k = 1; k < 4; ++k)
+            {
+                if (hi[k] - lo[k] > hi[b.axis] - lo[b.axis])
+                {
+                    b.axis = k;
+                }
+            }
+            int range = hi[b.axis] - lo[b.axis];
+            b.score = (b.end - b.begin > 1 && range > 0)
+                ? population * range : 0;
+        }
+
+        /**
+         * \brief Splits the histogram into at most m_max_colors boxes
+         * and stores the weighted average color of each box.
+         */
+        void median_cut(std::vector< cell >& cells,
+                        std::vector< rgba_pixel >& colors) const
+        {
+            std::vector< box > boxes;
+            box all;
+            all.begin = 0;
+            all.end = cells.size();
+            measure_box(cells, all);
+            boxes.push_back(all);
+
+            while (boxes.size() < m_max_colors)
+            {
+                size_t pick = 0;
+                for (size_t i = 1; i < boxes.size(); ++i)
+                {
+                    if (boxes[i].score > boxes[pick].score)
+                    {
+                        pick = i;
+                    }
+                }
+                box& b = boxes[pick];
+                if (b.score == 0)
+                {
+                    break;
+                }
+
+                std::sort(cells.begin() + b.begin, cells.begin() + b.end,
+                          cell_less(b.axis));
+                double half = 0;
+                for (size_t i = b.begin; i < b.end; ++i)
+                {
+                    half += cells[i].count;
+                }
+                half /= 2;
+
+                // split at the weighted median, moved to the closest
+                // boundary between distinct values along the axis (there
+                // is at least one, since the range is not empty)
+                size_t split = b.begin + 1;
+                double sum = cells[b.begin].count;
+                while (split < b.end - 1 && sum < half)
+                {
+                    sum += cells[split++].count;
+                }
+                size_t lower = split;
+                while (lower > b.begin
+                       && cells[lower].c[b.axis] == cells[lower - 1].c[b.axis])
+                {
+                    --lower;
+                }
+                size_t upper = split;
+                while (upper < b.end
+                       && cells[upper].c[b.axis] == cells[upper - 1].c[b.axis])
+                {
+                    ++upper;
+                }
+                split = (lower > b.begin
+                         && (upper == b.end || split - lower <= upper - split))
+                    ? lower : upper;
+
+                box rest;
+                rest.begin = split;
+                rest.end = b.end;
+                b.end = split;
+                measure_box(cells, b);
+                measure_box(cells, rest);
+                boxes.push_back(rest);
+            }
+
+            colors.clear();
+            for (size_t i = 0; i < boxes.size(); ++i)
+            {
+                double sum[4] = { 0, 0, 0, 0 };
+                double population = 0;
+                for (size_t j = boxes[i].begin; j < boxes[i].end; ++j)
+                {
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        sum[k] += double(cells[j].c[k]) * cells[j].count;
+                    }
+                    population += cells[j].count;
+                }
+                byte c[4];
+                for (int k = 0; k < 4; ++k)
+                {
+                    c[k] = byte(sum[k] / population + 0.5);
+                }
+                colors.push_back(rgba_pixel(c[0], c[1], c[2], c[3]));
+            }
+        }
+
+        static int find_nearest(std::vector< rgba_pixel > const& colors,
+                                int r, int g, int b, int a)
+        {
+            int best = 0;
+            long best_dist = -1;
+            for (size_t i = 0; i < colors.size(); ++i)
+            {
+                long dr = colors[i].red - r;
+                long dg = colors[i].green - g;
+                long db = colors[i].blue - b;
+                long da = colors[i].alpha - a;
+                long dist = dr * dr + dg * dg + db * db + da * da;
+                if (best_dist < 0 || dist < best_dist)
+                {
+                    best = (int) i;
+                    best_dist = dist;
+                }
+            }
+            return best;
+        }
+
+        static int clamp(int value)
+        {
+            return value < 0 ? 0 : (value > 255 ? 255 : value);
+        }
+
+        template< class src_pixbuf, class dst_pixbuf >
+        void map_nearest_colors(image< rgba_pixel, src_pixbuf > const& src,
+                                image< index_pixel, dst_pixbuf >& dst,
+                                std::vector< rgba_pixel > const& colors) const
+        {
+            std::vector< short > cache(cell_count, -1);
+            size_t width = src.get_width();
+
+            // Floyd-Steinberg error rows, with a guard pixel at each end
+            std::vector< int > errors;
+            std::vector< int > next_errors;
+            if (m_dither)
+            {
+                errors.assign((width + 2) * 4, 0);
+                next_errors.assign((width + 2) * 4, 0);
+            }
+
+            for (size_t y = 0; y < src.get_height(); ++y)
+            {
+                for (size_t x = 0; x < width; ++x)
+                {
+                    rgba_pixel const& p = src[y][x];
+                    int c[4] = { p.red, p.green, p.blue, p.alpha };
+                    if (m_dither)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            c[k] = clamp(c[k] + errors[(x + 1) * 4 + k] / 16);
+                        }
+                    }
+
+                    uint_32 key = get_cell(c[0], c[1], c[2], c[3]);
+                    if (cache[key] < 0)
+                    {
+                        cache[key] = short(find_nearest(colors, c[0], c[1],
+                                                        c[2], c[3]));
+                    }
+                    int index = cache[key];
+                    dst[y][x] = index_pixel(index);
+
+                    if (m_dither)
+                    {
+                        rgba_pixel const& q = colors[index];
+                        int e[4] = { c[0] - q.red, c[1] - q.green,
+                                     c[2] - q.blue, c[3] - q.alpha };
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            errors[(x + 2) * 4 + k] += e[k] * 7;
+                            next_errors[x * 4 + k] += e[k] * 3;
+                            next_errors[(x + 1) * 4 + k] += e[k] * 5;
+                            next_errors[(x + 2) * 4 + k] += e[k];
+                        }
+                    }
+                }
+                if (m_dither)
+                {
+                    errors.swap(next_errors);
+                    std::fill(next_errors.begin(), next_errors.end(), 0);
+                }
+            }
+        }
+
+        /**
+         * \brief Stores \a colors as the palette and tRNS of \a dst,
+         * moving translucent colors to the front.
+         */
+        template< class dst_pixbuf >
+        static void set_palette(image< index_pixel, dst_pixbuf >& dst,
+                                std::vector< rgba_pixel > const& colors)
+        {
+            std::vector< byte > order(colors.size());
+            palette plte;
+            tRNS trns;
+            for (int opaque = 0; opaque < 2; ++opaque)
+            {
+                for (size_t i = 0; i < colors.size(); ++i)
+                {
+                    if ((colors[i].alpha == 255) == (opaque != 0))
+                    {
+                        order[i] = byte(plte.size());
+                        plte.push_back(color(colors[i].red,
+                                             colors[i].green,
+                                             colors[i].blue));
+                        if (!opaque)
+                        {
+                            trns.push_back(colors[i].alpha);
+                        }
+                    }
+                }
+            }
+
+            bool reordered = false;
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                reordered = reordered || order[i] != i;
+            }
+            if (reordered)
+            {
+                for (size_t y = 0; y < dst.get_height(); ++y)
+                {
+                    for (size_t x = 0; x < dst.get_width(); ++x)
+                    {
+                        dst[y][x] = index_pixel(order[dst[y][x]]);
+                    }
+                }
+            }
+            dst.set_palette(plte);
+            dst.set_tRNS(trns);
+        }
+
+        size_t m_max_colors;
+        bool m_dither;
+    };
+
+    /**
+     * \brief Converts an RGBA %image to an indexed one with at most
+     * \a max_colors colors.
+     *
+     * \see quantizer
+     */
+    template< class pixbuf >
+    image< index_pixel >
+    quantize(image< rgba_pixel, pixbuf > const& src,
+             size_t max_colors = 256, bool dither = false)
+    {
+        image< index_pixel > result;
+        quantizer(max_colors, dither).quantize(src, result);
+        return result;
+    }
+
+} // namespace png
+
+#endif // PNGPP_QUANTIZE_HPP_INCLUDED
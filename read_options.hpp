@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_READ_OPTIONS_HPP_INCLUDED
+#define PNGPP_READ_OPTIONS_HPP_INCLUDED
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "types.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief Settings for reading PNG images.
+     *
+     * \see reader::set_options(), consumer::read(), image::read()
+     */
+    class read_options
+    {
+    public:
+        typedef std::vector< std::string > chunk_list;
+
+        read_options()
+            : m_trust_checksums(false),
+              m_trust_chunk_crcs(false),
+              m_skip_ancillary_chunks(false)
+        {
+        }
+
+        /**
+         * \brief Returns whether chunk CRCs and the zlib Adler-32
+         * checksum are left unverified.
+         */
+        bool get_trust_checksums() const
+        {
+            return m_trust_checksums;
+        }
+
+        /**
+         * \brief Skips verification of chunk CRCs and of the zlib
+         * Adler-32 checksum.
+         *
+         * Only use this for input known to be intact, e.g. files
+         * which were produced and checksummed by the application
+         * itself: corrupt data is then decoded without an error.
+         * The Adler-32 check is skipped only with libpng 1.6.26 or
+         * later.
+         */
+        void set_trust_checksums(bool trust)
+        {
+            m_trust_checksums = trust;
+        }
+
+        /**
+         * \brief Returns whether chunk CRCs are left unverified.
+         */
+        bool get_trust_chunk_crcs() const
+        {
+            return m_trust_chunk_crcs;
+        }
+
+        /**
+         * \brief Skips verification of chunk CRCs only; the zlib
+         * Adler-32 checksum is still verified unless
+         * set_trust_checksums() was called as well.
+         */
+        void set_trust_chunk_crcs(bool trust)
+        {
+            m_trust_chunk_crcs = trust;
+        }
+
+        /**
+         * \brief Returns whether ancillary chunks other than the kept
+         * ones are discarded without being parsed.
+         */
+        bool get_skip_ancillary_chunks() const
+        {
+            return m_skip_ancillary_chunks;
+        }
+
+        /**
+         * \brief Discards ancillary chunks (text, time, ICC profiles,
+         * etc.) without parsing or inflating them.
+         *
+         * The tRNS and gAMA chunks, which png++ uses, are always
+         * kept, as are the chunks listed with keep_chunk().
+         * Requires libpng built with PNG_HANDLE_AS_UNKNOWN_SUPPORTED;
+         * otherwise the setting is ignored.
+         */
+        void set_skip_ancillary_chunks(bool skip)
+        {
+            m_skip_ancillary_chunks = skip;
+        }
+
+        /**
+         * \brief Keeps the ancillary chunk named \a name (e.g.
+         * "pHYs") when skipping ancillary chunks.
+         */
+        void keep_chunk(std::string const& name)
+        {
+            if (name.size() != 4)
+            {
+                throw std::invalid_argument("invalid chunk name: " + name);
+            }
+            m_kept_chunks.push_back(name);
+        }
+
+        chunk_list const& get_kept_chunks() const
+        {
+            return m_kept_chunks;
+        }
+
+    protected:
+        bool m_trust_checksums;
+        bool m_trust_chunk_crcs;
+        bool m_skip_ancillary_chunks;
+        chunk_list m_kept_chunks;
+    };
+
+} // namespace png
+
+#endif // PNGPP_READ_OPTIONS_HPP_INCLUDED
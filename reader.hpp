@@ -32,7 +32,10 @@
 #define PNGPP_READER_HPP_INCLUDED
 
 #include <cassert>
+#include <string>
 #include "io_base.hpp"
+#include "read_options.hpp"
+#include "expand_palette.hpp"
 
 namespace png
 {
@@ -74,13 +77,15 @@ namespace png
             : io_base(png_create_read_struct(PNG_LIBPNG_VER_STRING,
                                              static_cast< io_base* >(this),
                                              raise_error,
-                                             0))
+                                             0)),
+              m_palette_lut(0)
         {
             png_set_read_fn(m_png, & stream, read_data);
         }
 
         ~reader()
         {
+            delete m_palette_lut;
             png_destroy_read_struct(& m_png,
                                     m_info.get_png_info_ptr(),
                                     m_end_info.get_png_info_ptr());
@@ -92,9 +97,12 @@ namespace png
          */
         void read_png()
         {
-            if (setjmp(png_jmpbuf(m_png)))
+            if (!m_error_status)
             {
-                throw error(m_error);
+                if (setjmp(png_jmpbuf(m_png)))
+                {
+                    throw error(m_error);
+                }
             }
             png_read_png(m_png,
                          m_info.get_png_info(),
@@ -107,11 +115,20 @@ namespace png
          */
         void read_info()
         {
-            if (setjmp(png_jmpbuf(m_png)))
+            if (!m_error_status)
             {
-                throw error(m_error);
+                if (setjmp(png_jmpbuf(m_png)))
+                {
+                    throw error(m_error);
+                }
             }
+#ifdef PNGPP_TRACE
+            double begin = detail::trace_begin(*this);
+#endif
             m_info.read();
+#ifdef PNGPP_TRACE
+            detail::trace_end(*this, "read_info", begin);
+#endif
         }
 
         /**
@@ -119,11 +136,20 @@ namespace png
          */
         void read_row(byte* bytes)
         {
-            if (setjmp(png_jmpbuf(m_png)))
+            if (!m_error_status)
             {
-                throw error(m_error);
+                if (setjmp(png_jmpbuf(m_png)))
+                {
+                    throw error(m_error);
+                }
             }
+#ifdef PNGPP_IO_STATS
+            detail::stats_mark mark = detail::stats_begin(get_io_stats());
+#endif
             png_read_row(m_png, bytes, 0);
+#ifdef PNGPP_IO_STATS
+            detail::stats_end(get_io_stats(), mark, detail::stats_libpng);
+#endif
         }
 
         /**
@@ -131,18 +157,118 @@ namespace png
          */
         void read_end_info()
         {
-            if (setjmp(png_jmpbuf(m_png)))
+            if (!m_error_status)
             {
-                throw error(m_error);
+                if (setjmp(png_jmpbuf(m_png)))
+                {
+                    throw error(m_error);
+                }
             }
+#ifdef PNGPP_TRACE
+            double begin = detail::trace_begin(*this);
+#endif
             m_end_info.read();
+#ifdef PNGPP_TRACE
+            detail::trace_end(*this, "read_end_info", begin);
+#endif
         }
 
         void update_info()
         {
+            if (!m_error_status)
+            {
+                if (setjmp(png_jmpbuf(m_png)))
+                {
+                    throw error(m_error);
+                }
+            }
             m_info.update();
         }
 
+        /**
+         * \brief Sets what to do on chunk CRC errors in critical and
+         * ancillary chunks.
+         */
+        void set_crc_action(crc_action critical, crc_action ancillary) const
+        {
+            png_set_crc_action(m_png, critical, ancillary);
+        }
+
+        /**
+         * \brief Skips verification of the zlib Adler-32 checksum of
+         * the image data, if supported by libpng.
+         */
+        void set_ignore_adler32() const
+        {
+#if defined(PNG_SET_OPTION_SUPPORTED) && defined(PNG_IGNORE_ADLER32)
+            png_set_option(m_png, PNG_IGNORE_ADLER32, PNG_OPTION_ON);
+#endif
+        }
+
+        /**
+         * \brief Discards all ancillary chunks except tRNS, gAMA and
+         * those listed in \a kept, without parsing them.
+         */
+        void set_skip_ancillary_chunks(read_options::chunk_list const& kept
+                                       = read_options::chunk_list()) const
+        {
+#ifdef PNG_HANDLE_AS_UNKNOWN_SUPPORTED
+            static png_byte const used[] = "tRNS\0gAMA";
+            png_set_keep_unknown_chunks(m_png, PNG_HANDLE_CHUNK_NEVER, 0, -1);
+            png_set_keep_unknown_chunks(m_png, PNG_HANDLE_CHUNK_AS_DEFAULT,
+                                        used, 2);
+
+            std::string names;
+            for (size_t i = 0; i < kept.size(); ++i)
+            {
+                names.append(kept[i], 0, 4);
+                names.push_back('\0');
+            }
+            if (!kept.empty())
+            {
+                png_set_keep_unknown_chunks(m_png, PNG_HANDLE_CHUNK_AS_DEFAULT,
+                                            reinterpret_cast< png_byte const* >
+                                            (names.data()),
+                                            int(kept.size()));
+            }
+#endif
+        }
+
+        /**
+         * \brief Applies the settings of \a options.  Must be called
+         * before read_info().
+         */
+        void set_options(read_options const& options) const
+        {
+            if (options.get_trust_checksums())
+            {
+                set_crc_action(crc_quiet_use, crc_quiet_use);
+                set_ignore_adler32();
+            }
+            else if (options.get_trust_chunk_crcs())
+            {
+                set_crc_action(crc_quiet_use, crc_quiet_use);
+            }
+            if (options.get_skip_ancillary_chunks())
+            {
+                set_skip_ancillary_chunks(options.get_kept_chunks());
+            }
+        }
+
+        /**
+         * \brief Returns a palette lookup table owned by the reader,
+         * for transformations expanding indexed rows while reading.
+         * The table is allocated on first use.
+         */
+        palette_lut& get_palette_lut()
+        {
+            if (!m_palette_lut)
+            {
+                m_palette_lut = new palette_lut;
+            }
+            return *m_palette_lut;
+        }
+
     private:
         static void read_data(png_struct* png, byte* data, png_size_t length)
         {
@@ -150,28 +276,38 @@ namespace png
             reader* rd = static_cast< reader* >(io);
             rd->reset_error();
             istream* stream = reinterpret_cast< istream* >(png_get_io_ptr(png));
+#ifdef PNGPP_IO_STATS
+            detail::stats_mark mark = detail::stats_begin(rd->get_io_stats());
+#endif
             try
             {
                 stream->read(reinterpret_cast< char* >(data), length);
                 if (!stream->good())
                 {
-                    rd->set_error("istream::read() failed");
+                    rd->set_error("istream::read() failed", error_stream);
                 }
             }
             catch (std::exception const& error)
             {
-                rd->set_error(error.what());
+                rd->set_error(error.what(), error_stream);
             }
             catch (...)
             {
                 assert(!"read_data: caught something wrong");
-                rd->set_error("read_data: caught something wrong");
+                rd->set_error("read_data: caught something wrong",
+                              error_stream);
             }
+#ifdef PNGPP_IO_STATS
+            detail::stats_end(rd->get_io_stats(), mark, detail::stats_io,
+                              length);
+#endif
             if (rd->is_error())
             {
                 rd->raise_error();
             }
         }
+
+        palette_lut* m_palette_lut;
     };
 
 } // namespace png
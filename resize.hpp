@@ -0,0 +1,550 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_RESIZE_HPP_INCLUDED
+#define PNGPP_RESIZE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "config.hpp"
+#include "pixel_traits.hpp"
+#include "image.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <thread>
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief Filters for resize().
+     */
+    enum resample_filter
+    {
+        resample_box,       ///< area average when shrinking
+        resample_bilinear,  ///< triangle filter
+        resample_bicubic,   ///< Catmull-Rom spline
+        resample_lanczos3   ///< windowed sinc, 3 lobes
+    };
+
+    /**
+     * \brief Options for resize().
+     */
+    class resize_options
+    {
+    public:
+        resize_options()
+            : m_linear_light(false),
+              m_premultiply_alpha(true),
+              m_thread_count(0)
+        {
+        }
+
+        /**
+         * \brief Returns whether the color channels are filtered in
+         * linear light, that is decoded from sRGB first and encoded
+         * back afterwards.  Off by default.
+         */
+        bool get_linear_light() const
+        {
+            return m_linear_light;
+        }
+
+        void set_linear_light(bool linear_light)
+        {
+            m_linear_light = linear_light;
+        }
+
+        /**
+         * \brief Returns whether the color channels are weighted by
+         * alpha while filtering, so that the color of transparent
+         * pixels does not bleed into their neighbours.  On by
+         * default; has no effect on pixels without alpha.
+         */
+        bool get_premultiply_alpha() const
+        {
+            return m_premultiply_alpha;
+        }
+
+        void set_premultiply_alpha(bool premultiply)
+        {
+            m_premultiply_alpha = premultiply;
+        }
+
+        /**
+         * \brief Returns the number of threads to use; 0 stands for
+         * the number of processors.  Only used when std::thread is
+         * available.
+         */
+        size_t get_thread_count() const
+        {
+            return m_thread_count;
+        }
+
+        void set_thread_count(size_t count)
+        {
+            m_thread_count = count;
+        }
+
+    protected:
+        bool m_linear_light;
+        bool m_premultiply_alpha;
+        size_t m_thread_count;
+    };
+
+    namespace detail
+    {
+
+        /**
+         * \brief The filter taps of one axis: for every destination
+         * position the first source position and the weights of
+         * tap_count consecutive source positions (zero padded).
+         */
+        class resample_axis
+        {
+        public:
+            resample_axis(size_t src_size, size_t dst_size,
+                          resample_filter filter)
+            {
+                double scale = double(src_size) / dst_size;
+                // widen the filter when shrinking, to average all
+                // source pixels
+                double stretch = std::max(scale, 1.0);
+                double support = get_support(filter) * stretch;
+                tap_count = size_t(std::ceil(support)) * 2 + 1;
+                if (tap_count > src_size)
+                {
+                    tap_count = src_size;
+                }
+
+                starts.resize(dst_size);
+                weights.assign(dst_size * tap_count, 0.0f);
+                for (size_t i = 0; i < dst_size; ++i)
+                {
+                    double center = (i + 0.5) * scale;
+                    double left = std::floor(center - support + 0.5);
+                    size_t first = left > 0 ? size_t(left) : 0;
+                    first = std::min(first, src_size - tap_count);
+                    starts[i] = first;
+
+                    float* w = & weights[i * tap_count];
+                    double total = 0;
+                    for (size_t k = 0; k < tap_count; ++k)
+                    {
+                        double x = (first + k + 0.5 - center) / stretch;
+                        w[k] = float(apply(filter, x));
+                        total += w[k];
+                    }
+                    if (total == 0)
+                    {
+                        // the nearest pixel, for degenerate cases
+                        size_t nearest = std::min(size_t(center), src_size - 1);
+                        w[nearest - first] = 1;
+                        total = 1;
+                    }
+                    for (size_t k = 0; k < tap_count; ++k)
+                    {
+                        w[k] = float(w[k] / total);
+                    }
+                }
+            }
+
+            size_t tap_count;
+            std::vector< size_t > starts;
+            std::vector< float > weights;
+
+        private:
+            static double get_support(resample_filter filter)
+            {
+                switch (filter)
+                {
+                case resample_box: return 0.5;
+                case resample_bilinear: return 1;
+                case resample_bicubic: return 2;
+                case resample_lanczos3: return 3;
+                }
+                return 1;
+            }
+
+            static double sinc(double x)
+            {
+                if (x == 0)
+                {
+                    return 1;
+                }
+                x *= 3.14159265358979323846;
+                return std::sin(x) / x;
+            }
+
+            static double apply(resample_filter filter, double x)
+            {
+                x = std::fabs(x);
+                switch (filter)
+                {
+                case resample_box:
+                    return x < 0.5 ? 1 : x == 0.5 ? 0.5 : 0;
+                case resample_bilinear:
+                    return x < 1 ? 1 - x : 0;
+                case resample_bicubic:
+                    if (x < 1)
+                    {
+                        return (1.5 * x - 2.5) * x * x + 1;
+                    }
+                    if (x < 2)
+                    {
+                        return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+                    }
+                    return 0;
+                case resample_lanczos3:
+                    return x < 3 ? sinc(x) * sinc(x / 3) : 0;
+                }
+                return 0;
+            }
+        };
+
+        /**
+         * \brief Separable resampling of one pixel type.
+         *
+         * Source rows are converted to floating point, premultiplied
+         * and linearized as requested, and filtered horizontally
+         * into an intermediate buffer of destination width and
+         * source height.  Destination rows are then filtered
+         * vertically out of that buffer and converted back.  The
+         * inner loops run over contiguous floats so that compilers
+         * can vectorize them.
+         */
+        template< typename pixel >
+        class resampler
+        {
+        public:
+            typedef pixel_traits< pixel > traits;
+            typedef typename traits::component_type component;
+
+            enum { channels = traits::channels };
+
+            resampler(size_t src_width, size_t src_height,
+                      size_t dst_width, size_t dst_height,
+                      resample_filter filter, resize_options const& options)
+                : m_horizontal(src_width, dst_width, filter),
+                  m_vertical(src_height, dst_height, filter),
+                  m_src_width(src_width),
+                  m_dst_width(dst_width),
+                  m_linear(options.get_linear_light()),
+                  m_premultiply(options.get_premultiply_alpha()
+                                && has_alpha()),
+                  m_buffer(dst_width * channels * src_height)
+            {
+                if (m_linear)
+                {
+                    size_t const values = size_t(get_max()) + 1;
+                    m_to_linear.resize(values);
+                    for (size_t i = 0; i < values; ++i)
+                    {
+                        m_to_linear[i] = float(to_linear(double(i) / get_max()));
+                    }
+                }
+            }
+
+            /**
+             * \brief Filters source row \a y horizontally.
+             */
+            void filter_row(pixel const* src, size_t y)
+            {
+                std::vector< float > row(m_src_width * channels);
+                load(reinterpret_cast< component const* >(src), & row[0]);
+
+                float* out = & m_buffer[y * m_dst_width * channels];
+                size_t taps = m_horizontal.tap_count;
+                for (size_t x = 0; x < m_dst_width; ++x)
+                {
+                    float const* in = & row[m_horizontal.starts[x] * channels];
+                    float const* w = & m_horizontal.weights[x * taps];
+                    float sum[channels] = { 0 };
+                    for (size_t k = 0; k < taps; ++k)
+                    {
+                        for (int c = 0; c < channels; ++c)
+                        {
+                            sum[c] += w[k] * in[k * channels + c];
+                        }
+                    }
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        *out++ = sum[c];
+                    }
+                }
+            }
+
+            /**
+             * \brief Filters destination row \a y vertically out of
+             * the intermediate buffer.
+             */
+            void make_row(pixel* dst, size_t y) const
+            {
+                size_t size = m_dst_width * channels;
+                std::vector< float > row(size, 0.0f);
+                size_t taps = m_vertical.tap_count;
+                float const* w = & m_vertical.weights[y * taps];
+                for (size_t k = 0; k < taps; ++k)
+                {
+                    float const* in
+                        = & m_buffer[(m_vertical.starts[y] + k) * size];
+                    float weight = w[k];
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        row[i] += weight * in[i];
+                    }
+                }
+                store(& row[0], reinterpret_cast< component* >(dst));
+            }
+
+        private:
+            static bool has_alpha()
+            {
+                return (traits::get_color_type() & color_mask_alpha) != 0;
+            }
+
+            static double get_max()
+            {
+                return std::numeric_limits< component >::max();
+            }
+
+            static double to_linear(double v)
+            {
+                return v <= 0.04045 ? v / 12.92
+                    : std::pow((v + 0.055) / 1.055, 2.4);
+            }
+
+            static double from_linear(double v)
+            {
+                return v <= 0.0031308 ? v * 12.92
+                    : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+            }
+
+            /**
+             * \brief Converts a source row to floats in [0, 1], linear
+             * and premultiplied as requested.
+             */
+            void load(component const* src, float* out) const
+            {
+                float const scale = float(1 / get_max());
+                for (size_t x = 0; x < m_src_width; ++x)
+                {
+                    float a = has_alpha() ? src[channels - 1] * scale : 1;
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        float v;
+                        if (has_alpha() && c == channels - 1)
+                        {
+                            v = a;
+                        }
+                        else
+                        {
+                            v = m_linear ? m_to_linear[src[c]] : src[c] * scale;
+                            if (m_premultiply)
+                            {
+                                v *= a;
+                            }
+                        }
+                        *out++ = v;
+                    }
+                    src += channels;
+                }
+            }
+
+            void store(float const* row, component* dst) const
+            {
+                for (size_t x = 0; x < m_dst_width; ++x)
+                {
+                    float a = has_alpha() ? clamp(row[channels - 1]) : 1;
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        double v = row[c];
+                        if (!has_alpha() || c != channels - 1)
+                        {
+                            if (m_premultiply)
+                            {
+                                v = a > 0 ? v / a : 0;
+                            }
+                            v = clamp(float(v));
+                            if (m_linear)
+                            {
+                                v = from_linear(v);
+                            }
+                        }
+                        else
+                        {
+                            v = a;
+                        }
+                        dst[c] = component(v * get_max() + 0.5);
+                    }
+                    row += channels;
+                    dst += channels;
+                }
+            }
+
+            static float clamp(float v)
+            {
+                return v < 0 ? 0 : v > 1 ? 1 : v;
+            }
+
+            resample_axis m_horizontal;
+            resample_axis m_vertical;
+            size_t m_src_width;
+            size_t m_dst_width;
+            bool m_linear;
+            bool m_premultiply;
+            std::vector< float > m_buffer;
+            std::vector< float > m_to_linear;
+        };
+
+        /**
+         * \brief Runs one resampling stage over a range of rows.
+         */
+        template< typename pixel, class src_pixbuf, class dst_pixbuf >
+        struct resize_job
+        {
+            resize_job(resampler< pixel >& rs,
+                       image< pixel, src_pixbuf > const& src,
+                       image< pixel, dst_pixbuf >& dst,
+                       bool vertical, size_t begin, size_t end)
+                : m_resampler(& rs),
+                  m_src(& src),
+                  m_dst(& dst),
+                  m_vertical(vertical),
+                  m_begin(begin),
+                  m_end(end)
+            {
+            }
+
+            void operator()() const
+            {
+                for (size_t y = m_begin; y < m_end; ++y)
+                {
+                    if (m_vertical)
+                    {
+                        m_resampler->make_row(& (*m_dst)[y][0], y);
+                    }
+                    else
+                    {
+                        m_resampler->filter_row(& (*m_src)[y][0], y);
+                    }
+                }
+            }
+
+            resampler< pixel >* m_resampler;
+            image< pixel, src_pixbuf > const* m_src;
+            image< pixel, dst_pixbuf >* m_dst;
+            bool m_vertical;
+            size_t m_begin;
+            size_t m_end;
+        };
+
+        template< typename pixel, class src_pixbuf, class dst_pixbuf >
+        void run_resize_jobs(resampler< pixel >& rs,
+                             image< pixel, src_pixbuf > const& src,
+                             image< pixel, dst_pixbuf >& dst,
+                             bool vertical, size_t rows, size_t jobs)
+        {
+            typedef resize_job< pixel, src_pixbuf, dst_pixbuf > job;
+#ifdef PNGPP_HAS_STD_THREAD
+            std::vector< std::thread > threads;
+            for (size_t i = 1; i < jobs; ++i)
+            {
+                threads.push_back(std::thread(job(rs, src, dst, vertical,
+                                                  rows * i / jobs,
+                                                  rows * (i + 1) / jobs)));
+            }
+#endif
+            job(rs, src, dst, vertical, 0, rows / jobs)();
+#ifdef PNGPP_HAS_STD_THREAD
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+#endif
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief Resamples \a src to the size of \a dst with a separable
+     * \a filter.
+     *
+     * Works with any pixel type of 8 or 16 bits per channel, with
+     * pixel_buffer and solid_pixel_buffer alike.  With std::thread
+     * available, the rows of large images are split among several
+     * threads.
+     *
+     * \see resize_options
+     */
+    template< typename pixel, class src_pixbuf, class dst_pixbuf >
+    void resize(image< pixel, src_pixbuf > const& src,
+                image< pixel, dst_pixbuf >& dst,
+                resample_filter filter = resample_lanczos3,
+                resize_options const& options = resize_options())
+    {
+        size_t src_width = src.get_width();
+        size_t src_height = src.get_height();
+        size_t dst_width = dst.get_width();
+        size_t dst_height = dst.get_height();
+        if (src_width == 0 || src_height == 0
+            || dst_width == 0 || dst_height == 0)
+        {
+            return;
+        }
+
+        detail::resampler< pixel > rs(src_width, src_height,
+                                      dst_width, dst_height,
+                                      filter, options);
+        size_t jobs = 1;
+#ifdef PNGPP_HAS_STD_THREAD
+        // not worth spawning threads for small images
+        if (dst_width * src_height >= (1 << 16))
+        {
+            jobs = options.get_thread_count();
+            if (jobs == 0)
+            {
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+            }
+            jobs = std::min(jobs, std::min(src_height, dst_height));
+        }
+#endif
+        detail::run_resize_jobs(rs, src, dst, false, src_height, jobs);
+        detail::run_resize_jobs(rs, src, dst, true, dst_height, jobs);
+    }
+
+} // namespace png
+
+#endif // PNGPP_RESIZE_HPP_INCLUDED
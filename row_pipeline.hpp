@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_ROW_PIPELINE_HPP_INCLUDED
+#define PNGPP_ROW_PIPELINE_HPP_INCLUDED
+
+#include <stdexcept>
+#include <vector>
+
+#include "types.hpp"
+#include "image_info.hpp"
+#include "consumer.hpp"
+#include "generator.hpp"
+#include "convert_color_space.hpp"
+#include "image.hpp"
+#include "adam7.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief A row of pixels passed between row pipeline stages.
+     *
+     * The \c data points to \c width pixels; \c pos is the position
+     * of the row in the %image, as seen by the next stage.
+     */
+    template< typename pixel >
+    struct row_view
+    {
+        row_view()
+            : data(0),
+              width(0),
+              pos(0)
+        {
+        }
+
+        row_view(pixel* row_data, uint_32 row_width, uint_32 row_pos)
+            : data(row_data),
+              width(row_width),
+              pos(row_pos)
+        {
+        }
+
+        pixel* data;
+        uint_32 width;
+        uint_32 pos;
+    };
+
+    /**
+     * \brief The base class template of row pipeline stages.
+     *
+     * A stage is a class deriving from row_stage<stage> which
+     * defines the following members:
+     *
+     * \code
+     * typedef ... input_pixel;
+     * typedef ... output_pixel;
+     * void start(png::uint_32& width, png::uint_32& height);
+     * bool process(png::row_view< input_pixel >& in,
+     *              png::row_view< output_pixel >& out);
+     * \endcode
+     *
+     * The \c start() method is called once before any row is
+     * processed, with the geometry of the input; it should update the
+     * geometry to that of the output.  The \c process() method is
+     * called for every row in order; it should set up \a out to
+     * describe the resulting row and return \c true, or return \c
+     * false to drop the row.  The \a out row may point into \a in
+     * (which the stage is free to modify in place) or into a buffer
+     * owned by the stage.
+     *
+     * Stages are combined into a row_pipeline with \c operator|:
+     *
+     * \code
+     * png::crop_stage< png::rgb_pixel >(0, 0, 640, 480)
+     *     | png::convert_stage< png::rgb_pixel, png::rgba_pixel >()
+     *     | png::flip_vertical_stage< png::rgba_pixel >()
+     * \endcode
+     *
+     * The composition is resolved at compile time, so the compiler
+     * may inline the whole chain into the row loop.
+     *
+     * \see pipeline_consumer, pipeline_generator
+     */
+    template< class stage >
+    class row_stage
+    {
+    public:
+        stage& get_stage()
+        {
+            return static_cast< stage& >(*this);
+        }
+
+        stage const& get_stage() const
+        {
+            return static_cast< stage const& >(*this);
+        }
+    };
+
+    /**
+     * \brief Two stages run one after another; a stage itself.
+     */
+    template< class first, class second >
+    class row_pipeline
+        : public row_stage< row_pipeline< first, second > >
+    {
+    public:
+        typedef typename first::input_pixel input_pixel;
+        typedef typename second::output_pixel output_pixel;
+
+        row_pipeline(first const& a, second const& b)
+            : m_first(a),
+              m_second(b)
+        {
+        }
+
+        void start(uint_32& width, uint_32& height)
+        {
+            m_first.start(width, height);
+            m_second.start(width, height);
+        }
+
+        bool process(row_view< input_pixel >& in,
+                     row_view< output_pixel >& out)
+        {
+            row_view< typename first::output_pixel > mid;
+            return m_first.process(in, mid) && m_second.process(mid, out);
+        }
+
+        first& get_first()
+        {
+            return m_first;
+        }
+
+        second& get_second()
+        {
+            return m_second;
+        }
+
+    private:
+        first m_first;
+        second m_second;
+    };
+
+    template< class first, class second >
+    row_pipeline< first, second >
+    operator|(row_stage< first > const& a, row_stage< second > const& b)
+    {
+        return row_pipeline< first, second >(a.get_stage(), b.get_stage());
+    }
+
+    /**
+     * \brief Reads an %image through a row pipeline into an %image of
+     * the pipeline's output pixel type.
+     *
+     * The PNG is converted to the pipeline's input pixel type with
+     * convert_color_space, then each row is passed through the
+     * pipeline as soon as it is decoded and stored at the position
+     * the pipeline gives it.  Interlaced images are decoded into a
+     * full frame of input pixels first, and passed through the
+     * pipeline during the last pass.
+     */
+    template< class pipeline,
+              typename pixel_buffer_type
+                  = pixel_buffer< typename pipeline::output_pixel > >
+    class pipeline_consumer
+        : public consumer< typename pipeline::input_pixel,
+                           pipeline_consumer< pipeline, pixel_buffer_type >,
+                           image_info_ref_holder, true >
+    {
+    public:
+        typedef typename pipeline::input_pixel input_pixel;
+        typedef typename pipeline::output_pixel output_pixel;
+        typedef image< output_pixel, pixel_buffer_type > image_type;
+        typedef consumer< input_pixel, pipeline_consumer,
+                          image_info_ref_holder, true > base;
+
+        pipeline_consumer(pipeline& stages, image_type& dst)
+            : base(m_info),
+              m_pipeline(& stages),
+              m_image(& dst),
+              m_row_width(0),
+              m_pending(false),
+              m_last_pass(false)
+        {
+        }
+
+        /**
+         * \brief Reads an %image from the stream, converting it to
+         * the input pixel type of the pipeline.
+         */
+        template< typename istream >
+        void read(istream& stream)
+        {
+            base::read(stream, convert_color_space< input_pixel >());
+        }
+
+        /**
+         * \brief Reads an %image from the stream using custom io
+         * transformation.
+         */
+        template< typename istream, class transformation >
+        void read(istream& stream, transformation const& transform)
+        {
+            base::read(stream, transform);
+        }
+
+        /**
+         * \brief Reads an %image from the stream with custom read
+         * options, converting it to the input pixel type of the
+         * pipeline.
+         */
+        template< typename istream >
+        void read(istream& stream, read_options const& options)
+        {
+            base::read(stream, convert_color_space< input_pixel >(), options);
+        }
+
+        /**
+         * \brief Reads an %image from the stream using custom io
+         * transformation and read options.
+         */
+        template< typename istream, class transformation >
+        void read(istream& stream, transformation const& transform,
+                  read_options const& options)
+        {
+            base::read(stream, transform, options);
+        }
+
+        void reset(size_t pass)
+        {
+            m_pending = false;
+            m_last_pass = m_info.get_interlace_type() == interlace_none
+                || pass + 1 == adam7::pass_count;
+            if (pass != 0)
+            {
+                return;
+            }
+            uint_32 width = m_info.get_width();
+            uint_32 height = m_info.get_height();
+            m_row_width = width;
+            m_rows.resize(m_info.get_interlace_type() == interlace_none
+                          ? width : size_t(width) * height);
+            m_pipeline->start(width, height);
+            m_image->resize(width, height);
+        }
+
+        byte* get_next_row(size_t pos)
+        {
+            flush();
+            m_pos = pos;
+            m_pending = m_last_pass;
+            return reinterpret_cast< byte* >(get_row_data(pos));
+        }
+
+        void end_pass(size_t /*pass*/)
+        {
+            flush();
+        }
+
+    private:
+        /**
+         * \brief Passes the row read last through the pipeline.
+         */
+        void flush()
+        {
+            if (!m_pending)
+            {
+                return;
+            }
+            m_pending = false;
+
+            row_view< input_pixel > in(get_row_data(m_pos), m_row_width,
+                                       m_pos);
+            row_view< output_pixel > out;
+            if (!m_pipeline->process(in, out))
+            {
+                return;
+            }
+            if (out.pos >= m_image->get_height()
+                || out.width != m_image->get_width())
+            {
+                throw std::logic_error("row_pipeline produced a row"
+                                       " outside of the image");
+            }
+            typename image_type::row_access row = (*m_image)[out.pos];
+            for (size_t x = 0; x < out.width; ++x)
+            {
+                row[x] = out.data[x];
+            }
+        }
+
+        input_pixel* get_row_data(size_t pos)
+        {
+            return m_rows.size() == m_row_width
+                ? & m_rows[0]
+                : & m_rows[pos * m_row_width];
+        }
+
+        image_info m_info;
+        pipeline* m_pipeline;
+        image_type* m_image;
+        std::vector< input_pixel > m_rows;
+        size_t m_row_width;
+        size_t m_pos;
+        bool m_pending;
+        bool m_last_pass;
+    };
+
+    /**
+     * \brief Writes an %image through a row pipeline.
+     *
+     * Each row of the source %image is copied and passed through the
+     * pipeline right before it is compressed.  The pipeline must
+     * produce the output rows in order, so stages reordering rows
+     * (such as flip_vertical_stage) cannot be used; a
+     * std::logic_error is thrown if they are.
+     */
+    template< class pipeline,
+              typename pixel_buffer_type
+                  = pixel_buffer< typename pipeline::input_pixel > >
+    class pipeline_generator
+        : public generator< typename pipeline::output_pixel,
+                            pipeline_generator< pipeline, pixel_buffer_type >,
+                            image_info_ref_holder >
+    {
+    public:
+        typedef typename pipeline::input_pixel input_pixel;
+        typedef typename pipeline::output_pixel output_pixel;
+        typedef image< input_pixel, pixel_buffer_type > image_type;
+        typedef generator< output_pixel, pipeline_generator,
+                           image_info_ref_holder > base;
+
+        pipeline_generator(pipeline& stages, image_type const& src)
+            : base(m_info),
+              m_pipeline(& stages),
+              m_image(& src),
+              m_row(src.get_width()),
+              m_next(0)
+        {
+            uint_32 width = src.get_width();
+            uint_32 height = src.get_height();
+            m_pipeline->start(width, height);
+            m_info = make_image_info< output_pixel >();
+            m_info.set_width(width);
+            m_info.set_height(height);
+        }
+
+        byte* get_next_row(size_t pos)
+        {
+            while (m_next < m_image->get_height())
+            {
+                typename image_type::row_const_access src
+                    = (*m_image)[m_next];
+                for (size_t x = 0; x < m_row.size(); ++x)
+                {
+                    m_row[x] = src[x];
+                }
+                row_view< input_pixel > in(& m_row[0], m_row.size(), m_next);
+                row_view< output_pixel > out;
+                ++m_next;
+                if (m_pipeline->process(in, out))
+                {
+                    if (out.pos != pos || out.width != m_info.get_width())
+                    {
+                        throw std::logic_error("row_pipeline produced rows"
+                                               " out of order");
+                    }
+                    return reinterpret_cast< byte* >(out.data);
+                }
+            }
+            throw std::logic_error("row_pipeline produced too few rows");
+        }
+
+    private:
+        image_info m_info;
+        pipeline* m_pipeline;
+        image_type const* m_image;
+        std::vector< input_pixel > m_row;
+        size_t m_next;
+    };
+
+} // namespace png
+
+#endif // PNGPP_ROW_PIPELINE_HPP_INCLUDED
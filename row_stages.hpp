@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_ROW_STAGES_HPP_INCLUDED
+#define PNGPP_ROW_STAGES_HPP_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+#include "types.hpp"
+#include "pixel_traits.hpp"
+#include "row_pipeline.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief Row pipeline stage cutting a rectangle out of the %image.
+     *
+     * The rectangle is clipped to the input %image.  Rows outside of
+     * it are dropped; the others are narrowed in place, without
+     * copying.
+     */
+    template< typename pixel >
+    class crop_stage
+        : public row_stage< crop_stage< pixel > >
+    {
+    public:
+        typedef pixel input_pixel;
+        typedef pixel output_pixel;
+
+        crop_stage(uint_32 x, uint_32 y, uint_32 width, uint_32 height)
+            : m_x(x),
+              m_y(y),
+              m_width(width),
+              m_height(height)
+        {
+        }
+
+        void start(uint_32& width, uint_32& height)
+        {
+            m_x = std::min(m_x, width);
+            m_y = std::min(m_y, height);
+            m_width = std::min(m_width, width - m_x);
+            m_height = std::min(m_height, height - m_y);
+            width = m_width;
+            height = m_height;
+        }
+
+        bool process(row_view< pixel >& in, row_view< pixel >& out)
+        {
+            if (in.pos < m_y || in.pos - m_y >= m_height)
+            {
+                return false;
+            }
+            out.data = in.data + m_x;
+            out.width = m_width;
+            out.pos = in.pos - m_y;
+            return true;
+        }
+
+    private:
+        uint_32 m_x;
+        uint_32 m_y;
+        uint_32 m_width;
+        uint_32 m_height;
+    };
+
+    /**
+     * \brief Row pipeline stage mirroring every row in place.
+     */
+    template< typename pixel >
+    class flip_horizontal_stage
+        : public row_stage< flip_horizontal_stage< pixel > >
+    {
+    public:
+        typedef pixel input_pixel;
+        typedef pixel output_pixel;
+
+        void start(uint_32& /*width*/, uint_32& /*height*/)
+        {
+        }
+
+        bool process(row_view< pixel >& in, row_view< pixel >& out)
+        {
+            std::reverse(in.data, in.data + in.width);
+            out = in;
+            return true;
+        }
+    };
+
+    /**
+     * \brief Row pipeline stage turning the %image upside down.
+     *
+     * Only the row positions are changed, so the stage costs nothing
+     * when reading into an %image; it cannot be used with
+     * pipeline_generator, which writes rows in order.
+     */
+    template< typename pixel >
+    class flip_vertical_stage
+        : public row_stage< flip_vertical_stage< pixel > >
+    {
+    public:
+        typedef pixel input_pixel;
+        typedef pixel output_pixel;
+
+        flip_vertical_stage()
+            : m_height(0)
+        {
+        }
+
+        void start(uint_32& /*width*/, uint_32& height)
+        {
+            m_height = height;
+        }
+
+        bool process(row_view< pixel >& in, row_view< pixel >& out)
+        {
+            out = in;
+            out.pos = m_height - 1 - in.pos;
+            return true;
+        }
+
+    private:
+        uint_32 m_height;
+    };
+
+    namespace detail
+    {
+
+        /**
+         * \brief Unpacks a pixel into red, green, blue and alpha
+         * values scaled to 16 bits.
+         */
+        template< typename pixel >
+        void unpack_pixel(pixel const& p, uint_32* rgba)
+        {
+            typedef pixel_traits< pixel > traits;
+            typedef typename traits::component_type component;
+            component const* c = reinterpret_cast< component const* >(& p);
+            uint_32 const scale = traits::get_bit_depth() == 8 ? 257 : 1;
+
+            if (traits::get_color_type() & color_mask_color)
+            {
+                rgba[0] = c[0] * scale;
+                rgba[1] = c[1] * scale;
+                rgba[2] = c[2] * scale;
+            }
+            else
+            {
+                rgba[0] = rgba[1] = rgba[2] = c[0] * scale;
+            }
+            rgba[3] = traits::get_color_type() & color_mask_alpha
+                ? c[traits::get_channels() - 1] * scale
+                : 65535;
+        }
+
+        /**
+         * \brief Packs red, green, blue and alpha values scaled to 16
+         * bits into a pixel, rounding to the nearest value when
+         * reducing depth and weighting by luminance when dropping
+         * color.
+         */
+        template< typename pixel >
+        void pack_pixel(uint_32 const* rgba, pixel& p)
+        {
+            typedef pixel_traits< pixel > traits;
+            typedef typename traits::component_type component;
+            component* c = reinterpret_cast< component* >(& p);
+            bool const reduce = traits::get_bit_depth() == 8;
+
+            if (traits::get_color_type() & color_mask_color)
+            {
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    c[i] = component(reduce
+                                     ? (rgba[i] * 255 + 32767) / 65535
+                                     : rgba[i]);
+                }
+            }
+            else
+            {
+                // the libpng default sRGB coefficients
+                uint_32 gray = rgba[0] == rgba[1] && rgba[1] == rgba[2]
+                    ? rgba[0]
+                    : (6968 * rgba[0] + 23434 * rgba[1] + 2366 * rgba[2]
+                       + 16384) >> 15;
+                c[0] = component(reduce ? (gray * 255 + 32767) / 65535 : gray);
+            }
+            if (traits::get_color_type() & color_mask_alpha)
+            {
+                c[traits::get_channels() - 1]
+                    = component(reduce
+                                ? (rgba[3] * 255 + 32767) / 65535
+                                : rgba[3]);
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief Row pipeline stage converting pixels to another type.
+     *
+     * Converts between any of the 8- and 16-bit gray, gray+alpha, RGB
+     * and RGBA pixel types: color is turned into gray by luminance,
+     * missing alpha becomes opaque and depth is scaled exactly.
+     */
+    template< typename from_pixel, typename to_pixel >
+    class convert_stage
+        : public row_stage< convert_stage< from_pixel, to_pixel > >
+    {
+    public:
+        typedef from_pixel input_pixel;
+        typedef to_pixel output_pixel;
+
+        void start(uint_32& width, uint_32& /*height*/)
+        {
+            m_row.resize(width);
+        }
+
+        bool process(row_view< input_pixel >& in,
+                     row_view< output_pixel >& out)
+        {
+            uint_32 rgba[4];
+            for (uint_32 x = 0; x < in.width; ++x)
+            {
+                detail::unpack_pixel(in.data[x], rgba);
+                detail::pack_pixel(rgba, m_row[x]);
+            }
+            out.data = m_row.empty() ? 0 : & m_row[0];
+            out.width = in.width;
+            out.pos = in.pos;
+            return true;
+        }
+
+    private:
+        std::vector< output_pixel > m_row;
+    };
+
+} // namespace png
+
+#endif // PNGPP_ROW_STAGES_HPP_INCLUDED
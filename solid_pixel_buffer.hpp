@@ -38,6 +38,7 @@
 #include <vector>
 
 #include "config.hpp"
+#include "error.hpp"
 #include "packed_pixel.hpp"
 #include "gray_pixel.hpp"
 #include "index_pixel.hpp"
@@ -110,12 +111,20 @@ namespace png
          *
          * If new width or height is greater than the original,
          * expanded pixels are filled with value of \a pixel().
+         * Throws png::error if the buffer size does not fit in
+         * size_t.
          */
         void resize(uint_32 width, uint_32 height)
         {
+            size_t stride = size_t(width) * bytes_per_pixel;
+            if (stride / bytes_per_pixel != width
+                || (height != 0 && stride > m_bytes.max_size() / height))
+            {
+                throw error("image size exceeds the address space");
+            }
             m_width = width;
             m_height = height;
-            m_stride = m_width * bytes_per_pixel;
+            m_stride = stride;
             m_bytes.resize(height * m_stride);
         }
 
@@ -165,7 +174,7 @@ namespace png
         void put_row(size_t index, row_const_access r)
         {
             row_access row = get_row(index);
-            for (uint_32 i = 0; i < m_width; ++i)
+            for (size_t i = 0; i < m_width; ++i)
                 *row++ = *r++;
         }
 
@@ -174,7 +183,7 @@ namespace png
          */
         pixel get_pixel(size_t x, size_t y) const
         {
-            size_t index = (y * m_width + x) * bytes_per_pixel;
+            size_t index = y * m_stride + x * bytes_per_pixel;
             return *reinterpret_cast< const pixel* >(&m_bytes.at(index));
         }
 
@@ -183,7 +192,7 @@ namespace png
          */
         void set_pixel(size_t x, size_t y, pixel p)
         {
-            size_t index = (y * m_width + x) * bytes_per_pixel;
+            size_t index = y * m_stride + x * bytes_per_pixel;
             *reinterpret_cast< pixel* >(&m_bytes.at(index)) = p;
         }
 
@@ -34,6 +34,8 @@
 #include <cassert>
 #include "image_info.hpp"
 #include "pixel_traits.hpp"
+#include "io_stats.hpp"
+#include "trace.hpp"
 
 namespace png
 {
@@ -88,6 +90,8 @@ namespace png
      */
     template< typename pixel, class info_holder >
     class streaming_base
+        : public io_stats_holder,
+          public trace_holder
     {
     public:
         typedef pixel_traits< pixel > traits;
@@ -115,6 +119,11 @@ namespace png
             // nothing to do in the most general case
         }
 
+        void end_pass(size_t /*pass*/)
+        {
+            // nothing to do in the most general case
+        }
+
         image_info& get_info()
         {
             return m_info_holder.get_info();
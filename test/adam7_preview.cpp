@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <fstream>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+template< typename pixel >
+bool
+same_pixel(pixel const& a, pixel const& b)
+{
+    return std::memcmp(& a, & b, sizeof(pixel)) == 0;
+}
+
+bool
+same_pixel(png::gray_pixel_1 const& a, png::gray_pixel_1 const& b)
+{
+    return png::byte(a) == png::byte(b);
+}
+
+/**
+ * Checks the preview made after every pass against the completely
+ * read image.
+ */
+template< typename pixel >
+class preview_checker
+{
+public:
+    preview_checker(png::image< pixel > const& partial,
+                    png::image< pixel > const& expected)
+        : m_partial(& partial),
+          m_expected(& expected),
+          m_passes(0)
+    {
+    }
+
+    void operator()(size_t pass)
+    {
+        check(pass == m_passes++, "passes out of order");
+
+        png::image< pixel > preview;
+        png::adam7::fill_preview(*m_partial, pass, preview);
+        bool interlaced = m_partial->get_interlace_type() != png::interlace_none;
+        size_t block_width = interlaced ? png::adam7::get_block_width(pass) : 1;
+        size_t block_height = interlaced ? png::adam7::get_block_height(pass) : 1;
+        for (size_t y = 0; y < preview.get_height(); ++y)
+        {
+            for (size_t x = 0; x < preview.get_width(); ++x)
+            {
+                size_t x0 = x - x % block_width;
+                size_t y0 = y - y % block_height;
+                check(same_pixel(pixel(preview[y][x]),
+                                 pixel((*m_expected)[y0][x0])),
+                      "preview pixel mismatch");
+            }
+        }
+    }
+
+    size_t get_pass_count() const
+    {
+        return m_passes;
+    }
+
+private:
+    png::image< pixel > const* m_partial;
+    png::image< pixel > const* m_expected;
+    size_t m_passes;
+};
+
+template< typename pixel, class transformation >
+void
+check_previews(char const* filename, transformation const& transform)
+{
+    png::image< pixel > expected;
+    expected.read(filename, transform);
+    png::image< pixel > image;
+    preview_checker< pixel > checker(image, expected);
+    std::ifstream stream(filename, std::ios::binary);
+    image.read_stream(stream, transform, checker);
+    check(checker.get_pass_count()
+          == (image.get_interlace_type() == png::interlace_none ? 1 : 7),
+          "wrong number of passes");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc < 2)
+    {
+        throw std::runtime_error("usage: adam7_preview PNG [packed]");
+    }
+    check_previews< png::rgba_pixel >
+        (argv[1], png::convert_color_space< png::rgba_pixel >());
+    if (argc > 2)
+    {
+        check_previews< png::gray_pixel_1 >
+            (argv[1], png::require_color_space< png::gray_pixel_1 >());
+    }
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "adam7_preview: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+template< typename pixel >
+bool
+same_pixels(png::image< pixel > const& a, png::image< pixel > const& b)
+{
+    if (a.get_width() != b.get_width() || a.get_height() != b.get_height())
+    {
+        return false;
+    }
+    for (size_t y = 0; y < a.get_height(); ++y)
+    {
+        for (size_t x = 0; x < a.get_width(); ++x)
+        {
+            pixel pa = a[y][x];
+            pixel pb = b[y][x];
+            if (std::memcmp(& pa, & pb, sizeof(pa)) != 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct frame_setup
+{
+    png::uint_32 x;
+    png::uint_32 y;
+    png::uint_32 width;
+    png::uint_32 height;
+    png::apng_dispose_op dispose;
+    png::apng_blend_op blend;
+};
+
+frame_setup const setups[] =
+{
+    { 0, 0, 40, 30, png::apng_dispose_previous, png::apng_blend_source },
+    { 5, 4, 10, 8, png::apng_dispose_previous, png::apng_blend_over },
+    { 0, 0, 20, 20, png::apng_dispose_background, png::apng_blend_source },
+    { 10, 10, 30, 20, png::apng_dispose_none, png::apng_blend_over },
+    { 2, 2, 5, 5, png::apng_dispose_none, png::apng_blend_source },
+    { 30, 0, 10, 30, png::apng_dispose_background, png::apng_blend_over }
+};
+size_t const frame_count = sizeof(setups) / sizeof(*setups);
+
+png::rgba_pixel
+frame_pixel(size_t index, size_t x, size_t y)
+{
+    return png::rgba_pixel(png::byte(x * 7 + index * 40),
+                           png::byte(y * 5 + index * 13),
+                           png::byte((x ^ y) * 3),
+                           png::byte(index % 2 ? (x + y) * 20 : 255));
+}
+
+class frame_generator
+    : public png::apng_generator< png::rgba_pixel, frame_generator >
+{
+public:
+    frame_generator()
+        : png::apng_generator< png::rgba_pixel, frame_generator >
+              (40, 30, frame_count, 3)
+    {
+    }
+
+    void get_frame(size_t index, png::image< png::rgba_pixel >& frame,
+                   png::apng_frame& control)
+    {
+        frame_setup const& setup = setups[index];
+        frame.resize(setup.width, setup.height);
+        for (size_t y = 0; y < setup.height; ++y)
+        {
+            for (size_t x = 0; x < setup.width; ++x)
+            {
+                frame[y][x] = frame_pixel(index, x, y);
+            }
+        }
+        control.set_x_offset(setup.x);
+        control.set_y_offset(setup.y);
+        control.set_delay(png::uint_16(index + 1), 25);
+        control.set_dispose_op(setup.dispose);
+        control.set_blend_op(setup.blend);
+    }
+};
+
+template< typename pixel >
+class frame_recorder
+    : public png::apng_consumer< pixel, frame_recorder< pixel > >
+{
+public:
+    frame_recorder()
+        : started(false)
+    {
+    }
+
+    void start_animation(png::uint_32, png::uint_32, size_t, size_t)
+    {
+        started = true;
+    }
+
+    void frame_ready(png::image< pixel > const& canvas,
+                     png::apng_frame const& control, size_t index)
+    {
+        check(index == canvases.size(), "frames out of order");
+        canvases.push_back(canvas);
+        controls.push_back(control);
+    }
+
+    bool started;
+    std::vector< png::image< pixel > > canvases;
+    std::vector< png::apng_frame > controls;
+};
+
+/**
+ * Renders the animation directly from its description.
+ */
+std::vector< png::image< png::rgba_pixel > >
+render_reference()
+{
+    std::vector< png::image< png::rgba_pixel > > result;
+    png::image< png::rgba_pixel > canvas(40, 30);
+    png::image< png::rgba_pixel > saved;
+    for (size_t i = 0; i < frame_count; ++i)
+    {
+        frame_setup const& setup = setups[i];
+        if (setup.dispose == png::apng_dispose_previous)
+        {
+            saved = canvas;
+        }
+        for (size_t y = 0; y < setup.height; ++y)
+        {
+            for (size_t x = 0; x < setup.width; ++x)
+            {
+                png::rgba_pixel src = frame_pixel(i, x, y);
+                png::rgba_pixel& dst = canvas[setup.y + y][setup.x + x];
+                if (setup.blend == png::apng_blend_source || src.alpha == 255)
+                {
+                    dst = src;
+                }
+                else if (src.alpha != 0)
+                {
+                    double sa = src.alpha / 255.0;
+                    double da = dst.alpha / 255.0 * (1 - sa);
+                    double a = sa + da;
+                    dst.red = png::byte((src.red * sa + dst.red * da) / a + 0.5);
+                    dst.green = png::byte((src.green * sa + dst.green * da) / a
+                                          + 0.5);
+                    dst.blue = png::byte((src.blue * sa + dst.blue * da) / a
+                                         + 0.5);
+                    dst.alpha = png::byte(a * 255 + 0.5);
+                }
+            }
+        }
+        result.push_back(canvas);
+
+        if (setup.dispose == png::apng_dispose_background
+            || (setup.dispose == png::apng_dispose_previous && i == 0))
+        {
+            for (size_t y = 0; y < setup.height; ++y)
+            {
+                for (size_t x = 0; x < setup.width; ++x)
+                {
+                    canvas[setup.y + y][setup.x + x] = png::rgba_pixel();
+                }
+            }
+        }
+        else if (setup.dispose == png::apng_dispose_previous)
+        {
+            canvas = saved;
+        }
+    }
+    return result;
+}
+
+/**
+ * Encoding an animation and decoding it again renders every frame as
+ * the specification says, whatever the number of threads.
+ */
+void
+check_round_trip()
+{
+    frame_generator gen;
+    std::ostringstream out;
+    gen.write(out);
+    std::string const apng = out.str();
+
+    frame_generator serial;
+    serial.set_thread_count(1);
+    std::ostringstream serial_out;
+    serial.write(serial_out);
+    check(serial_out.str() == apng, "output depends on thread count");
+
+    frame_recorder< png::rgba_pixel > frames;
+    std::istringstream in(apng);
+    frames.read(in);
+    check(frames.started, "start_animation not called");
+    check(frames.get_frame_count() == frame_count
+          && frames.get_play_count() == 3, "acTL mismatch");
+    check(frames.canvases.size() == frame_count, "frame count mismatch");
+
+    std::vector< png::image< png::rgba_pixel > > reference
+        = render_reference();
+    for (size_t i = 0; i < frame_count; ++i)
+    {
+        check(same_pixels(frames.canvases[i], reference[i]),
+              "frame rendered wrong");
+        check(frames.controls[i].get_x_offset() == setups[i].x
+              && frames.controls[i].get_width() == setups[i].width
+              && frames.controls[i].get_delay_num() == i + 1
+              && frames.controls[i].get_delay_den() == 25
+              && frames.controls[i].get_dispose_op() == setups[i].dispose
+              && frames.controls[i].get_blend_op() == setups[i].blend,
+              "fcTL mismatch");
+    }
+
+    // decoders without APNG support see the first frame
+    std::istringstream plain_in(apng);
+    png::image< png::rgba_pixel > plain(plain_in);
+    check(same_pixels(plain, reference[0]), "default image mismatch");
+
+    // a damaged fdAT chunk is detected, unless checksums are trusted
+    std::string damaged = apng;
+    size_t fdat = damaged.find("fdAT");
+    damaged[fdat + 4] ^= 1;
+    std::istringstream damaged_in(damaged);
+    frame_recorder< png::rgba_pixel > damaged_frames;
+    try
+    {
+        damaged_frames.read(damaged_in);
+        check(false, "damaged fdAT accepted");
+    }
+    catch (png::error const&)
+    {
+    }
+
+    // so is a damaged Adler-32 checksum behind an intact chunk CRC
+    std::string bad_adler = apng;
+    png::byte* chunk = reinterpret_cast< png::byte* >(& bad_adler[fdat - 4]);
+    png::uint_32 length = png::detail::read_uint_32(chunk);
+    chunk[8 + length - 1] ^= 1;
+    png::detail::put_uint_32(chunk + 8 + length,
+                             png::detail::update_crc(0xffffffff, chunk + 4,
+                                                     length + 4)
+                             ^ 0xffffffff);
+    std::istringstream bad_adler_in(bad_adler);
+    frame_recorder< png::rgba_pixel > bad_adler_frames;
+    try
+    {
+        bad_adler_frames.read(bad_adler_in);
+        check(false, "damaged Adler-32 accepted");
+    }
+    catch (png::error const&)
+    {
+    }
+}
+
+/**
+ * Two indexed frames, the second with its own palette unless \a
+ * shared.
+ */
+class indexed_generator
+    : public png::apng_generator< png::index_pixel, indexed_generator >
+{
+public:
+    explicit indexed_generator(bool shared)
+        : png::apng_generator< png::index_pixel, indexed_generator >
+              (8, 8, 2),
+          m_shared(shared)
+    {
+    }
+
+    void get_frame(size_t index, png::image< png::index_pixel >& frame,
+                   png::apng_frame&)
+    {
+        png::palette plte(4);
+        for (size_t i = 0; i < plte.size(); ++i)
+        {
+            int level = int(i) * 85;
+            plte[i] = index == 0 || m_shared
+                ? png::color(level, level, level)
+                : png::color(level, 0, 255 - level);
+        }
+        frame.set_palette(plte);
+        frame.resize(8, 8);
+        for (size_t y = 0; y < 8; ++y)
+        {
+            for (size_t x = 0; x < 8; ++x)
+            {
+                frame[y][x] = png::index_pixel((x + y + index) % 4);
+            }
+        }
+    }
+
+private:
+    bool m_shared;
+};
+
+/**
+ * Indexed frames must share the palette written once for all of them.
+ */
+void
+check_palettes()
+{
+    std::ostringstream shared;
+    indexed_generator(true).write(shared);
+    std::istringstream in(shared.str());
+    frame_recorder< png::rgb_pixel > frames;
+    frames.read(in);
+    check(frames.canvases.size() == 2
+          && frames.canvases[1][0][1].red == 170
+          && frames.canvases[1][0][1].blue == 170,
+          "indexed frames mismatch");
+
+    try
+    {
+        std::ostringstream own;
+        indexed_generator(false).write(own);
+    }
+    catch (std::logic_error const&)
+    {
+        return;
+    }
+    throw std::runtime_error("frame palette dropped silently");
+}
+
+/**
+ * A plain PNG reads as one frame covering the canvas.
+ */
+void
+check_plain(char const* filename)
+{
+    png::image< png::rgb_pixel_16 > image(filename);
+    frame_recorder< png::rgb_pixel_16 > frames;
+    std::ifstream stream(filename, std::ios::binary);
+    frames.read(stream);
+    check(frames.canvases.size() == 1 && frames.get_frame_count() == 1,
+          "plain PNG is not one frame");
+    check(same_pixels(frames.canvases[0], image), "plain PNG frame mismatch");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: apng PNG");
+    }
+    check_round_trip();
+    check_palettes();
+    check_plain(argv[1]);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "apng: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
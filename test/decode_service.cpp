@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+
+#ifdef PNGPP_HAS_STD_THREAD
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+typedef png::decode_service< png::rgba_pixel > service_type;
+typedef service_type::image_type image_type;
+typedef service_type::result_type result_type;
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * \brief A checksum of the size and pixels of an image.
+ */
+size_t
+checksum(image_type const& image)
+{
+    size_t sum = image.get_width() * 31 + image.get_height();
+    for (png::uint_32 y = 0; y < image.get_height(); ++y)
+    {
+        for (png::uint_32 x = 0; x < image.get_width(); ++x)
+        {
+            png::rgba_pixel p = image.get_pixel(x, y);
+            sum = sum * 131 + p.red + (p.green << 8) + (p.blue << 16)
+                + (size_t(p.alpha) << 24);
+        }
+    }
+    return sum;
+}
+
+struct input
+{
+    std::string filename;
+    std::string data;
+    size_t sum;
+    bool valid;
+};
+
+/**
+ * Decodes the given files and damaged copies of them many times over
+ * from several producer threads, through futures and callbacks, with
+ * a small queue so that producers block on it, and compares every
+ * result with serial decoding.  Also built with -fsanitize=thread by
+ * "make tsan".
+ */
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc < 2)
+    {
+        throw std::runtime_error("usage: decode_service PNG...");
+    }
+
+    std::vector< input > inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        input in;
+        in.filename = argv[i];
+        std::ifstream file(argv[i], std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        in.data = contents.str();
+        image_type image(argv[i]);
+        in.sum = checksum(image);
+        in.valid = true;
+        inputs.push_back(in);
+
+        // truncated copy, must fail
+        in.data.resize(in.data.size() / 2);
+        in.filename.clear();
+        in.valid = false;
+        inputs.push_back(in);
+    }
+
+    size_t const producers = 4;
+    size_t const rounds = 8;
+    std::atomic< size_t > callbacks(0);
+    std::atomic< size_t > failures(0);
+    {
+        service_type service(8, 16);
+        check(service.get_thread_count() == 8, "wrong thread count");
+
+        std::vector< std::thread > threads;
+        for (size_t t = 0; t < producers; ++t)
+        {
+            threads.push_back(std::thread([&, t]()
+            {
+                std::vector< std::future< result_type > > futures;
+                std::vector< size_t > expected;
+                for (size_t r = 0; r < rounds; ++r)
+                {
+                    for (size_t i = 0; i < inputs.size(); ++i)
+                    {
+                        input const& in = inputs[(i + t) % inputs.size()];
+                        if ((i + r) % 2 == 0)
+                        {
+                            futures.push_back(in.filename.empty()
+                                ? service.decode_data(in.data)
+                                : service.decode_file(in.filename));
+                            expected.push_back((i + t) % inputs.size());
+                            continue;
+                        }
+                        service.decode_data(in.data,
+                            [&callbacks, &failures, &in](result_type& res)
+                            {
+                                bool ok = in.valid
+                                    ? res.code == png::error_none
+                                      && checksum(res.image) == in.sum
+                                    : res.code != png::error_none
+                                      && !res.message.empty();
+                                if (!ok)
+                                {
+                                    ++failures;
+                                }
+                                ++callbacks;
+                            });
+                    }
+                }
+                for (size_t i = 0; i < futures.size(); ++i)
+                {
+                    result_type res = futures[i].get();
+                    input const& in = inputs[expected[i]];
+                    bool ok = in.valid
+                        ? res.code == png::error_none
+                          && checksum(res.image) == in.sum
+                        : res.code != png::error_none;
+                    if (!ok)
+                    {
+                        ++failures;
+                    }
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); ++t)
+        {
+            threads[t].join();
+        }
+
+        result_type missing = service.decode_file(inputs[0].filename
+                                                  + ".missing").get();
+        check(missing.code == png::error_stream, "missing file not reported");
+    }
+
+    check(failures == 0, "results differ from serial decoding");
+    check(callbacks == producers * rounds * inputs.size() / 2,
+          "callbacks lost");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "decode_service: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
+
+#else // PNGPP_HAS_STD_THREAD
+
+int
+main()
+{
+    std::cout << "decode_service: skipped, std::thread is not available"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+#endif // PNGPP_HAS_STD_THREAD
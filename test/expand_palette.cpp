@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <iostream>
+#include <ostream>
+
+#include <png.hpp>
+
+template< typename pixel >
+bool
+equal(png::basic_rgba_pixel< pixel > const& lhs,
+      png::basic_rgba_pixel< pixel > const& rhs)
+{
+    return lhs.red == rhs.red && lhs.green == rhs.green
+        && lhs.blue == rhs.blue && lhs.alpha == rhs.alpha;
+}
+
+bool
+equal(png::rgb_pixel const& lhs, png::rgb_pixel const& rhs)
+{
+    return lhs.red == rhs.red && lhs.green == rhs.green
+        && lhs.blue == rhs.blue;
+}
+
+/*
+ * Expands the indexed image in memory and compares the result to the
+ * image expanded while reading.
+ */
+template< typename index, typename pixel, class pixbuf >
+void
+test_expand(char const* file)
+{
+    png::image< index > indexed(file, png::require_color_space< index >());
+    png::image< pixel > expected(file);
+    png::image< pixel, pixbuf > expanded;
+    png::expand_palette(indexed, expanded);
+
+    if (expanded.get_width() != expected.get_width()
+        || expanded.get_height() != expected.get_height())
+    {
+        throw std::runtime_error("size mismatch");
+    }
+    for (size_t y = 0; y < expected.get_height(); ++y)
+    {
+        for (size_t x = 0; x < expected.get_width(); ++x)
+        {
+            if (!equal(expanded[y][x], expected[y][x]))
+            {
+                throw std::runtime_error("pixel mismatch");
+            }
+        }
+    }
+}
+
+template< typename index >
+void
+test_expand(char const* file)
+{
+    test_expand< index, png::rgba_pixel,
+                 png::pixel_buffer< png::rgba_pixel > >(file);
+    test_expand< index, png::rgba_pixel,
+                 png::solid_pixel_buffer< png::rgba_pixel > >(file);
+    test_expand< index, png::rgb_pixel,
+                 png::pixel_buffer< png::rgb_pixel > >(file);
+    test_expand< index, png::rgb_pixel,
+                 png::solid_pixel_buffer< png::rgb_pixel > >(file);
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 3)
+    {
+        throw std::runtime_error("usage: expand_palette BITS PNG");
+    }
+    int bits = atoi(argv[1]);
+    char const* file = argv[2];
+    switch (bits)
+    {
+    case 1:
+        test_expand< png::index_pixel_1 >(file);
+        break;
+    case 2:
+        test_expand< png::index_pixel_2 >(file);
+        break;
+    case 4:
+        test_expand< png::index_pixel_4 >(file);
+        break;
+    case 8:
+        test_expand< png::index_pixel >(file);
+        break;
+    default:
+        throw std::runtime_error("BITS should be 1, 2, 4 or 8");
+    }
+}
+catch (std::exception const& error)
+{
+    std::cerr << "expand_palette: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <png.hpp>
+
+// more than 2^32 pixels, yet no more than a row is held in memory;
+// the width is a multiple of 8, so there are no padding bits
+png::uint_32 const width = 100000;
+png::uint_32 const height = 50000;
+
+typedef png::gray_pixel_1 pixel;
+
+png::byte
+get_row_pattern(size_t pos)
+{
+    return png::byte(pos * 0x9d);
+}
+
+class pattern_generator
+    : public png::generator< pixel, pattern_generator >
+{
+public:
+    pattern_generator()
+        : png::generator< pixel, pattern_generator >(width, height),
+          m_row((width + 7) / 8)
+    {
+    }
+
+    png::byte* get_next_row(size_t pos)
+    {
+        std::memset(& m_row[0], get_row_pattern(pos), m_row.size());
+        return & m_row[0];
+    }
+
+private:
+    std::vector< png::byte > m_row;
+};
+
+class pattern_checker
+    : public png::consumer< pixel, pattern_checker,
+                            png::image_info_ref_holder >
+{
+public:
+    explicit pattern_checker(png::image_info& info)
+        : png::consumer< pixel, pattern_checker,
+                         png::image_info_ref_holder >(info),
+          m_row((width + 7) / 8),
+          m_expected(m_row.size()),
+          m_rows(0)
+    {
+    }
+
+    png::byte* get_next_row(size_t pos)
+    {
+        check_row();
+        m_pos = pos;
+        return & m_row[0];
+    }
+
+    /**
+     * Checks the row read last, if any.
+     */
+    void check_row()
+    {
+        if (m_rows++ == 0)
+        {
+            return;
+        }
+        std::memset(& m_expected[0], get_row_pattern(m_pos),
+                    m_expected.size());
+        if (m_row != m_expected)
+        {
+            throw std::runtime_error("row mismatch");
+        }
+    }
+
+    size_t get_row_count() const
+    {
+        return m_rows;
+    }
+
+private:
+    std::vector< png::byte > m_row;
+    std::vector< png::byte > m_expected;
+    size_t m_pos;
+    size_t m_rows;
+};
+
+void
+check_overflow()
+{
+    try
+    {
+        png::solid_pixel_buffer< png::rgba_pixel_16 >
+            buffer(0xffffffff, 0xffffffff);
+    }
+    catch (png::error const&)
+    {
+        return;
+    }
+    throw std::runtime_error("solid_pixel_buffer size overflow not detected");
+}
+
+typedef png::rgba_pixel_16 wide_pixel;
+
+// 65536 * 9000 pixels of 8 bytes: rows past 8192 start beyond 4 GiB
+png::uint_32 const wide_width = 65536;
+png::uint_32 const wide_height = 9000;
+
+/**
+ * A solid_pixel_buffer claiming the wide geometry over a few bytes:
+ * offsets past 4 GiB must land outside the bytes, while 32-bit
+ * arithmetic would wrap them back to the start.
+ */
+class wide_probe
+    : public png::solid_pixel_buffer< wide_pixel >
+{
+public:
+    wide_probe()
+    {
+        m_width = wide_width;
+        m_height = wide_height;
+        m_stride = size_t(wide_width) * sizeof(wide_pixel);
+        m_bytes.resize(sizeof(wide_pixel));
+    }
+};
+
+void
+check_wide_offsets()
+{
+    if (sizeof(size_t) < 8)
+    {
+        return;
+    }
+
+    wide_probe probe;
+    try
+    {
+        probe.get_pixel(0, 8192);
+        throw std::runtime_error("solid_pixel_buffer offset wrapped at 4 GiB");
+    }
+    catch (std::out_of_range const&)
+    {
+    }
+
+#ifdef PNGPP_HAS_MMAP
+    // a sparse file: only the pages touched below take disk space
+    png::mapped_pixel_buffer< wide_pixel > buffer(wide_width, wide_height);
+    png::uint_32 const xs[] = { 0, 1, wide_width - 1 };
+    png::uint_32 const ys[] = { 0, 8191, 8192, wide_height - 1 };
+    for (size_t i = 0; i < sizeof(ys) / sizeof(ys[0]); ++i)
+    {
+        for (size_t j = 0; j < sizeof(xs) / sizeof(xs[0]); ++j)
+        {
+            png::uint_32 x = xs[j];
+            png::uint_32 y = ys[i];
+            png::byte const* pos =
+                reinterpret_cast< png::byte const* >(& buffer[y][x]);
+            unsigned long long offset =
+                (unsigned long long)(y) * wide_width * sizeof(wide_pixel)
+                + (unsigned long long)(x) * sizeof(wide_pixel);
+            if ((unsigned long long)(pos - buffer.get_data()) != offset)
+            {
+                throw std::runtime_error("mapped_pixel_buffer row offset"
+                                         " wrapped at 4 GiB");
+            }
+            buffer.set_pixel(x, y, wide_pixel(png::uint_16(x), png::uint_16(y),
+                                              png::uint_16(i), png::uint_16(j)));
+        }
+    }
+    for (size_t i = 0; i < sizeof(ys) / sizeof(ys[0]); ++i)
+    {
+        for (size_t j = 0; j < sizeof(xs) / sizeof(xs[0]); ++j)
+        {
+            wide_pixel p = buffer.get_pixel(xs[j], ys[i]);
+            if (p.red != png::uint_16(xs[j]) || p.green != png::uint_16(ys[i])
+                || p.blue != i || p.alpha != j)
+            {
+                throw std::runtime_error("mapped_pixel_buffer pixel lost"
+                                         " past 4 GiB");
+            }
+        }
+    }
+#endif
+}
+
+int
+main()
+try
+{
+    check_overflow();
+    check_wide_offsets();
+
+    std::stringstream stream;
+    pattern_generator generator;
+    png::write_options options;
+    options.set_compression_level(1);
+    options.set_filter(png::filter_none);
+    generator.write(stream, options);
+
+    png::image_info info;
+    pattern_checker checker(info);
+    checker.read(stream);
+    checker.check_row();
+    if (checker.get_row_count() != size_t(height) + 1
+        || info.get_width() != width || info.get_height() != height)
+    {
+        throw std::runtime_error("image geometry mismatch");
+    }
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "gigapixel: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
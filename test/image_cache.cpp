@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+
+#ifdef PNGPP_HAS_STD_THREAD
+
+#include <thread>
+
+typedef png::image_cache< png::rgba_pixel > cache_type;
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+std::string
+read_file(char const* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void
+write_file(std::string const& filename, std::string const& data)
+{
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    file.write(data.data(), data.size());
+    check(file.good(), "cannot write temporary file");
+}
+
+/**
+ * Caches the given images: hits share the decoded image, changed files
+ * are decoded again, the budget is kept, and concurrent lookups from
+ * several threads agree.
+ */
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc < 3)
+    {
+        throw std::runtime_error("usage: image_cache TEMP_PNG PNG...");
+    }
+    std::string const temp = argv[1];
+    std::vector< std::string > files(argv + 2, argv + argc);
+
+    size_t total = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        png::image< png::rgba_pixel > image(files[i]);
+        total += size_t(image.get_width()) * image.get_height()
+            * sizeof(png::rgba_pixel);
+    }
+
+    {
+        cache_type cache(total * 4, 4);
+        cache_type::image_ptr first = cache.get(files[0]);
+        cache_type::image_ptr again = cache.get(files[0]);
+        check(first == again, "hit did not share the image");
+        check(cache.get_hits() == 1 && cache.get_misses() == 1,
+              "hit/miss counts wrong");
+
+        std::string const data = read_file(files[0].c_str());
+        size_t const file_size = cache.get_size();
+        cache_type::image_ptr from_data = cache.get_data(data);
+        check(from_data != first, "data shares the file entry");
+        // the data is kept to check hits against
+        check(cache.get_size() - file_size
+              == first->get_pixbuf().get_bytes().size() + data.size(),
+              "data entry size wrong");
+        check(cache.get_data(data) == from_data, "data hit did not share");
+        check(from_data->get_pixbuf().get_bytes()
+              == first->get_pixbuf().get_bytes(), "data decoded differently");
+
+        // a changed file is decoded again and replaces its entry
+        write_file(temp, data);
+        cache_type::image_ptr old_version = cache.get(temp);
+        size_t const cached_size = cache.get_size();
+        // trailing data is ignored, but changes the size
+        write_file(temp, data + '\0');
+        cache_type::image_ptr new_version = cache.get(temp);
+        check(new_version != old_version, "changed file served from cache");
+        check(cache.get_size() == cached_size, "stale entry kept");
+        // a rewrite of the same size is told apart by its mtime
+        write_file(temp, data + '\0');
+        check(cache.get(temp) != new_version,
+              "same-size rewrite served from cache");
+        std::remove(temp.c_str());
+        try
+        {
+            cache.get(temp);
+            check(false, "removed file served from cache");
+        }
+        catch (png::std_error const&)
+        {
+        }
+
+        cache.clear();
+        check(cache.get_size() == 0, "clear failed");
+        check(first->get_width() != 0, "held image freed");
+    }
+
+    {
+        // a budget of about half the images evicts
+        cache_type cache(total / 2, 2);
+        for (size_t round = 0; round < 2; ++round)
+        {
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                cache.get(files[i]);
+                check(cache.get_size() <= cache.get_budget(),
+                      "budget exceeded");
+            }
+        }
+        check(files.size() < 4 || cache.get_evictions() > 0,
+              "nothing evicted");
+    }
+
+    {
+        // one image may take the whole budget, whatever the shards
+        cache_type probe(total * 4);
+        size_t const first_size = probe.get(files[0]) ? probe.get_size() : 0;
+        cache_type cache(first_size, 16);
+        cache.get(files[1 % files.size()]);
+        cache_type::image_ptr first = cache.get(files[0]);
+        check(cache.get(files[0]) == first, "image of the budget not cached");
+        check(cache.get_size() == first_size, "budget exceeded");
+    }
+
+    {
+        cache_type cache(total * 4);
+        std::vector< std::thread > threads;
+        std::vector< int > failed(8, 0);
+        for (size_t t = 0; t < failed.size(); ++t)
+        {
+            threads.push_back(std::thread([&, t]()
+            {
+                for (size_t round = 0; round < 4; ++round)
+                {
+                    for (size_t i = 0; i < files.size(); ++i)
+                    {
+                        size_t f = (i + t) % files.size();
+                        cache_type::image_ptr a = cache.get(files[f]);
+                        cache_type::image_ptr b = cache.get(files[f]);
+                        if (a->get_pixbuf().get_bytes()
+                            != b->get_pixbuf().get_bytes())
+                        {
+                            failed[t] = 1;
+                        }
+                    }
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); ++t)
+        {
+            threads[t].join();
+        }
+        for (size_t t = 0; t < failed.size(); ++t)
+        {
+            check(!failed[t], "concurrent lookups disagree");
+        }
+        check(cache.get_hits() >= cache.get_misses(), "too few hits");
+    }
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "image_cache: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
+
+#else // PNGPP_HAS_STD_THREAD
+
+int
+main()
+{
+    std::cout << "image_cache: skipped, std::thread is not available"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+#endif // PNGPP_HAS_STD_THREAD
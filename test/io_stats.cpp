@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#define PNGPP_IO_STATS
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+void
+check_times(png::io_stats const& stats)
+{
+    check(stats.io_calls > 0, "no I/O callbacks counted");
+    check(stats.io_time >= 0 && stats.hook_time >= 0
+          && stats.total_time > 0, "negative time");
+    check(stats.io_time + stats.libpng_time + stats.hook_time
+          <= stats.total_time * 1.01 + 1e-4, "stage times exceed total");
+}
+
+/**
+ * Reading counts every byte of the file; writing counts every byte
+ * of the output.
+ */
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: io_stats PNG");
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string const png = contents.str();
+
+    png::io_stats read_stats;
+    png::image< png::rgba_pixel > image;
+    image.set_io_stats(& read_stats);
+    std::istringstream in(png);
+    image.read_stream(in);
+    check(read_stats.bytes == png.size(), "read byte count mismatch");
+    check_times(read_stats);
+
+    png::io_stats write_stats;
+    image.set_io_stats(& write_stats);
+    std::ostringstream out;
+    image.write_stream(out);
+    check(write_stats.bytes == out.str().size(), "write byte count mismatch");
+    check_times(write_stats);
+
+    // statistics add up
+    std::istringstream again(png);
+    image.set_io_stats(& read_stats);
+    image.read_stream(again);
+    check(read_stats.bytes == 2 * png.size(), "statistics not accumulated");
+
+    read_stats.reset();
+    check(read_stats.bytes == 0 && read_stats.io_calls == 0
+          && read_stats.total_time == 0, "reset failed");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "io_stats: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <png.hpp>
+
+typedef png::lazy_image< png::rgba_pixel > lazy_type;
+typedef png::image< png::rgba_pixel > image_type;
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+bool
+same_row(lazy_type& lazy, image_type const& image, png::uint_32 y)
+{
+    lazy_type::row_const_access row = lazy.get_row(y);
+    for (png::uint_32 x = 0; x < image.get_width(); ++x)
+    {
+        png::rgba_pixel p = row[x];
+        png::rgba_pixel q = image.get_pixel(x, y);
+        if (p.red != q.red || p.green != q.green || p.blue != q.blue
+            || p.alpha != q.alpha)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads rows in forward, backward and scattered order with cache
+ * budgets of one row, a few rows and the whole image, and compares
+ * them with image::read().  A forward scan must decode every row of a
+ * plain image once; interlaced images are decoded whole on every miss.
+ */
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: lazy_image PNG");
+    }
+
+    image_type image(argv[1]);
+    png::uint_32 const width = image.get_width();
+    png::uint_32 const height = image.get_height();
+    bool const interlaced = image.get_interlace_type() != png::interlace_none;
+    size_t const row_size = width * sizeof(png::rgba_pixel);
+    size_t const budgets[] = { 0, 3 * row_size, 1 << 20 };
+
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); ++b)
+    {
+        lazy_type lazy(argv[1], budgets[b]);
+        size_t const max_rows = budgets[b] / row_size > 0
+            ? budgets[b] / row_size : 1;
+        check(lazy.get_width() == width && lazy.get_height() == height,
+              "size mismatch");
+        check(lazy.get_decoded_rows() == 0, "decoded before access");
+
+        for (png::uint_32 y = 0; y < height; ++y)
+        {
+            check(same_row(lazy, image, y), "forward row differs");
+        }
+        if (!interlaced || height <= max_rows)
+        {
+            check(lazy.get_decoded_rows() == height
+                  && lazy.get_restarts() == 0,
+                  "forward scan decoded rows more than once");
+        }
+        check(lazy.get_cached_rows() >= 1
+              && lazy.get_cached_rows() <= max_rows, "cache over budget");
+
+        for (png::uint_32 y = height; y-- > 0; )
+        {
+            check(same_row(lazy, image, y), "backward row differs");
+        }
+        if (height <= max_rows)
+        {
+            check(lazy.get_decoded_rows() == height,
+                  "cached rows decoded again");
+        }
+        else if (!interlaced || max_rows == 1)
+        {
+            check(lazy.get_restarts() > 0, "evicted rows not decoded again");
+        }
+
+        for (png::uint_32 i = 0; i < 2 * height; ++i)
+        {
+            png::uint_32 x = (i * 7) % width;
+            png::uint_32 y = (i * 13 + 5) % height;
+            png::rgba_pixel p = lazy.get_pixel(x, y);
+            png::rgba_pixel q = image.get_pixel(x, y);
+            check(p.red == q.red && p.green == q.green && p.blue == q.blue
+                  && p.alpha == q.alpha, "scattered pixel differs");
+        }
+    }
+
+    // from a stream, which is read only as far as needed
+    std::ostringstream out;
+    image.write_stream(out);
+    std::istringstream in(out.str());
+    lazy_type lazy(in, 0);
+    check(same_row(lazy, image, 0), "stream row differs");
+    bool thrown = false;
+    try
+    {
+        lazy.get_row(height);
+    }
+    catch (std::out_of_range const&)
+    {
+        thrown = true;
+    }
+    check(thrown, "row past the bottom accepted");
+
+    // truncated data fails on access, not on opening
+    std::string data = out.str();
+    std::istringstream truncated(data.substr(0, data.size() * 3 / 4));
+    lazy_type broken(truncated, 0);
+    thrown = false;
+    try
+    {
+        for (png::uint_32 y = 0; y < height; ++y)
+        {
+            broken.get_row(y);
+        }
+        broken.get_row(height - 1);
+    }
+    catch (png::error const&)
+    {
+        thrown = true;
+    }
+    // rows are complete if only the IEND chunk was cut off
+    check(thrown || data.size() * 3 / 4 > data.size() - 12,
+          "truncated data not detected");
+
+    // a damaged header fails on opening, freeing the reader
+    std::istringstream no_header(data.substr(0, 20));
+    thrown = false;
+    try
+    {
+        lazy_type never(no_header);
+    }
+    catch (png::error const&)
+    {
+        thrown = true;
+    }
+    check(thrown, "damaged header accepted");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "lazy_image: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <png.hpp>
+
+typedef png::image< png::rgba_pixel_16,
+                    png::solid_pixel_buffer< png::rgba_pixel_16 > > solid_image;
+typedef png::image< png::rgba_pixel_16,
+                    png::mapped_pixel_buffer< png::rgba_pixel_16 > > mapped_image;
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+template< class image >
+std::string
+write_image(image& img)
+{
+    std::ostringstream stream;
+    img.write_stream(stream);
+    return stream.str();
+}
+
+/**
+ * Checks the image decoded into a memory mapped buffer reads and
+ * writes the same as one decoded into memory.
+ */
+void
+check_read_write(char const* filename)
+{
+    solid_image expected(filename);
+    mapped_image image(filename);
+    check(image.get_width() == expected.get_width()
+          && image.get_height() == expected.get_height(), "size mismatch");
+    png::solid_pixel_buffer< png::rgba_pixel_16 > const& bytes
+        = expected.get_pixbuf();
+    check(image.get_pixbuf().get_size() == bytes.get_bytes().size()
+          && std::memcmp(image.get_pixbuf().get_data(), & bytes.get_bytes()[0],
+                         bytes.get_bytes().size()) == 0, "pixel mismatch");
+    check(write_image(image) == write_image(expected), "output mismatch");
+}
+
+/**
+ * Checks the pixels stored in a named file stay there.
+ */
+void
+check_named_file()
+{
+    char const* filename = "out/mapped_pixel_buffer.raw";
+    {
+        png::mapped_pixel_buffer< png::rgb_pixel > buffer(16, 8, filename);
+        for (size_t y = 0; y < buffer.get_height(); ++y)
+        {
+            for (size_t x = 0; x < buffer.get_width(); ++x)
+            {
+                buffer.set_pixel(x, y, png::rgb_pixel(x, y, x ^ y));
+            }
+        }
+        buffer.sync();
+    }
+    png::mapped_pixel_buffer< png::rgb_pixel > buffer(16, 8, filename);
+    for (size_t y = 0; y < buffer.get_height(); ++y)
+    {
+        for (size_t x = 0; x < buffer.get_width(); ++x)
+        {
+            png::rgb_pixel p = buffer.get_pixel(x, y);
+            check(p.red == x && p.green == y && p.blue == (x ^ y),
+                  "named file contents mismatch");
+        }
+    }
+    try
+    {
+        buffer.get_row(8);
+    }
+    catch (std::out_of_range const&)
+    {
+        return;
+    }
+    throw std::runtime_error("row index not checked");
+}
+
+/**
+ * Checks an image decodes into a named file opened through
+ * image::get_pixbuf().
+ */
+void
+check_image_named_file(char const* filename)
+{
+    char const* raw = "out/mapped_image.raw";
+    solid_image expected(filename);
+    {
+        mapped_image image;
+        image.get_pixbuf().open(raw);
+        image.read(filename);
+        image.get_pixbuf().sync();
+    }
+    std::ifstream file(raw, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::vector< png::byte > const& bytes = expected.get_pixbuf().get_bytes();
+    check(contents.str().size() == bytes.size()
+          && std::memcmp(contents.str().data(), & bytes[0], bytes.size()) == 0,
+          "named file image mismatch");
+}
+
+/**
+ * Checks a buffer whose file cannot grow is left empty rather than
+ * with rows pointing at the old mapping.
+ */
+void
+check_resize_failure()
+{
+    png::mapped_pixel_buffer< png::rgb_pixel > buffer(16, 8);
+    struct rlimit saved;
+    ::getrlimit(RLIMIT_FSIZE, & saved);
+    struct rlimit limit = saved;
+    limit.rlim_cur = 1 << 20;
+    void (*handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+    ::setrlimit(RLIMIT_FSIZE, & limit);
+    bool failed = false;
+    try
+    {
+        buffer.resize(4096, 4096);
+    }
+    catch (png::std_error const&)
+    {
+        failed = true;
+    }
+    ::setrlimit(RLIMIT_FSIZE, & saved);
+    std::signal(SIGXFSZ, handler);
+    check(failed, "resize past RLIMIT_FSIZE did not fail");
+    check(buffer.get_width() == 0 && buffer.get_height() == 0
+          && buffer.get_size() == 0 && buffer.get_data() == 0,
+          "failed resize left the old geometry");
+    try
+    {
+        buffer.get_row(0);
+    }
+    catch (std::out_of_range const&)
+    {
+        buffer.resize(16, 8);
+        buffer.set_pixel(15, 7, png::rgb_pixel(1, 2, 3));
+        return;
+    }
+    throw std::runtime_error("row of a failed resize not checked");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: mapped_pixel_buffer PNG");
+    }
+    check_read_write(argv[1]);
+    check_named_file();
+    check_image_named_file(argv[1]);
+    check_resize_failure();
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "mapped_pixel_buffer: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * Profiles reading and writing an image.  Without access to hardware
+ * counters (other systems, containers, perf_event_paranoid) nothing
+ * must be counted; otherwise the counts must be plausible and add up.
+ */
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: perf_profiler PNG");
+    }
+
+    bool const available = png::perf_profiler::is_available();
+
+    png::image< png::rgba_pixel > image;
+    png::perf_counters read_counters;
+    {
+        png::perf_profiler profile(read_counters);
+        image.read(argv[1]);
+    }
+
+    png::perf_counters write_counters;
+    {
+        png::perf_profiler profile(write_counters);
+        std::ostringstream out;
+        image.write_stream(out);
+        profile.stop();
+    }
+
+    if (!available)
+    {
+        check(read_counters.runs == 0 && read_counters.cycles == 0
+              && write_counters.runs == 0, "counted without counters");
+        return EXIT_SUCCESS;
+    }
+
+    check(read_counters.runs == 1, "read not counted once");
+    check(write_counters.runs == 1, "stop() and destructor both counted");
+    check(read_counters.cycles > 0 && read_counters.instructions > 0,
+          "no cycles or instructions counted");
+    check(read_counters.get_ipc() > 0 && read_counters.get_ipc() < 16,
+          "implausible IPC");
+
+    double const cycles = read_counters.cycles;
+    {
+        png::perf_profiler profile(read_counters);
+        image.read(argv[1]);
+    }
+    check(read_counters.runs == 2 && read_counters.cycles > cycles,
+          "counts not accumulated");
+
+    read_counters.reset();
+    check(read_counters.runs == 0 && read_counters.cycles == 0,
+          "reset failed");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "perf_profiler: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
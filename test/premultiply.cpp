@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+unsigned long
+rounded_quotient(unsigned long n, unsigned long d)
+{
+    return (2 * n + d) / (2 * d);
+}
+
+/**
+ * Every 8-bit color and alpha pair premultiplies and unpremultiplies
+ * to the exactly rounded result.
+ */
+void
+check_exact_8()
+{
+    for (unsigned a = 0; a < 256; ++a)
+    {
+        for (unsigned c = 0; c < 256; ++c)
+        {
+            png::ga_pixel p(static_cast< png::byte >(c),
+                            static_cast< png::byte >(a));
+            png::premultiply_row(& p, 1);
+            check(p.value == rounded_quotient(c * a, 255),
+                  "8-bit premultiply rounding");
+
+            png::ga_pixel q(static_cast< png::byte >(c),
+                            static_cast< png::byte >(a));
+            png::unpremultiply_row(& q, 1);
+            unsigned long expected = a == 0
+                ? 0 : std::min(rounded_quotient(c * 255, a), 255ul);
+            check(q.value == expected, "8-bit unpremultiply rounding");
+        }
+    }
+}
+
+/**
+ * A spread of 16-bit pairs rounds exactly, and opaque pixels are
+ * unchanged by a round trip.
+ */
+void
+check_exact_16()
+{
+    for (unsigned long a = 0; a < 65536; a += 251)
+    {
+        for (unsigned long c = 0; c < 65536; c += 257)
+        {
+            png::rgba_pixel_16 p(png::uint_16(c), png::uint_16(c / 2),
+                                 png::uint_16(a), png::uint_16(a));
+            png::premultiply_row(& p, 1);
+            check(p.red == rounded_quotient(c * a, 65535)
+                  && p.green == rounded_quotient(c / 2 * a, 65535)
+                  && p.blue == rounded_quotient(a * a, 65535),
+                  "16-bit premultiply rounding");
+
+            if (c <= a && a != 0)
+            {
+                png::ga_pixel_16 q(static_cast< png::uint_16 >(c),
+                                   static_cast< png::uint_16 >(a));
+                png::unpremultiply_row(& q, 1);
+                check(q.value == rounded_quotient(c * 65535, a),
+                      "16-bit unpremultiply rounding");
+            }
+        }
+    }
+
+    png::rgba_pixel_16 opaque(1234, 65535, 0, 65535);
+    png::premultiply_row(& opaque, 1);
+    png::unpremultiply_row(& opaque, 1);
+    check(opaque.red == 1234 && opaque.green == 65535 && opaque.blue == 0,
+          "opaque pixel changed");
+}
+
+/**
+ * In place premultiplication of either buffer type and the decode
+ * stage agree, and unpremultiplying restores opaque images.
+ */
+void
+check_image(char const* filename)
+{
+    typedef png::image< png::rgba_pixel,
+                        png::solid_pixel_buffer< png::rgba_pixel > >
+        solid_image;
+    png::image< png::rgba_pixel > src(filename);
+    png::image< png::rgba_pixel > image(filename);
+    solid_image solid(filename);
+    png::premultiply(image);
+    png::premultiply(solid);
+
+    png::image< png::rgba_pixel > staged;
+    png::premultiply_stage< png::rgba_pixel > stage;
+    png::pipeline_consumer< png::premultiply_stage< png::rgba_pixel > >
+        pipeline_con(stage, staged);
+    std::ifstream stream(filename, std::ios::binary);
+    pipeline_con.read(stream);
+
+    bool opaque = true;
+    for (size_t y = 0; y < src.get_height(); ++y)
+    {
+        for (size_t x = 0; x < src.get_width(); ++x)
+        {
+            png::rgba_pixel a = image[y][x];
+            png::rgba_pixel b = solid[y][x];
+            png::rgba_pixel c = staged[y][x];
+            check(a.red == b.red && a.green == b.green && a.blue == b.blue
+                  && a.alpha == b.alpha
+                  && a.red == c.red && a.green == c.green && a.blue == c.blue
+                  && a.alpha == c.alpha, "premultiplied images differ");
+            opaque = opaque && a.alpha == 255;
+        }
+    }
+
+    png::unpremultiply(solid);
+    if (opaque)
+    {
+        for (size_t y = 0; y < src.get_height(); ++y)
+        {
+            for (size_t x = 0; x < src.get_width(); ++x)
+            {
+                png::rgba_pixel a = src[y][x];
+                png::rgba_pixel b = solid[y][x];
+                check(a.red == b.red && a.green == b.green
+                      && a.blue == b.blue, "round trip changed pixels");
+            }
+        }
+    }
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: premultiply PNG");
+    }
+    check_exact_8();
+    check_exact_16();
+    check_image(argv[1]);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "premultiply: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <iostream>
+#include <ostream>
+
+#include <png.hpp>
+
+typedef png::image< png::rgba_pixel > rgba_image;
+typedef png::image< png::index_pixel > index_image;
+
+png::rgba_pixel
+lookup(index_image const& image, size_t x, size_t y)
+{
+    size_t index = image[y][x];
+    png::color const& c = image.get_palette().at(index);
+    png::tRNS const& trns = image.get_tRNS();
+    return png::rgba_pixel(c.red, c.green, c.blue,
+                           index < trns.size() ? trns[index] : 255);
+}
+
+size_t
+count_colors(rgba_image const& image)
+{
+    std::vector< png::uint_32 > colors;
+    for (size_t y = 0; y < image.get_height(); ++y)
+    {
+        for (size_t x = 0; x < image.get_width(); ++x)
+        {
+            png::rgba_pixel p = image[y][x];
+            colors.push_back((p.red << 24) | (p.green << 16)
+                             | (p.blue << 8) | p.alpha);
+        }
+    }
+    std::sort(colors.begin(), colors.end());
+    return std::unique(colors.begin(), colors.end()) - colors.begin();
+}
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: quantize PNG");
+    }
+    char const* file = argv[1];
+
+    rgba_image source(file);
+    bool exact = count_colors(source) <= 256;
+
+    index_image indexed = png::quantize(source);
+    check(indexed.get_palette().size() <= 256, "too many colors");
+    check(indexed.get_tRNS().size() <= indexed.get_palette().size(),
+          "tRNS is longer than palette");
+    for (size_t y = 0; exact && y < source.get_height(); ++y)
+    {
+        for (size_t x = 0; x < source.get_width(); ++x)
+        {
+            png::rgba_pixel p = source[y][x];
+            png::rgba_pixel q = lookup(indexed, x, y);
+            check(p.red == q.red && p.green == q.green
+                  && p.blue == q.blue && p.alpha == q.alpha,
+                  "lossless quantization expected");
+        }
+    }
+
+    index_image dithered = png::quantize(source, 16, true);
+    check(dithered.get_palette().size() <= 16, "too many colors");
+
+    // conversion when reading
+    index_image converted(file);
+    png::image< png::gray_pixel > gray(file);
+    bool is_gray = true;
+    png::palette const& plte = converted.get_palette();
+    for (size_t i = 0; i < plte.size(); ++i)
+    {
+        is_gray = is_gray && plte[i].red == plte[i].green
+            && plte[i].red == plte[i].blue;
+    }
+    for (size_t y = 0; is_gray && y < gray.get_height(); ++y)
+    {
+        for (size_t x = 0; x < gray.get_width(); ++x)
+        {
+            check(plte.at(converted[y][x]).red == gray[y][x],
+                  "gray levels should be kept exactly");
+        }
+    }
+}
+catch (std::exception const& error)
+{
+    std::cerr << "quantize: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
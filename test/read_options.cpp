@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+template< class pixbuf >
+bool
+same_pixels(png::image< png::rgba_pixel, pixbuf > const& a,
+            png::image< png::rgba_pixel, pixbuf > const& b)
+{
+    if (a.get_width() != b.get_width() || a.get_height() != b.get_height())
+    {
+        return false;
+    }
+    for (size_t y = 0; y < a.get_height(); ++y)
+    {
+        for (size_t x = 0; x < a.get_width(); ++x)
+        {
+            png::rgba_pixel pa = a[y][x];
+            png::rgba_pixel pb = b[y][x];
+            if (std::memcmp(& pa, & pb, sizeof(pa)) != 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the offset of the data of the last IDAT chunk, which ends
+ * with the Adler-32 checksum, and its length.
+ */
+size_t
+find_last_idat(std::string const& png, size_t& idat_length)
+{
+    size_t pos = 8;
+    size_t idat = 0;
+    while (pos + 8 <= png.size())
+    {
+        unsigned char const* p
+            = reinterpret_cast< unsigned char const* >(png.data() + pos);
+        size_t length
+            = (size_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        if (png.compare(pos + 4, 4, "IDAT") == 0)
+        {
+            idat = pos + 8;
+            idat_length = length;
+        }
+        pos += length + 12;
+    }
+    if (idat == 0)
+    {
+        throw std::runtime_error("no IDAT chunk");
+    }
+    return idat;
+}
+
+bool
+read_fails(std::string const& png)
+{
+    png::image< png::rgba_pixel > image;
+    std::istringstream stream(png);
+    try
+    {
+        image.read(stream);
+    }
+    catch (png::error const&)
+    {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Intact files decode the same with and without trusting checksums;
+ * damaged checksums are only accepted when trusted.
+ */
+void
+check_checksums(char const* filename)
+{
+    png::read_options trusted;
+    trusted.set_trust_checksums(true);
+
+    png::image< png::rgba_pixel > checked(filename);
+    png::image< png::rgba_pixel > unchecked;
+    unchecked.read(filename, trusted);
+    check(same_pixels(checked, unchecked), "trusted read differs");
+
+    std::ostringstream out;
+    checked.write_stream(out);
+    std::string const png = out.str();
+    size_t length;
+    size_t const idat = find_last_idat(png, length);
+
+    std::string bad_crc = png;
+    bad_crc[idat + length] ^= 0x55;
+    check(read_fails(bad_crc), "CRC error not detected");
+    std::istringstream bad_crc_stream(bad_crc);
+    png::image< png::rgba_pixel > crc_trusted;
+    crc_trusted.read(bad_crc_stream, trusted);
+    check(same_pixels(checked, crc_trusted), "CRC error not ignored");
+
+#if defined(PNG_SET_OPTION_SUPPORTED) && defined(PNG_IGNORE_ADLER32)
+    std::string bad_adler = png;
+    bad_adler[idat + length - 1] ^= 0x55;
+    check(read_fails(bad_adler), "Adler-32 error not detected");
+    std::istringstream bad_adler_stream(bad_adler);
+    png::image< png::rgba_pixel > adler_trusted;
+    adler_trusted.read(bad_adler_stream, trusted);
+    check(same_pixels(checked, adler_trusted), "Adler-32 error not ignored");
+#endif
+}
+
+unsigned long
+crc32(std::string const& bytes, size_t pos)
+{
+    unsigned long crc = 0xffffffff;
+    for (; pos < bytes.size(); ++pos)
+    {
+        crc ^= static_cast< unsigned char >(bytes[pos]);
+        for (int k = 0; k < 8; ++k)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return crc ^ 0xffffffff;
+}
+
+/**
+ * Returns a chunk with the given type and payload.
+ */
+std::string
+make_chunk(char const* type, std::string const& data)
+{
+    std::string chunk(4, '\0');
+    chunk[0] = char(data.size() >> 24);
+    chunk[1] = char(data.size() >> 16);
+    chunk[2] = char(data.size() >> 8);
+    chunk[3] = char(data.size());
+    chunk += type;
+    chunk += data;
+    unsigned long crc = crc32(chunk, 4);
+    chunk += char(crc >> 24);
+    chunk += char(crc >> 16);
+    chunk += char(crc >> 8);
+    chunk += char(crc);
+    return chunk;
+}
+
+/**
+ * Reads the header of \a png, returning whether text and pHYs were
+ * stored.
+ */
+void
+read_ancillary(std::string const& png, png::read_options const& options,
+               bool& has_text, bool& has_phys)
+{
+    std::istringstream stream(png);
+    png::reader< std::istream > rd(stream);
+    rd.set_options(options);
+    rd.read_info();
+    png_text* text;
+    int count = 0;
+    png_get_text(rd.get_png_struct(), rd.get_info().get_png_info(),
+                 & text, & count);
+    has_text = count != 0;
+    has_phys = png_get_valid(rd.get_png_struct(),
+                             rd.get_info().get_png_info(), PNG_INFO_pHYs) != 0;
+}
+
+/**
+ * Skipped ancillary chunks are not stored, kept ones are, and the
+ * pixels (including tRNS transparency) do not change.
+ */
+void
+check_skip_chunks(char const* filename)
+{
+    png::read_options skip;
+    skip.set_skip_ancillary_chunks(true);
+
+    png::image< png::rgba_pixel > full(filename);
+    png::image< png::rgba_pixel > skipped;
+    skipped.read(filename, skip);
+    check(same_pixels(full, skipped), "skipping chunks changed pixels");
+
+    std::ostringstream out;
+    full.write_stream(out);
+    std::string png = out.str();
+    std::string const phys("\0\0\x0b\x13\0\0\x0b\x13\x01", 9);
+    png.insert(33, make_chunk("tEXt", std::string("Comment\0hello", 13))
+               + make_chunk("pHYs", phys));
+
+    bool has_text;
+    bool has_phys;
+    read_ancillary(png, png::read_options(), has_text, has_phys);
+    check(has_text && has_phys, "ancillary chunks not read");
+    read_ancillary(png, skip, has_text, has_phys);
+    check(!has_text && !has_phys, "ancillary chunks not skipped");
+    skip.keep_chunk("pHYs");
+    read_ancillary(png, skip, has_text, has_phys);
+    check(!has_text && has_phys, "kept chunk skipped");
+
+    try
+    {
+        skip.keep_chunk("toolong");
+        check(false, "invalid chunk name accepted");
+    }
+    catch (std::invalid_argument const&)
+    {
+    }
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: read_options PNG");
+    }
+    check_checksums(argv[1]);
+    check_skip_chunks(argv[1]);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "read_options: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
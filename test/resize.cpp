@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+
+#include <png.hpp>
+
+png::resample_filter const filters[] =
+{
+    png::resample_box,
+    png::resample_bilinear,
+    png::resample_bicubic,
+    png::resample_lanczos3
+};
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+template< typename pixel, class pixbuf_a, class pixbuf_b >
+int
+max_difference(png::image< pixel, pixbuf_a > const& a,
+               png::image< pixel, pixbuf_b > const& b)
+{
+    typedef typename png::pixel_traits< pixel >::component_type component;
+    int const channels = png::pixel_traits< pixel >::channels;
+
+    check(a.get_width() == b.get_width()
+          && a.get_height() == b.get_height(), "size mismatch");
+    int result = 0;
+    for (size_t y = 0; y < a.get_height(); ++y)
+    {
+        for (size_t x = 0; x < a.get_width(); ++x)
+        {
+            pixel pa = a[y][x];
+            pixel pb = b[y][x];
+            component const* ca = reinterpret_cast< component const* >(& pa);
+            component const* cb = reinterpret_cast< component const* >(& pb);
+            for (int c = 0; c < channels; ++c)
+            {
+                result = std::max(result, std::abs(int(ca[c]) - int(cb[c])));
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * Resizing to the same size must reproduce the image with any
+ * filter; both buffer types must give the same results.
+ */
+template< typename pixel >
+void
+check_image(char const* filename)
+{
+    png::image< pixel > src(filename);
+    png::image< pixel, png::solid_pixel_buffer< pixel > > solid_src(filename);
+
+    png::resize_options exact;
+    exact.set_premultiply_alpha(false);
+    png::resize_options linear;
+    linear.set_linear_light(true);
+    for (size_t i = 0; i < sizeof(filters) / sizeof(*filters); ++i)
+    {
+        png::image< pixel > same(src.get_width(), src.get_height());
+        png::resize(src, same, filters[i], exact);
+        check(max_difference(src, same) == 0, "identity resize changed pixels");
+
+        png::image< pixel > half(src.get_width() / 2 + 1,
+                                 src.get_height() / 3 + 1);
+        png::image< pixel, png::solid_pixel_buffer< pixel > >
+            solid_half(half.get_width(), half.get_height());
+        png::resize(src, half, filters[i], linear);
+        png::resize(solid_src, solid_half, filters[i], linear);
+        check(max_difference(half, solid_half) == 0, "buffer types differ");
+
+        png::image< pixel > large(src.get_width() * 3, src.get_height() * 2);
+        png::resize(src, large, filters[i]);
+    }
+}
+
+/**
+ * Box downscaling by 2 averages blocks of 2x2 pixels.
+ */
+void
+check_box_average()
+{
+    png::image< png::gray_pixel > src(64, 32);
+    for (size_t y = 0; y < src.get_height(); ++y)
+    {
+        for (size_t x = 0; x < src.get_width(); ++x)
+        {
+            src[y][x] = png::gray_pixel((x * 37 + y * 11) % 256);
+        }
+    }
+    png::image< png::gray_pixel > dst(32, 16);
+    png::resize(src, dst, png::resample_box);
+    for (size_t y = 0; y < dst.get_height(); ++y)
+    {
+        for (size_t x = 0; x < dst.get_width(); ++x)
+        {
+            int sum = src[2 * y][2 * x] + src[2 * y][2 * x + 1]
+                + src[2 * y + 1][2 * x] + src[2 * y + 1][2 * x + 1];
+            check(std::abs(4 * dst[y][x] - sum) <= 2, "box average mismatch");
+        }
+    }
+}
+
+/**
+ * With premultiplied alpha the color of a transparent pixel does not
+ * bleed into the result.
+ */
+void
+check_premultiplied()
+{
+    png::image< png::rgba_pixel_16 > src(2, 1);
+    src[0][0] = png::rgba_pixel_16(65535, 0, 0, 0);
+    src[0][1] = png::rgba_pixel_16(0, 0, 65535, 65535);
+    png::image< png::rgba_pixel_16 > dst(1, 1);
+    png::resize(src, dst, png::resample_box);
+    png::rgba_pixel_16 p = dst[0][0];
+    check(p.red == 0 && p.blue == 65535 && std::abs(p.alpha - 32768) <= 1,
+          "transparent color bleeds");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: resize PNG");
+    }
+    check_image< png::rgba_pixel >(argv[1]);
+    check_image< png::rgb_pixel_16 >(argv[1]);
+    check_image< png::ga_pixel >(argv[1]);
+    check_image< png::gray_pixel_16 >(argv[1]);
+    check_box_average();
+    check_premultiplied();
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "resize: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * Cropping, adding alpha and flipping while reading gives the same
+ * image as doing it on the full image afterwards.
+ */
+void
+check_consumer(char const* filename)
+{
+    png::image< png::rgb_pixel > src(filename);
+    size_t const x0 = 3;
+    size_t const y0 = 2;
+    size_t const width = 20;
+    size_t const height = 25;
+
+    typedef png::row_pipeline<
+        png::row_pipeline< png::crop_stage< png::rgb_pixel >,
+                           png::convert_stage< png::rgb_pixel,
+                                               png::rgba_pixel > >,
+        png::flip_vertical_stage< png::rgba_pixel > > pipeline;
+    pipeline stages = png::crop_stage< png::rgb_pixel >(x0, y0, width, height)
+        | png::convert_stage< png::rgb_pixel, png::rgba_pixel >()
+        | png::flip_vertical_stage< png::rgba_pixel >();
+
+    png::image< png::rgba_pixel > dst;
+    png::pipeline_consumer< pipeline > pipeline_con(stages, dst);
+    std::ifstream stream(filename, std::ios::binary);
+    pipeline_con.read(stream);
+
+    size_t const out_width = src.get_width() > x0
+        ? std::min(width, src.get_width() - x0) : 0;
+    size_t const out_height = src.get_height() > y0
+        ? std::min(height, src.get_height() - y0) : 0;
+    check(dst.get_width() == out_width && dst.get_height() == out_height,
+          "cropped size mismatch");
+    for (size_t y = 0; y < out_height; ++y)
+    {
+        for (size_t x = 0; x < out_width; ++x)
+        {
+            png::rgb_pixel a = src[y0 + out_height - 1 - y][x0 + x];
+            png::rgba_pixel b = dst[y][x];
+            check(a.red == b.red && a.green == b.green && a.blue == b.blue
+                  && b.alpha == 255, "pixel mismatch");
+        }
+    }
+}
+
+/**
+ * Widening to 16 bits and mirroring while writing.
+ */
+void
+check_generator(char const* filename)
+{
+    png::image< png::rgb_pixel > src(filename);
+
+    typedef png::row_pipeline< png::convert_stage< png::rgb_pixel,
+                                                   png::rgba_pixel_16 >,
+                               png::flip_horizontal_stage< png::rgba_pixel_16 > >
+        pipeline;
+    pipeline stages = png::convert_stage< png::rgb_pixel, png::rgba_pixel_16 >()
+        | png::flip_horizontal_stage< png::rgba_pixel_16 >();
+
+    std::stringstream stream;
+    png::pipeline_generator< pipeline > pipeline_gen(stages, src);
+    pipeline_gen.write(stream);
+
+    png::image< png::rgba_pixel_16 > dst;
+    dst.read_stream(stream);
+    check(dst.get_width() == src.get_width()
+          && dst.get_height() == src.get_height(), "size mismatch");
+    size_t const last = src.get_width() - 1;
+    for (size_t y = 0; y < src.get_height(); ++y)
+    {
+        for (size_t x = 0; x < src.get_width(); ++x)
+        {
+            png::rgb_pixel a = src[y][last - x];
+            png::rgba_pixel_16 b = dst[y][x];
+            check(b.red == a.red * 257 && b.green == a.green * 257
+                  && b.blue == a.blue * 257 && b.alpha == 65535,
+                  "written pixel mismatch");
+        }
+    }
+}
+
+/**
+ * Generators write rows in order, so a vertical flip is refused.
+ */
+void
+check_reordering(char const* filename)
+{
+    png::image< png::gray_pixel > src(filename);
+    png::flip_vertical_stage< png::gray_pixel > stages;
+    std::stringstream stream;
+    png::pipeline_generator< png::flip_vertical_stage< png::gray_pixel > >
+        pipeline_gen(stages, src);
+    try
+    {
+        pipeline_gen.write(stream);
+    }
+    catch (std::logic_error const&)
+    {
+        return;
+    }
+    check(src.get_height() == 1, "out of order rows accepted");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: row_pipeline PNG");
+    }
+    check_consumer(argv[1]);
+    check_generator(argv[1]);
+    check_reordering(argv[1]);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "row_pipeline: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * Records the chunks seen, with their payloads.
+ */
+struct chunk_recorder
+{
+    explicit chunk_recorder(size_t limit = size_t(-1))
+        : limit(limit)
+    {
+    }
+
+    bool operator()(png::metadata_chunk const& chunk)
+    {
+        check(!chunk.is("IDAT") && !chunk.is("IEND"), "image chunk reported");
+        types.push_back(chunk.get_type());
+        payloads.push_back(std::string(reinterpret_cast< char const* >
+                                       (chunk.get_data()),
+                                       chunk.get_size()));
+        after_image.push_back(chunk.is_after_image());
+        return types.size() < limit;
+    }
+
+    size_t limit;
+    std::vector< std::string > types;
+    std::vector< std::string > payloads;
+    std::vector< bool > after_image;
+};
+
+/**
+ * A stream buffer without seeking, like a pipe.
+ */
+class pipe_buffer
+    : public std::streambuf
+{
+public:
+    explicit pipe_buffer(std::string const& data)
+        : m_data(data)
+    {
+        char* begin = const_cast< char* >(m_data.data());
+        setg(begin, begin, begin + m_data.size());
+    }
+
+private:
+    std::string m_data;
+};
+
+unsigned long
+crc32(std::string const& bytes, size_t pos)
+{
+    unsigned long crc = 0xffffffff;
+    for (; pos < bytes.size(); ++pos)
+    {
+        crc ^= static_cast< unsigned char >(bytes[pos]);
+        for (int k = 0; k < 8; ++k)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return crc ^ 0xffffffff;
+}
+
+std::string
+make_chunk(char const* type, std::string const& data)
+{
+    std::string chunk(4, '\0');
+    chunk[0] = char(data.size() >> 24);
+    chunk[1] = char(data.size() >> 16);
+    chunk[2] = char(data.size() >> 8);
+    chunk[3] = char(data.size());
+    chunk += type;
+    chunk += data;
+    unsigned long crc = crc32(chunk, 4);
+    chunk += char(crc >> 24);
+    chunk += char(crc >> 16);
+    chunk += char(crc >> 8);
+    chunk += char(crc);
+    return chunk;
+}
+
+void
+check_same(chunk_recorder const& a, chunk_recorder const& b)
+{
+    check(a.types == b.types && a.payloads == b.payloads
+          && a.after_image == b.after_image, "scans differ");
+}
+
+/**
+ * Scanning a file, memory and a pipe gives the same chunks.
+ */
+void
+check_file(char const* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    chunk_recorder from_file;
+    png::scan_metadata(file, from_file);
+    check(!from_file.types.empty() && from_file.types[0] == "IHDR",
+          "IHDR not reported first");
+
+    std::ifstream again(filename, std::ios::binary);
+    std::ostringstream contents;
+    contents << again.rdbuf();
+    std::string const png = contents.str();
+
+    chunk_recorder from_memory;
+    png::scan_metadata(reinterpret_cast< png::byte const* >(png.data()),
+                       png.size(), from_memory);
+    check_same(from_file, from_memory);
+
+    pipe_buffer pipe(png);
+    std::istream pipe_stream(& pipe);
+    chunk_recorder from_pipe;
+    png::scan_metadata(pipe_stream, from_pipe);
+    check_same(from_file, from_pipe);
+
+    chunk_recorder first(1);
+    png::scan_metadata(reinterpret_cast< png::byte const* >(png.data()),
+                       png.size(), first);
+    check(first.types.size() == 1, "scan not stopped");
+
+    try
+    {
+        chunk_recorder truncated;
+        std::istringstream stream(png.substr(0, png.size() - 20));
+        png::scan_metadata(stream, truncated);
+        check(false, "truncated file accepted");
+    }
+    catch (png::error const&)
+    {
+    }
+
+    // a length beyond 2^31 - 1 is rejected before allocating for it
+    try
+    {
+        chunk_recorder huge;
+        std::istringstream stream(png.substr(0, 8)
+                                  + std::string("\xff\xff\xff\xf0tEXt", 8));
+        png::scan_metadata(stream, huge);
+        check(false, "invalid chunk length accepted");
+    }
+    catch (png::error const& error)
+    {
+        check(std::string(error.what()) == "invalid chunk length",
+              "invalid chunk length not reported");
+    }
+}
+
+/**
+ * Text chunks before and after the image data are found and parsed.
+ */
+void
+check_text(char const* filename)
+{
+    png::image< png::rgb_pixel > image(filename);
+    std::ostringstream out;
+    image.write_stream(out);
+    std::string png = out.str();
+
+    std::string const itxt("Title\0\0\0en\0Titel\0png++", 22);
+    std::string const time("\x07\xea\x0a\x12\x0c\x00\x00", 7);
+    png.insert(png.size() - 12, make_chunk("tIME", time)
+               + make_chunk("tEXt", std::string("Author\0someone", 14)));
+    png.insert(33, make_chunk("iTXt", itxt));
+
+    std::istringstream stream(png);
+    chunk_recorder chunks;
+    png::scan_metadata(stream, chunks);
+    size_t const n = chunks.types.size();
+    check(n >= 4 && chunks.types[1] == "iTXt" && !chunks.after_image[1]
+          && chunks.types[n - 2] == "tIME" && chunks.after_image[n - 2]
+          && chunks.payloads[n - 2] == time
+          && chunks.types[n - 1] == "tEXt" && chunks.after_image[n - 1],
+          "text chunks not found");
+
+    std::string keyword;
+    std::string text;
+    png::metadata_chunk itxt_chunk(reinterpret_cast< png::byte const* >
+                                   ("iTXt"),
+                                   reinterpret_cast< png::byte const* >
+                                   (chunks.payloads[1].data()),
+                                   png::uint_32(chunks.payloads[1].size()),
+                                   false);
+    check(png::read_text(itxt_chunk, keyword, text)
+          && keyword == "Title" && text == "png++", "iTXt not parsed");
+    png::metadata_chunk text_chunk(reinterpret_cast< png::byte const* >
+                                   ("tEXt"),
+                                   reinterpret_cast< png::byte const* >
+                                   (chunks.payloads[n - 1].data()),
+                                   png::uint_32(chunks.payloads[n - 1].size()),
+                                   true);
+    check(png::read_text(text_chunk, keyword, text)
+          && keyword == "Author" && text == "someone", "tEXt not parsed");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: scan_metadata PNG");
+    }
+    check_file(argv[1]);
+    check_text(argv[1]);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "scan_metadata: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
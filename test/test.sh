@@ -49,6 +49,90 @@ run "cmp out/palette8_tRNS.png.out cmp/palette8_tRNS.png.out"
 
 run "./write_gray_16 && cmp out/gray_16.out cmp/gray_16.out"
 
+for i in pngsuite/*.png; do
+    run "./quantize $i"
+done
+
+for i in pngsuite/*3p0*.png; do
+    bits=${i#*3p0}
+    run "./expand_palette ${bits%.png} $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./write_optimized $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./transcode $i"
+done
+
+run ./gigapixel
+
+for i in pngsuite/*.png; do
+    run "./mapped_pixel_buffer $i"
+done
+
+for i in pngsuite/bas*.png; do
+    run "./adam7_preview $i"
+done
+run "./adam7_preview pngsuite/basi0g01.png packed"
+
+for i in pngsuite/*.png; do
+    run "./thumbnail $i"
+done
+
+for i in pngsuite/bas*.png; do
+    run "./resize $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./row_pipeline $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./premultiply $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./read_options $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./scan_metadata $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./apng $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./io_stats $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./perf_profiler $i"
+done
+
+for i in pngsuite/*.png; do
+    run "./trace $i out/$i.trace.json"
+done
+
+for i in pngsuite/*.png; do
+    run "./try_read $i"
+done
+
+run "./decode_service pngsuite/*.png"
+
+for i in pngsuite/*.png; do
+    run "./lazy_image $i"
+done
+
+run "./image_cache out/image_cache.png pngsuite/[!x]*.png"
+
+for i in pngsuite/*.png; do
+    run "./write_realtime $i out/$i.realtime.png"
+done
+
 echo "\n=================="
 
 if [ $fails -eq 0 ]; then
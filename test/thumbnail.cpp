@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <vector>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * Computes the expected thumbnail from the completely read image,
+ * using the pixels of the Adam7 pass the thumbnail was made of.
+ */
+template< typename pixel >
+void
+check_thumbnail(png::image< pixel > const& full,
+                png::image< pixel > const& thumbnail, size_t pass)
+{
+    typedef typename png::pixel_traits< pixel >::component_type component;
+    int const channels = png::pixel_traits< pixel >::channels;
+
+    size_t x_start = 0, y_start = 0, x_step = 1, y_step = 1;
+    if (full.get_interlace_type() != png::interlace_none && pass < 6)
+    {
+        x_start = png::adam7::get_x_start(pass);
+        y_start = png::adam7::get_y_start(pass);
+        x_step = png::adam7::get_x_step(pass);
+        y_step = png::adam7::get_y_step(pass);
+    }
+    size_t width = (full.get_width() - x_start + x_step - 1) / x_step;
+    size_t height = (full.get_height() - y_start + y_step - 1) / y_step;
+    size_t dst_width = thumbnail.get_width();
+    size_t dst_height = thumbnail.get_height();
+    check(dst_width <= width && dst_height <= height, "thumbnail too large");
+
+    std::vector< double > sums(dst_width * dst_height * channels);
+    std::vector< double > counts(dst_width * dst_height);
+    for (size_t y = 0; y < height; ++y)
+    {
+        size_t dy = size_t(double(y) * dst_height / height);
+        for (size_t x = 0; x < width; ++x)
+        {
+            size_t dx = size_t(double(x) * dst_width / width);
+            pixel p = full[y_start + y * y_step][x_start + x * x_step];
+            component const* c = reinterpret_cast< component const* >(& p);
+            for (int i = 0; i < channels; ++i)
+            {
+                sums[(dy * dst_width + dx) * channels + i] += c[i];
+            }
+            ++counts[dy * dst_width + dx];
+        }
+    }
+    for (size_t y = 0; y < dst_height; ++y)
+    {
+        for (size_t x = 0; x < dst_width; ++x)
+        {
+            pixel p = thumbnail[y][x];
+            component const* c = reinterpret_cast< component const* >(& p);
+            for (int i = 0; i < channels; ++i)
+            {
+                double expected = sums[(y * dst_width + x) * channels + i]
+                    / counts[y * dst_width + x];
+                check(std::abs(c[i] - expected) <= 0.5, "pixel mismatch");
+            }
+        }
+    }
+}
+
+template< typename pixel >
+void
+check_size(char const* filename, size_t max_width, size_t max_height)
+{
+    png::image< pixel > full(filename);
+    png::image< pixel > thumbnail;
+    png::thumbnail_consumer< pixel > consumer(thumbnail, max_width, max_height);
+    std::ifstream stream(filename, std::ios::binary);
+    consumer.read(stream);
+
+    check(thumbnail.get_width() <= max_width
+          && thumbnail.get_height() <= max_height, "size limit exceeded");
+    if (full.get_width() <= max_width && full.get_height() <= max_height)
+    {
+        check(thumbnail.get_width() == full.get_width()
+              && thumbnail.get_height() == full.get_height(),
+              "image scaled needlessly");
+    }
+    check_thumbnail(full, thumbnail, consumer.get_pass());
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: thumbnail PNG");
+    }
+    char const* filename = argv[1];
+
+    check_size< png::rgb_pixel >(filename, 8, 8);
+    check_size< png::rgb_pixel >(filename, 5, 16);
+    check_size< png::rgb_pixel >(filename, 3, 3);
+    check_size< png::rgb_pixel >(filename, 20, 20);
+    check_size< png::rgb_pixel >(filename, 32, 32);
+    check_size< png::rgba_pixel_16 >(filename, 7, 7);
+    check_size< png::gray_pixel >(filename, 1, 1);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "thumbnail: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#define PNGPP_TRACE
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <png.hpp>
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <thread>
+#endif
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+size_t
+count(std::string const& text, std::string const& what)
+{
+    size_t n = 0;
+    for (size_t pos = text.find(what); pos != std::string::npos;
+         pos = text.find(what, pos + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+void
+decode(std::string const* png, png::trace_file* trace, char const* id)
+{
+    png::image< png::rgba_pixel > image;
+    image.set_trace(trace, id);
+    std::istringstream in(*png);
+    image.read_stream(in);
+}
+
+/**
+ * Traces reading and writing an image, also from several threads at
+ * once, and checks that every stage shows up in the trace file with
+ * the image name.
+ */
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 3)
+    {
+        throw std::runtime_error("usage: trace PNG TRACE_JSON");
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string const png = contents.str();
+
+    png::image< png::rgba_pixel > image;
+    size_t events;
+    {
+        png::trace_file trace(argv[2], 4);
+        image.set_trace(& trace, "first \"image\"");
+        std::istringstream in(png);
+        image.read_stream(in);
+
+        image.set_trace(& trace, "output");
+        std::ostringstream out;
+        image.write_stream(out);
+
+        image.set_trace(0);
+        image.write_stream(out);
+
+        std::vector< std::string > ids(4);
+#ifdef PNGPP_HAS_STD_THREAD
+        std::vector< std::thread > threads;
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            ids[i] = "thread" + std::string(1, char('0' + i));
+            threads.push_back(std::thread(decode, & png, & trace,
+                                          ids[i].c_str()));
+        }
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            threads[i].join();
+        }
+#else
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            ids[i] = "thread" + std::string(1, char('0' + i));
+            decode(& png, & trace, ids[i].c_str());
+        }
+#endif
+        // a long name is cut short, the event is still well formed
+        double now = png::detail::stats_clock();
+        trace.add_event("long_rows", std::string(1000, 'x'), now, now,
+                        1, 2, 3);
+        events = trace.get_event_count();
+    }
+
+    std::ifstream json_file(argv[2]);
+    std::ostringstream json_contents;
+    json_contents << json_file.rdbuf();
+    std::string const json = json_contents.str();
+
+    check(json.compare(0, 16, "{\"traceEvents\":[") == 0, "bad header");
+    check(json.find("]") != std::string::npos
+          && json[json.size() - 2] == '}', "trace not closed");
+    check(count(json, "\"ph\":\"X\"") == events, "event count mismatch");
+
+    size_t const passes = image.get_interlace_type()
+        == png::interlace_none ? 1 : 7;
+    check(count(json, "\"name\":\"read\"") == 5, "read events");
+    check(count(json, "\"name\":\"read_info\"") == 5, "read_info events");
+    check(count(json, "\"name\":\"read_end_info\"") == 5,
+          "read_end_info events");
+    check(count(json, "\"name\":\"write\"") == 1, "traced after reset");
+    check(count(json, "\"name\":\"write_info\"") == 1, "write_info events");
+    check(count(json, "\"name\":\"write_end_info\"") == 1,
+          "write_end_info events");
+    check(count(json, "\"name\":\"pass\"") == 6 * passes, "pass events");
+    check(count(json, "\"name\":\"read_rows\"") >= 5 * passes,
+          "row batch events");
+    check(count(json, "\"name\":\"compress_rows\"") >= 1,
+          "compress events");
+    check(count(json, "\"rows\":")
+          == count(json, "_rows\""), "row counts missing");
+
+    check(count(json, "\"image\":\"first \\\"image\\\"\"") > 0,
+          "image name not quoted");
+    check(count(json, "\"image\":\"output\"") > 0, "output name missing");
+    check(count(json, "\"image\":\"thread3\"") > 0, "thread name missing");
+
+    std::string const tail = "\",\"pass\":1,\"row\":2,\"rows\":3}}";
+    std::string::size_type name = json.find(std::string(100, 'x'));
+    std::string::size_type end = json.find('"', name);
+    check(name != std::string::npos && end != std::string::npos
+          && end - name < 256
+          && json.compare(end, tail.size(), tail) == 0,
+          "long image name not cut short");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "trace: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
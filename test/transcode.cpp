@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+template< typename pixel >
+void
+check_same_pixels(png::image< pixel > const& a, png::image< pixel > const& b)
+{
+    check(a.get_width() == b.get_width()
+          && a.get_height() == b.get_height(), "size mismatch");
+    for (size_t y = 0; y < a.get_height(); ++y)
+    {
+        for (size_t x = 0; x < a.get_width(); ++x)
+        {
+            check(std::memcmp(& a[y][x], & b[y][x], sizeof(pixel)) == 0,
+                  "pixel mismatch");
+        }
+    }
+}
+
+std::string
+read_file(char const* filename)
+{
+    std::ifstream stream(filename, std::ios::binary);
+    std::ostringstream data;
+    data << stream.rdbuf();
+    return data.str();
+}
+
+/**
+ * Transcodes the file as it is and checks the result decodes to the
+ * same pixels and keeps the format.
+ */
+void
+check_identity(char const* filename, png::write_options const& options)
+{
+    std::istringstream in(read_file(filename));
+    std::ostringstream out;
+    png::transcode(in, out, options);
+
+    std::istringstream result(out.str());
+    png::reader< std::istream > rd(result);
+    rd.read_info();
+    std::istringstream orig_in(read_file(filename));
+    png::reader< std::istream > orig(orig_in);
+    orig.read_info();
+    check(rd.get_color_type() == orig.get_color_type()
+          && rd.get_bit_depth() == orig.get_bit_depth()
+          && rd.get_interlace_type() == orig.get_interlace_type(),
+          "format changed");
+
+    png::image< png::rgba_pixel_16 > original(filename);
+    std::istringstream again(out.str());
+    png::image< png::rgba_pixel_16 > transcoded;
+    transcoded.read(again);
+    check_same_pixels(original, transcoded);
+}
+
+/**
+ * Transcodes the file to the format of the pixel type and checks the
+ * result against what reading into an image gives.
+ */
+template< typename pixel >
+void
+check_convert(char const* filename)
+{
+    std::istringstream in(read_file(filename));
+    std::ostringstream out;
+    png::transcode< pixel >(in, out);
+
+    png::image< pixel > expected(filename);
+    std::istringstream result(out.str());
+    png::image< pixel > transcoded;
+    transcoded.read(result, png::require_color_space< pixel >());
+    check_same_pixels(expected, transcoded);
+}
+
+/**
+ * Checks that a decoding error in the middle of the image data is
+ * reported rather than leaving the encoder waiting for rows.
+ */
+void
+check_truncated(char const* filename)
+{
+    std::string data = read_file(filename);
+    std::istringstream in(data.substr(0, data.size() * 3 / 4));
+    std::ostringstream out;
+    try
+    {
+        png::transcode(in, out);
+    }
+    catch (png::error const&)
+    {
+        return;
+    }
+    throw std::runtime_error("truncated input accepted");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: transcode PNG");
+    }
+    char const* filename = argv[1];
+
+    check_identity(filename, png::write_options());
+    png::write_options options;
+    options.set_compression_level(9);
+    options.set_compression_strategy(png::compression_strategy_rle);
+    options.set_filter(png::filter_up);
+    options.set_compression_buffer_size(1 << 16);
+    check_identity(filename, options);
+
+    check_convert< png::rgba_pixel >(filename);
+    check_convert< png::rgb_pixel >(filename);
+    check_convert< png::gray_pixel_16 >(filename);
+    check_convert< png::index_pixel >(filename);
+
+    check_truncated(filename);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "transcode: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <png.hpp>
+
+typedef png::image< png::rgba_pixel > image_type;
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+bool
+same_pixels(image_type const& a, image_type const& b)
+{
+    if (a.get_width() != b.get_width() || a.get_height() != b.get_height())
+    {
+        return false;
+    }
+    for (png::uint_32 y = 0; y < a.get_height(); ++y)
+    {
+        for (png::uint_32 x = 0; x < a.get_width(); ++x)
+        {
+            png::rgba_pixel p = a.get_pixel(x, y);
+            png::rgba_pixel q = b.get_pixel(x, y);
+            if (p.red != q.red || p.green != q.green || p.blue != q.blue
+                || p.alpha != q.alpha)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads damaged data with both read() and try_read(): try_read() must
+ * fail exactly where read() throws, with a message, and never throw.
+ */
+void
+check_damaged(std::string const& png, png::error_status& status)
+{
+    std::istringstream in(png);
+    image_type thrown;
+    bool threw = false;
+    try
+    {
+        thrown.read(in);
+    }
+    catch (std::exception const&)
+    {
+        threw = true;
+    }
+
+    std::istringstream again(png);
+    image_type image;
+    png::error_code code = image.try_read(again, status);
+    check(code == status.get_code(), "returned and recorded codes differ");
+    check(threw == (code != png::error_none), "try_read() disagrees with read()");
+    check(code == png::error_none || status.get_message()[0] != '\0',
+          "no error message");
+    check(code != png::error_mismatch && code != png::error_unsupported,
+          "unexpected error kind");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: try_read PNG");
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string const png = contents.str();
+
+    png::error_status status;
+    image_type expected(argv[1]);
+    image_type image;
+    check(image.try_read(argv[1], status) == png::error_none
+          && status.is_ok(), "try_read() failed on a valid file");
+    check(same_pixels(image, expected), "pixels differ from read()");
+
+    check(image.try_read(std::string(argv[1]) + ".missing", status)
+          == png::error_stream, "missing file not reported");
+
+    // truncated at every 7th byte: signature, header, data or end
+    for (size_t size = 0; size < png.size(); size += 7)
+    {
+        check_damaged(png.substr(0, size), status);
+        check(status.get_code() != png::error_none, "truncation not found");
+    }
+
+    // a flipped bit anywhere breaks a CRC, the signature or the data
+    for (size_t pos = 0; pos < png.size(); pos += 5)
+    {
+        std::string damaged = png;
+        damaged[pos] = char(damaged[pos] ^ 0x10);
+        check_damaged(damaged, status);
+    }
+
+    // the object is still usable after failing
+    std::istringstream in(png);
+    check(image.try_read(in, status) == png::error_none,
+          "no recovery after errors");
+    check(same_pixels(image, expected), "pixels differ after errors");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "try_read: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
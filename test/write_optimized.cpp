@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+
+#include <png.hpp>
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+int
+get_bit_depth(std::string const& data)
+{
+    std::istringstream stream(data);
+    png::reader< std::istream > rd(stream);
+    rd.read_info();
+    return rd.get_bit_depth();
+}
+
+template< typename pixel >
+size_t
+write_optimized(png::image< pixel >& image, std::string& data)
+{
+    std::ostringstream plain;
+    image.write_stream(plain);
+    std::ostringstream optimized;
+    image.write_optimized_stream(optimized);
+    data = optimized.str();
+    return plain.str().size();
+}
+
+template< typename pixel >
+void
+check_round_trip(char const* filename)
+{
+    png::image< pixel > image(filename);
+    std::string data;
+    size_t plain_size = write_optimized(image, data);
+    check(data.size() <= plain_size, "optimized output is larger");
+
+    std::istringstream stream(data);
+    png::image< pixel > result;
+    result.read(stream);
+    check(result.get_width() == image.get_width()
+          && result.get_height() == image.get_height(), "size mismatch");
+    check(result.get_interlace_type() == image.get_interlace_type(),
+          "interlace type mismatch");
+    for (size_t y = 0; y < image.get_height(); ++y)
+    {
+        for (size_t x = 0; x < image.get_width(); ++x)
+        {
+            check(std::memcmp(& result[y][x], & image[y][x],
+                              sizeof(pixel)) == 0, "pixel mismatch");
+        }
+    }
+}
+
+/**
+ * 16-bit pixel types keep 16-bit samples, even when every sample is
+ * v * 257, since reading 8-bit data into them does not restore the
+ * low bytes.
+ */
+template< typename pixel >
+void
+check_round_trip_16(char const* filename)
+{
+    check_round_trip< pixel >(filename);
+    png::image< pixel > image(filename);
+    std::string data;
+    write_optimized(image, data);
+    check(get_bit_depth(data) == 16, "16-bit samples were reduced");
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 2)
+    {
+        throw std::runtime_error("usage: write_optimized PNG");
+    }
+    char const* filename = argv[1];
+
+    check_round_trip< png::rgba_pixel >(filename);
+    check_round_trip< png::rgb_pixel >(filename);
+    check_round_trip< png::ga_pixel >(filename);
+    check_round_trip< png::gray_pixel >(filename);
+    check_round_trip< png::index_pixel >(filename);
+    check_round_trip_16< png::rgba_pixel_16 >(filename);
+    check_round_trip_16< png::gray_pixel_16 >(filename);
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "write_optimized: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
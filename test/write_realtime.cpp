@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+#include <png.hpp>
+
+typedef png::image< png::rgba_pixel > image_type;
+
+void
+check(bool condition, char const* message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+bool
+same_pixels(image_type const& a, image_type const& b)
+{
+    if (a.get_width() != b.get_width() || a.get_height() != b.get_height())
+    {
+        return false;
+    }
+    for (png::uint_32 y = 0; y < a.get_height(); ++y)
+    {
+        for (png::uint_32 x = 0; x < a.get_width(); ++x)
+        {
+            png::rgba_pixel p = a.get_pixel(x, y);
+            png::rgba_pixel q = b.get_pixel(x, y);
+            if (p.red != q.red || p.green != q.green || p.blue != q.blue
+                || p.alpha != q.alpha)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * A string stream buffer counting how often it is flushed.
+ */
+class counting_buffer
+    : public std::stringbuf
+{
+public:
+    counting_buffer()
+        : flushes(0)
+    {
+    }
+
+    int flushes;
+
+protected:
+    int sync()
+    {
+        ++flushes;
+        return std::stringbuf::sync();
+    }
+};
+
+/**
+ * Writes \a image with \a options and checks the pixels survive;
+ * returns how often the writer flushed the stream.
+ */
+int
+write_and_compare(image_type& image, png::write_options const& options,
+                  std::string& png)
+{
+    counting_buffer buffer;
+    std::ostream stream(& buffer);
+    image.write_stream(stream, options);
+    png = buffer.str();
+
+    std::istringstream in(png);
+    image_type decoded;
+    decoded.read_stream(in);
+    check(same_pixels(image, decoded), "pixels differ after writing");
+    return buffer.flushes;
+}
+
+int
+main(int argc, char* argv[])
+try
+{
+    if (argc != 3)
+    {
+        throw std::runtime_error("usage: write_realtime PNG OUTPUT");
+    }
+
+    image_type image(argv[1]);
+    std::string png;
+
+    write_and_compare(image, png::write_mode_default, png);
+    size_t default_size = png.size();
+
+    check(write_and_compare(image, png::write_mode_realtime, png) == 0,
+          "realtime mode flushed the stream");
+    // stored deflate: every filter byte and sample is in the file
+    size_t raw_size = size_t(image.get_height())
+        * (1 + 4 * size_t(image.get_width()));
+    check(png.size() > raw_size, "realtime mode compressed the data");
+    check(png.size() >= default_size, "stored data smaller than compressed");
+
+    check(write_and_compare(image, png::write_mode_realtime_rle, png) == 0,
+          "realtime RLE mode flushed the stream");
+
+    image.write(argv[2], png::write_mode_realtime);
+    image_type written(argv[2]);
+    check(same_pixels(image, written), "pixels differ in the written file");
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& error)
+{
+    std::cerr << "write_realtime: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_THUMBNAIL_CONSUMER_HPP_INCLUDED
+#define PNGPP_THUMBNAIL_CONSUMER_HPP_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "reader.hpp"
+#include "image.hpp"
+#include "adam7.hpp"
+#include "convert_color_space.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief Reads a PNG image scaled down to fit a given size.
+     *
+     * The rows are averaged into an accumulator as they are decoded,
+     * so only a source row and a row of sums are held in memory, on
+     * top of the thumbnail itself.  Every thumbnail pixel is the
+     * average of the box of source pixels mapping onto it.  The
+     * thumbnail keeps the aspect ratio of the source; images which
+     * already fit are read as they are.
+     *
+     * An interlaced %image is only read up to the first Adam7 pass
+     * which alone has at least the resolution of the thumbnail, and
+     * that pass is scaled down; the rest of the file is not decoded.
+     * When no pass is large enough (the thumbnail is more than half
+     * as high as the source) the whole %image is read into memory.
+     *
+     * The pixel type must have 8 or 16 bits per channel and must not
+     * be indexed.
+     *
+     * \code
+     * png::image< png::rgb_pixel > thumbnail;
+     * png::thumbnail_consumer< png::rgb_pixel > consumer(thumbnail, 256, 256);
+     * consumer.read(stream);
+     * \endcode
+     */
+    template< typename pixel,
+              typename pixel_buffer_type = pixel_buffer< pixel > >
+    class thumbnail_consumer
+    {
+    public:
+        typedef pixel_traits< pixel > traits;
+        typedef typename traits::component_type component;
+        typedef image< pixel, pixel_buffer_type > image_type;
+
+        /**
+         * \brief Constructs a consumer storing thumbnails no larger
+         * than \a max_width by \a max_height into \a thumbnail.
+         */
+        thumbnail_consumer(image_type& thumbnail,
+                           uint_32 max_width, uint_32 max_height)
+            : m_image(& thumbnail),
+              m_max_width(max_width),
+              m_max_height(max_height),
+              m_pass(0)
+        {
+        }
+
+        /**
+         * \brief Reads a thumbnail from the stream, converting it to
+         * the pixel type with convert_color_space.
+         */
+        template< class istream >
+        void read(istream& stream)
+        {
+            read(stream, convert_color_space< pixel >());
+        }
+
+        /**
+         * \brief Reads a thumbnail from the stream using custom io
+         * transformation.
+         */
+        template< class istream, class transformation >
+        void read(istream& stream, transformation const& transform)
+        {
+            reader< istream > rd(stream);
+            rd.read_info();
+            transform(rd);
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+            if (traits::get_bit_depth() == 16)
+            {
+#ifdef PNG_READ_SWAP_SUPPORTED
+                rd.set_swap();
+#else
+                throw error("Cannot read 16-bit image: recompile with PNG_READ_SWAP_SUPPORTED.");
+#endif
+            }
+#endif
+
+            uint_32 width = rd.get_width();
+            uint_32 height = rd.get_height();
+            uint_32 dst_width = width;
+            uint_32 dst_height = height;
+            fit(dst_width, dst_height);
+
+            bool interlaced = rd.get_interlace_type() != interlace_none;
+            bool full_frame = false;
+            m_pass = 0;
+            if (interlaced)
+            {
+                while (m_pass < adam7::pass_count - 1
+                       && (adam7::get_pass_width(width, m_pass) < dst_width
+                           || adam7::get_pass_height(height, m_pass)
+                              < dst_height))
+                {
+                    ++m_pass;
+                }
+                full_frame = adam7::get_pass_height(height, m_pass) < dst_height;
+                if (full_frame)
+                {
+#ifdef PNG_READ_INTERLACING_SUPPORTED
+                    rd.set_interlace_handling();
+#else
+                    throw error("Cannot read interlaced image: interlace handling disabled.");
+#endif
+                }
+            }
+
+            rd.update_info();
+            if (rd.get_color_type() != traits::get_color_type()
+                || rd.get_bit_depth() != traits::get_bit_depth())
+            {
+                throw std::logic_error("color type and/or bit depth mismatch"
+                                       " in png::thumbnail_consumer::read()");
+            }
+
+            m_image->resize(dst_width, dst_height);
+            size_t row_size = size_t(width) * traits::channels;
+            if (full_frame)
+            {
+                std::vector< component > frame(row_size * height);
+                for (size_t pass = 0; pass < adam7::pass_count; ++pass)
+                {
+                    for (size_t y = 0; y < height; ++y)
+                    {
+                        rd.read_row(reinterpret_cast< byte* >
+                                    (& frame[y * row_size]));
+                    }
+                }
+                start(width, height);
+                for (size_t y = 0; y < height; ++y)
+                {
+                    add_row(& frame[y * row_size], y);
+                }
+            }
+            else
+            {
+                std::vector< component > row(row_size);
+                // the passes before the one used are decoded and dropped
+                size_t first = interlaced ? 0 : m_pass;
+                for (size_t pass = first; pass <= m_pass; ++pass)
+                {
+                    uint_32 pass_width = interlaced
+                        ? adam7::get_pass_width(width, pass) : width;
+                    uint_32 pass_height = interlaced
+                        ? adam7::get_pass_height(height, pass) : height;
+                    if (pass_width == 0)
+                    {
+                        continue;
+                    }
+                    if (pass == m_pass)
+                    {
+                        start(pass_width, pass_height);
+                    }
+                    for (size_t y = 0; y < pass_height; ++y)
+                    {
+                        rd.read_row(reinterpret_cast< byte* >(& row[0]));
+                        if (pass == m_pass)
+                        {
+                            add_row(& row[0], y);
+                        }
+                    }
+                }
+            }
+            // the rest of the image data is not needed
+        }
+
+        /**
+         * \brief Returns the Adam7 pass the last thumbnail was made
+         * of: 0 for non-interlaced images, 6 when the whole interlaced
+         * %image was read.
+         */
+        size_t get_pass() const
+        {
+            return m_pass;
+        }
+
+    private:
+        /**
+         * \brief Scales \a width and \a height down to fit the
+         * maximum size, keeping the aspect ratio.
+         */
+        void fit(uint_32& width, uint_32& height) const
+        {
+            if (width <= m_max_width && height <= m_max_height)
+            {
+                return;
+            }
+            double scale = std::min(double(m_max_width) / width,
+                                    double(m_max_height) / height);
+            width = std::max(uint_32(1), uint_32(width * scale + 0.5));
+            height = std::max(uint_32(1), uint_32(height * scale + 0.5));
+            width = std::min(width, m_max_width);
+            height = std::min(height, m_max_height);
+        }
+
+        /**
+         * \brief Maps \a pos out of \a size onto the \a dst_size
+         * pixels of the thumbnail.
+         */
+        static size_t map(size_t pos, size_t size, size_t dst_size)
+        {
+            return size_t(double(pos) * dst_size / size);
+        }
+
+        /**
+         * \brief Prepares the accumulator for a source of \a width by
+         * \a height pixels.
+         */
+        void start(uint_32 width, uint_32 height)
+        {
+            size_t dst_width = m_image->get_width();
+            m_src_width = width;
+            m_src_height = height;
+            m_columns.resize(width);
+            m_column_counts.assign(dst_width, 0);
+            for (size_t x = 0; x < width; ++x)
+            {
+                m_columns[x] = map(x, width, dst_width);
+                ++m_column_counts[m_columns[x]];
+            }
+            m_sums.assign(dst_width * traits::channels, 0);
+            m_row_count = 0;
+        }
+
+        void add_row(component const* row, size_t y)
+        {
+            int const channels = traits::channels;
+            for (size_t x = 0; x < m_src_width; ++x)
+            {
+                double* sum = & m_sums[m_columns[x] * channels];
+                for (int c = 0; c < channels; ++c)
+                {
+                    sum[c] += *row++;
+                }
+            }
+            ++m_row_count;
+
+            size_t dst_height = m_image->get_height();
+            size_t dst_y = map(y, m_src_height, dst_height);
+            if (y + 1 == m_src_height
+                || map(y + 1, m_src_height, dst_height) != dst_y)
+            {
+                emit_row(dst_y);
+            }
+        }
+
+        void emit_row(size_t dst_y)
+        {
+            typedef typename pixel_buffer_type::row_traits row_traits;
+            int const channels = traits::channels;
+            component* out = reinterpret_cast< component* >
+                (row_traits::get_data(m_image->get_row(dst_y)));
+            for (size_t x = 0; x < m_column_counts.size(); ++x)
+            {
+                double count = double(m_column_counts[x]) * m_row_count;
+                for (int c = 0; c < channels; ++c)
+                {
+                    *out++ = component(m_sums[x * channels + c] / count + 0.5);
+                }
+            }
+            std::fill(m_sums.begin(), m_sums.end(), 0);
+            m_row_count = 0;
+        }
+
+        image_type* m_image;
+        uint_32 m_max_width;
+        uint_32 m_max_height;
+        size_t m_pass;
+
+        size_t m_src_width;
+        size_t m_src_height;
+        std::vector< size_t > m_columns;
+        std::vector< size_t > m_column_counts;
+        std::vector< double > m_sums;
+        size_t m_row_count;
+
+#ifdef PNGPP_HAS_STATIC_ASSERT
+        static_assert(traits::bit_depth == 8 || traits::bit_depth == 16,
+            "thumbnail pixels must have 8 or 16 bits per channel");
+#endif
+    };
+
+} // namespace png
+
+#endif // PNGPP_THUMBNAIL_CONSUMER_HPP_INCLUDED
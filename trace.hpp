@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_TRACE_HPP_INCLUDED
+#define PNGPP_TRACE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include "config.hpp"
+#include "types.hpp"
+#include "error.hpp"
+#include "io_stats.hpp"
+
+#ifdef PNGPP_TRACE
+#ifdef PNGPP_HAS_STD_THREAD
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace png
+{
+
+    /**
+     * \brief A file receiving trace events in the Chrome trace event
+     * format, for viewing the decode and encode stages on a timeline
+     * in chrome://tracing or Perfetto.
+     *
+     * Tracing is opt-in: define \c PNGPP_TRACE before including png++
+     * (consistently in every translation unit) and pass a trace_file
+     * to image::set_trace(), or to the set_trace() of a consumer,
+     * generator, reader or writer, along with a name identifying the
+     * %image.  Without the macro the setters do nothing and no code
+     * is generated.
+     *
+     * The following stages are recorded, each with the thread it ran
+     * on and the %image name:
+     *
+     * - \c read and \c write: the whole consumer::read() or
+     *   generator::write()
+     * - \c read_info, \c read_end_info, \c write_info and
+     *   \c write_end_info
+     * - \c pass: every interlace pass (one for plain images)
+     * - \c read_rows and \c compress_rows: batches of rows decoded or
+     *   filtered and deflated, see set_row_batch()
+     * - \c flush: output stream flushes requested by libpng
+     *
+     * One trace_file may be shared by several threads; events are
+     * written under a lock.  The file is complete once the trace_file
+     * is destroyed.
+     */
+    class trace_file
+    {
+    public:
+        /**
+         * \brief Creates the file, throws std_error on failure.
+         */
+        explicit trace_file(std::string const& filename,
+                            size_t row_batch = 64)
+            : m_file(std::fopen(filename.c_str(), "w")),
+              m_row_batch(row_batch ? row_batch : 1),
+              m_events(0)
+        {
+            if (!m_file)
+            {
+                throw std_error(filename);
+            }
+            std::fputs("{\"traceEvents\":[", m_file);
+#ifdef PNGPP_TRACE
+            m_origin = detail::stats_clock();
+#else
+            m_origin = 0;
+#endif
+        }
+
+        ~trace_file()
+        {
+            std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", m_file);
+            std::fclose(m_file);
+        }
+
+        /**
+         * \brief Sets the number of rows recorded as one event.
+         */
+        void set_row_batch(size_t rows)
+        {
+            m_row_batch = rows ? rows : 1;
+        }
+
+        size_t get_row_batch() const
+        {
+            return m_row_batch;
+        }
+
+        /**
+         * \brief Returns the number of events written so far.
+         */
+        size_t get_event_count() const
+        {
+            return m_events;
+        }
+
+        /**
+         * \brief Writes a complete event of the calling thread.  \a
+         * begin and \a end are detail::stats_clock() times; \a pass
+         * and \a row are only written if not negative, \a rows only
+         * if not zero.  Long %image names are cut short.
+         *
+         * Nothing is allocated, so that the destructors recording
+         * events cannot throw, even while unwinding.
+         */
+        void add_event(char const* name, std::string const& image_id,
+                       double begin, double end, long pass = -1,
+                       long row = -1, size_t rows = 0)
+        {
+            char args[max_quoted_id + 96];
+            size_t size = std::sprintf(args, "\"image\":");
+            size += quote(image_id, args + size, max_quoted_id);
+            if (pass >= 0)
+            {
+                size += std::sprintf(args + size, ",\"pass\":%ld", pass);
+            }
+            if (row >= 0)
+            {
+                size += std::sprintf(args + size, ",\"row\":%ld", row);
+            }
+            if (rows != 0)
+            {
+                std::sprintf(args + size, ",\"rows\":%lu",
+                             (unsigned long) rows);
+            }
+
+#if defined(PNGPP_TRACE) && defined(PNGPP_HAS_STD_THREAD)
+            std::lock_guard< std::mutex > lock(m_mutex);
+#endif
+            std::fprintf(m_file, "%s\n{\"name\":\"%s\",\"cat\":\"png\","
+                         "\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                         "\"pid\":1,\"tid\":%lu,\"args\":{%s}}",
+                         m_events ? "," : "", name,
+                         (begin - m_origin) * 1e6, (end - begin) * 1e6,
+                         thread_id(), args);
+            ++m_events;
+        }
+
+    private:
+        trace_file(trace_file const&);
+        trace_file& operator=(trace_file const&);
+
+        static const size_t max_quoted_id = 256;
+
+        /**
+         * \brief Writes \a value as a JSON string of at most \a
+         * capacity bytes, including the terminating NUL, to \a out.
+         * Returns its length.
+         */
+        static size_t quote(std::string const& value, char* out,
+                            size_t capacity)
+        {
+            size_t size = 0;
+            out[size++] = '"';
+            // leaves room for the longest escape, the quote and the NUL
+            for (size_t i = 0; i < value.size() && size + 8 <= capacity; ++i)
+            {
+                char c = value[i];
+                if (c == '"' || c == '\\')
+                {
+                    out[size++] = '\\';
+                    out[size++] = c;
+                }
+                else if (static_cast< unsigned char >(c) < 0x20)
+                {
+                    size += std::sprintf(out + size, "\\u%04x", c);
+                }
+                else
+                {
+                    out[size++] = c;
+                }
+            }
+            out[size++] = '"';
+            out[size] = '\0';
+            return size;
+        }
+
+        static unsigned long thread_id()
+        {
+#if defined(PNGPP_TRACE) && defined(__linux__)
+            return (unsigned long) syscall(SYS_gettid);
+#elif defined(PNGPP_TRACE) && defined(PNGPP_HAS_STD_THREAD)
+            return (unsigned long) std::hash< std::thread::id >()
+                (std::this_thread::get_id());
+#else
+            return 0;
+#endif
+        }
+
+        std::FILE* m_file;
+        size_t m_row_batch;
+        size_t m_events;
+        double m_origin;
+#if defined(PNGPP_TRACE) && defined(PNGPP_HAS_STD_THREAD)
+        std::mutex m_mutex;
+#endif
+    };
+
+    /**
+     * \brief Holds the trace_file to write to and the name of the
+     * %image, if tracing is enabled; an empty class otherwise.
+     */
+    class trace_holder
+    {
+    public:
+#ifdef PNGPP_TRACE
+        trace_holder()
+            : m_trace(0)
+        {
+        }
+
+        void set_trace(trace_file* trace,
+                       std::string const& image_id = std::string())
+        {
+            m_trace = trace;
+            m_trace_id = image_id;
+        }
+
+        trace_file* get_trace() const
+        {
+            return m_trace;
+        }
+
+        std::string const& get_trace_id() const
+        {
+            return m_trace_id;
+        }
+
+    private:
+        trace_file* m_trace;
+        std::string m_trace_id;
+#else
+        void set_trace(trace_file* /*trace*/,
+                       std::string const& /*image_id*/ = std::string())
+        {
+        }
+
+        trace_file* get_trace() const
+        {
+            return 0;
+        }
+
+        std::string get_trace_id() const
+        {
+            return std::string();
+        }
+#endif
+    };
+
+    namespace detail
+    {
+
+#ifdef PNGPP_TRACE
+        inline double trace_begin(trace_holder const& holder)
+        {
+            return holder.get_trace() ? stats_clock() : 0;
+        }
+
+        /**
+         * \brief Records an event begun at trace_begin().  Plain
+         * functions, so that they are safe to use where libpng may
+         * longjmp().
+         */
+        inline void trace_end(trace_holder const& holder, char const* name,
+                              double begin)
+        {
+            if (holder.get_trace())
+            {
+                holder.get_trace()->add_event(name, holder.get_trace_id(),
+                                              begin, stats_clock());
+            }
+        }
+#endif
+
+        /**
+         * \brief Records an event lasting until it goes out of
+         * scope.  Must not be used where libpng may longjmp().
+         */
+        class trace_scope
+        {
+        public:
+#ifdef PNGPP_TRACE
+            trace_scope(trace_holder const& holder, char const* name,
+                        long pass = -1)
+                : m_holder(holder),
+                  m_name(name),
+                  m_pass(pass),
+                  m_begin(trace_begin(holder))
+            {
+            }
+
+            ~trace_scope()
+            {
+                if (m_holder.get_trace())
+                {
+                    m_holder.get_trace()->add_event(m_name,
+                                                    m_holder.get_trace_id(),
+                                                    m_begin, stats_clock(),
+                                                    m_pass);
+                }
+            }
+
+        private:
+            trace_scope(trace_scope const&);
+            trace_scope& operator=(trace_scope const&);
+
+            trace_holder const& m_holder;
+            char const* m_name;
+            long m_pass;
+            double m_begin;
+#else
+            trace_scope(trace_holder const& /*holder*/, char const* /*name*/,
+                        long /*pass*/ = -1)
+            {
+            }
+#endif
+        };
+
+        /**
+         * \brief Records the rows of a pass in batches of
+         * trace_file::get_row_batch() rows.  Call row_done() after
+         * every row; a batch lasts from the end of the previous one
+         * and the last, partial batch is recorded when the object
+         * goes out of scope.
+         */
+        class trace_rows
+        {
+        public:
+#ifdef PNGPP_TRACE
+            trace_rows(trace_holder const& holder, char const* name,
+                       size_t pass)
+                : m_holder(holder),
+                  m_name(name),
+                  m_pass(long(pass)),
+                  m_first(0),
+                  m_count(0),
+                  m_begin(trace_begin(holder))
+            {
+            }
+
+            ~trace_rows()
+            {
+                flush();
+            }
+
+            void row_done(uint_32 pos)
+            {
+                trace_file* trace = m_holder.get_trace();
+                if (!trace)
+                {
+                    return;
+                }
+                if (m_count == 0)
+                {
+                    m_first = pos;
+                }
+                if (++m_count == trace->get_row_batch())
+                {
+                    flush();
+                }
+            }
+
+        private:
+            trace_rows(trace_rows const&);
+            trace_rows& operator=(trace_rows const&);
+
+            void flush()
+            {
+                if (m_count == 0)
+                {
+                    return;
+                }
+                double end = stats_clock();
+                m_holder.get_trace()->add_event(m_name, m_holder.get_trace_id(),
+                                                m_begin, end, m_pass,
+                                                long(m_first), m_count);
+                m_begin = end;
+                m_count = 0;
+            }
+
+            trace_holder const& m_holder;
+            char const* m_name;
+            long m_pass;
+            uint_32 m_first;
+            size_t m_count;
+            double m_begin;
+#else
+            trace_rows(trace_holder const& /*holder*/, char const* /*name*/,
+                       size_t /*pass*/)
+            {
+            }
+
+            void row_done(uint_32 /*pos*/)
+            {
+            }
+#endif
+        };
+
+    } // namespace detail
+
+} // namespace png
+
+#endif // PNGPP_TRACE_HPP_INCLUDED
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_TRANSCODE_HPP_INCLUDED
+#define PNGPP_TRANSCODE_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "error.hpp"
+#include "reader.hpp"
+#include "writer.hpp"
+#include "write_options.hpp"
+#include "convert_color_space.hpp"
+
+#ifdef PNGPP_HAS_STD_THREAD
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace png
+{
+
+    namespace detail
+    {
+
+        /**
+         * \brief The io transformation which leaves the pixel format
+         * as it is.
+         */
+        struct transcode_identity
+        {
+            void operator()(io_base&) const {}
+        };
+
+        /**
+         * \brief A fixed number of rows passed from the decoding to
+         * the encoding side.
+         *
+         * With std::thread available, the rows are decoded by a
+         * worker thread while the calling thread compresses them.
+         * The decoder may run up to row_count rows ahead.
+         */
+        template< class istream >
+        class row_ring
+        {
+        public:
+            enum { row_count = 16 };
+
+            row_ring(reader< istream >& rd, size_t row_size, size_t height)
+                : m_reader(& rd),
+                  m_rows(row_count, std::vector< byte >(row_size + 1)),
+                  m_height(height),
+                  m_decoded(0),
+                  m_encoded(0),
+                  m_stop(false),
+                  m_failed(false)
+            {
+            }
+
+#ifdef PNGPP_HAS_STD_THREAD
+            /**
+             * \brief Decodes all rows; runs on the worker thread.
+             */
+            void decode()
+            {
+                try
+                {
+                    for (size_t pos = 0; pos < m_height; ++pos)
+                    {
+                        {
+                            std::unique_lock< std::mutex > lock(m_mutex);
+                            while (!m_stop && pos - m_encoded >= row_count)
+                            {
+                                m_cond.wait(lock);
+                            }
+                            if (m_stop)
+                            {
+                                return;
+                            }
+                        }
+                        m_reader->read_row(& m_rows[pos % row_count][0]);
+                        std::lock_guard< std::mutex > lock(m_mutex);
+                        ++m_decoded;
+                        m_cond.notify_all();
+                    }
+                }
+                catch (std::exception const& ex)
+                {
+                    std::lock_guard< std::mutex > lock(m_mutex);
+                    m_error = ex.what();
+                    m_failed = true;
+                    m_cond.notify_all();
+                }
+            }
+
+            /**
+             * \brief Waits for the row \a pos to be decoded.
+             */
+            byte* get_row(size_t pos)
+            {
+                std::unique_lock< std::mutex > lock(m_mutex);
+                while (!m_failed && m_decoded <= pos)
+                {
+                    m_cond.wait(lock);
+                }
+                if (m_failed)
+                {
+                    throw error(m_error);
+                }
+                return & m_rows[pos % row_count][0];
+            }
+
+            /**
+             * \brief Gives the slot of the encoded row back to the
+             * decoder.
+             */
+            void release_row()
+            {
+                std::lock_guard< std::mutex > lock(m_mutex);
+                ++m_encoded;
+                m_cond.notify_all();
+            }
+
+            /**
+             * \brief Makes the decoder return early.
+             */
+            void stop()
+            {
+                std::lock_guard< std::mutex > lock(m_mutex);
+                m_stop = true;
+                m_cond.notify_all();
+            }
+#else
+            byte* get_row(size_t pos)
+            {
+                byte* row = & m_rows[pos % row_count][0];
+                m_reader->read_row(row);
+                return row;
+            }
+
+            void release_row()
+            {
+            }
+#endif
+
+        private:
+            reader< istream >* m_reader;
+            std::vector< std::vector< byte > > m_rows;
+            size_t m_height;
+            size_t m_decoded;
+            size_t m_encoded;
+            bool m_stop;
+            bool m_failed;
+            std::string m_error;
+#ifdef PNGPP_HAS_STD_THREAD
+            std::mutex m_mutex;
+            std::condition_variable m_cond;
+#endif
+        };
+
+        template< class istream, class ostream >
+        void transcode_rows(reader< istream >& rd, writer< ostream >& wr,
+                            size_t row_size)
+        {
+            size_t height = rd.get_height();
+            row_ring< istream > ring(rd, row_size, height);
+#ifdef PNGPP_HAS_STD_THREAD
+            std::thread decoder(& row_ring< istream >::decode, & ring);
+            try
+            {
+#endif
+                for (size_t pos = 0; pos < height; ++pos)
+                {
+                    wr.write_row(ring.get_row(pos));
+                    ring.release_row();
+                }
+#ifdef PNGPP_HAS_STD_THREAD
+            }
+            catch (...)
+            {
+                ring.stop();
+                decoder.join();
+                throw;
+            }
+            decoder.join();
+#endif
+        }
+
+        /**
+         * \brief Reads all passes of an interlaced image into memory
+         * and writes them out again.
+         */
+        template< class istream, class ostream >
+        void transcode_interlaced(reader< istream >& rd, size_t rd_passes,
+                                  writer< ostream >& wr, size_t row_size)
+        {
+            std::vector< std::vector< byte > >
+                rows(rd.get_height(), std::vector< byte >(row_size + 1));
+            for (size_t pass = 0; pass < rd_passes; ++pass)
+            {
+                for (size_t pos = 0; pos < rows.size(); ++pos)
+                {
+                    rd.read_row(& rows[pos][0]);
+                }
+            }
+            size_t wr_passes = 1;
+#ifdef PNG_WRITE_INTERLACING_SUPPORTED
+            wr_passes = wr.set_interlace_handling();
+#else
+            throw error("Cannot write interlaced image: interlace handling disabled.");
+#endif
+            for (size_t pass = 0; pass < wr_passes; ++pass)
+            {
+                for (size_t pos = 0; pos < rows.size(); ++pos)
+                {
+                    wr.write_row(& rows[pos][0]);
+                }
+            }
+        }
+
+        template< class istream, class ostream, class transformation >
+        void transcode(istream& in, ostream& out,
+                       transformation const& transform,
+                       write_options const& options)
+        {
+            reader< istream > rd(in);
+            rd.read_info();
+            color_type src_color_type = rd.get_color_type();
+            int src_bit_depth = rd.get_bit_depth();
+            transform(rd);
+
+            size_t pass_count = 1;
+            if (rd.get_interlace_type() != interlace_none)
+            {
+#ifdef PNG_READ_INTERLACING_SUPPORTED
+                pass_count = rd.set_interlace_handling();
+#else
+                throw error("Cannot read interlaced image: interlace handling disabled.");
+#endif
+            }
+            // 16-bit rows are kept in host byte order in between, as
+            // consumer and generator do: the 8 to 16 bit expansion
+            // of convert_color_space relies on that
+#if __BYTE_ORDER == __LITTLE_ENDIAN && defined(PNG_READ_SWAP_SUPPORTED) \
+    && defined(PNG_WRITE_SWAP_SUPPORTED)
+            bool swap = true;
+            rd.set_swap();
+#else
+            bool swap = false;
+#endif
+            rd.update_info();
+            size_t row_size = png_get_rowbytes(rd.get_png_struct(),
+                                               rd.get_info().get_png_info());
+
+            writer< ostream > wr(out);
+            wr.set_image_info(rd.get_image_info());
+            wr.set_options(options);
+#ifdef PNG_tRNS_SUPPORTED
+            // image_info only holds the palette transparency; keep the
+            // transparent color of unconverted gray and RGB images
+            if (src_color_type != color_type_palette
+                && src_color_type == rd.get_color_type()
+                && src_bit_depth == rd.get_bit_depth()
+                && rd.has_chunk(chunk_tRNS))
+            {
+                png_color_16* trans_color = 0;
+                png_get_tRNS(rd.get_png_struct(), rd.get_info().get_png_info(),
+                             0, 0, & trans_color);
+                // tRNS is checked against the bit depth in IHDR
+                png_info* info = wr.get_info().get_png_info();
+                png_set_IHDR(wr.get_png_struct(), info,
+                             rd.get_width(), rd.get_height(),
+                             rd.get_bit_depth(), rd.get_color_type(),
+                             rd.get_interlace_type(),
+                             rd.get_compression_type(), rd.get_filter_type());
+                png_set_tRNS(wr.get_png_struct(), info, 0, 0, trans_color);
+            }
+#endif
+            wr.write_info();
+            if (swap && rd.get_bit_depth() == 16)
+            {
+                wr.set_swap();
+            }
+
+            if (pass_count > 1)
+            {
+                transcode_interlaced(rd, pass_count, wr, row_size);
+            }
+            else
+            {
+                transcode_rows(rd, wr, row_size);
+            }
+
+            rd.read_end_info();
+            wr.write_end_info();
+        }
+
+    } // namespace detail
+
+    /**
+     * \brief Recompresses a PNG image read from \a in and writes it
+     * to \a out, keeping the pixel format.
+     *
+     * Only a few rows are held in memory at a time, so images of any
+     * size can be transcoded.  With std::thread available, decoding
+     * runs on a separate thread, overlapped with compression.
+     * Interlaced images are the exception: they are read into memory
+     * as a whole, and written interlaced again.
+     *
+     * \see write_options
+     */
+    template< class istream, class ostream >
+    void transcode(istream& in, ostream& out,
+                   write_options const& options = write_options())
+    {
+        detail::transcode(in, out, detail::transcode_identity(), options);
+    }
+
+    /**
+     * \brief Recompresses a PNG image, converting it to the format of
+     * the \c pixel type on the way.
+     *
+     * Call it as <tt>png::transcode< png::rgb_pixel >(in, out)</tt>.
+     *
+     * \see convert_color_space
+     */
+    template< typename pixel, class istream, class ostream >
+    void transcode(istream& in, ostream& out,
+                   write_options const& options = write_options())
+    {
+        detail::transcode(in, out, convert_color_space< pixel >(), options);
+    }
+
+} // namespace png
+
+#endif // PNGPP_TRANSCODE_HPP_INCLUDED
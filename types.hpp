@@ -32,6 +32,7 @@
 #define PNGPP_TYPES_HPP_INCLUDED
 
 #include <png.h>
+#include <zlib.h>
 
 namespace png
 {
@@ -95,6 +96,50 @@ namespace png
         filter_type_default     = PNG_FILTER_TYPE_DEFAULT
     };
 
+    /**
+     * \brief Row filters the writer may choose from.  The values are
+     * bit flags and may be combined.
+     */
+    enum filter_mask
+    {
+        filter_none  = PNG_FILTER_NONE,
+        filter_sub   = PNG_FILTER_SUB,
+        filter_up    = PNG_FILTER_UP,
+        filter_avg   = PNG_FILTER_AVG,
+        filter_paeth = PNG_FILTER_PAETH,
+        filter_all   = PNG_ALL_FILTERS
+    };
+
+    enum compression_strategy
+    {
+        compression_strategy_default      = Z_DEFAULT_STRATEGY,
+        compression_strategy_filtered     = Z_FILTERED,
+        compression_strategy_huffman_only = Z_HUFFMAN_ONLY,
+        compression_strategy_rle          = Z_RLE
+    };
+
+    /**
+     * \brief Presets of write_options trading file size for speed.
+     *
+     * \see write_options::write_options(write_mode)
+     */
+    enum write_mode
+    {
+        write_mode_default,     ///< libpng defaults
+        write_mode_realtime,    ///< stored deflate, no filtering
+        write_mode_realtime_rle ///< RLE deflate with the Up filter
+    };
+
+    enum crc_action
+    {
+        crc_default      = PNG_CRC_DEFAULT,
+        crc_error_quit   = PNG_CRC_ERROR_QUIT,
+        crc_warn_discard = PNG_CRC_WARN_DISCARD,
+        crc_warn_use     = PNG_CRC_WARN_USE,
+        crc_quiet_use    = PNG_CRC_QUIET_USE,
+        crc_no_change    = PNG_CRC_NO_CHANGE
+    };
+
     enum chunk
     {
         chunk_gAMA = PNG_INFO_gAMA,
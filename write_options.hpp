@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2007,2008   Alex Shulgin
+ *
+ * This file is part of png++ the C++ wrapper for libpng.  PNG++ is free
+ * software; the exact copying conditions are as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PNGPP_WRITE_OPTIONS_HPP_INCLUDED
+#define PNGPP_WRITE_OPTIONS_HPP_INCLUDED
+
+#include <cstddef>
+#include "types.hpp"
+
+namespace png
+{
+
+    /**
+     * \brief Compression settings for writing PNG images.
+     *
+     * Settings which were not set explicitly are left at the libpng
+     * defaults.
+     *
+     * \see writer::set_options(), transcode()
+     */
+    class write_options
+    {
+    public:
+        write_options()
+            : m_compression_level(-1),
+              m_compression_strategy(compression_strategy_default),
+              m_has_compression_strategy(false),
+              m_filter(-1),
+              m_compression_buffer_size(0),
+              m_skip_flush(false)
+        {
+        }
+
+        /**
+         * \brief Constructs the settings of a write_mode preset.
+         *
+         * write_mode_realtime stores the pixel data without filtering
+         * or compressing it, which keeps encoding close to memcpy
+         * speed (e.g. for dumping video frames); the files are as
+         * large as the raw pixels.  write_mode_realtime_rle filters
+         * with Up and compresses runs only, which is several times
+         * slower but shrinks flat content such as screen captures
+         * considerably.  Both write IDAT chunks of 1 MiB and skip
+         * flushing the stream.
+         */
+        write_options(write_mode mode)
+            : m_compression_level(-1),
+              m_compression_strategy(compression_strategy_default),
+              m_has_compression_strategy(false),
+              m_filter(-1),
+              m_compression_buffer_size(0),
+              m_skip_flush(false)
+        {
+            switch (mode)
+            {
+            case write_mode_default:
+                break;
+            case write_mode_realtime:
+                set_compression_level(0);
+                set_filter(filter_none);
+                set_compression_buffer_size(1 << 20);
+                set_skip_flush(true);
+                break;
+            case write_mode_realtime_rle:
+                set_compression_level(1);
+                set_compression_strategy(compression_strategy_rle);
+                set_filter(filter_up);
+                set_compression_buffer_size(1 << 20);
+                set_skip_flush(true);
+                break;
+            }
+        }
+
+        /**
+         * \brief Returns the zlib compression level, or -1 if it was
+         * not set.
+         */
+        int get_compression_level() const
+        {
+            return m_compression_level;
+        }
+
+        void set_compression_level(int level)
+        {
+            m_compression_level = level;
+        }
+
+        bool has_compression_strategy() const
+        {
+            return m_has_compression_strategy;
+        }
+
+        compression_strategy get_compression_strategy() const
+        {
+            return m_compression_strategy;
+        }
+
+        void set_compression_strategy(compression_strategy strategy)
+        {
+            m_compression_strategy = strategy;
+            m_has_compression_strategy = true;
+        }
+
+        /**
+         * \brief Returns the row filters (a combination of
+         * filter_mask values), or -1 if they were not set.
+         */
+        int get_filter() const
+        {
+            return m_filter;
+        }
+
+        void set_filter(int filters)
+        {
+            m_filter = filters;
+        }
+
+        /**
+         * \brief Returns the compression buffer size, or 0 if it was
+         * not set.
+         */
+        size_t get_compression_buffer_size() const
+        {
+            return m_compression_buffer_size;
+        }
+
+        void set_compression_buffer_size(size_t size)
+        {
+            m_compression_buffer_size = size;
+        }
+
+        /**
+         * \brief Returns whether the writer leaves flushing the
+         * stream to the caller.
+         */
+        bool get_skip_flush() const
+        {
+            return m_skip_flush;
+        }
+
+        void set_skip_flush(bool skip)
+        {
+            m_skip_flush = skip;
+        }
+
+    protected:
+        int m_compression_level;
+        compression_strategy m_compression_strategy;
+        bool m_has_compression_strategy;
+        int m_filter;
+        size_t m_compression_buffer_size;
+        bool m_skip_flush;
+    };
+
+} // namespace png
+
+#endif // PNGPP_WRITE_OPTIONS_HPP_INCLUDED
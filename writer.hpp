@@ -33,6 +33,7 @@
 
 #include <cassert>
 #include "io_base.hpp"
+#include "write_options.hpp"
 
 namespace png
 {
@@ -107,7 +108,13 @@ namespace png
             {
                 throw error(m_error);
             }
+#ifdef PNGPP_TRACE
+            double begin = detail::trace_begin(*this);
+#endif
             m_info.write();
+#ifdef PNGPP_TRACE
+            detail::trace_end(*this, "write_info", begin);
+#endif
         }
 
         /**
@@ -119,7 +126,13 @@ namespace png
             {
                 throw error(m_error);
             }
+#ifdef PNGPP_IO_STATS
+            detail::stats_mark mark = detail::stats_begin(get_io_stats());
+#endif
             png_write_row(m_png, bytes);
+#ifdef PNGPP_IO_STATS
+            detail::stats_end(get_io_stats(), mark, detail::stats_libpng);
+#endif
         }
 
         /**
@@ -131,7 +144,80 @@ namespace png
             {
                 throw error(m_error);
             }
+#ifdef PNGPP_TRACE
+            double begin = detail::trace_begin(*this);
+#endif
             m_end_info.write();
+#ifdef PNGPP_TRACE
+            detail::trace_end(*this, "write_end_info", begin);
+#endif
+        }
+
+        /**
+         * \brief Sets the row filters to choose from (a combination
+         * of filter_mask values).  A single filter avoids the
+         * per-row filter selection heuristic.
+         */
+        void set_filter(int filters) const
+        {
+            png_set_filter(m_png, filter_type_base, filters);
+        }
+
+        /**
+         * \brief Sets the zlib compression level, 0 (store) to 9 (best).
+         */
+        void set_compression_level(int level) const
+        {
+            png_set_compression_level(m_png, level);
+        }
+
+        void set_compression_strategy(compression_strategy strategy) const
+        {
+            png_set_compression_strategy(m_png, strategy);
+        }
+
+        /**
+         * \brief Sets the size of the buffer to compress into, which
+         * is also the size of the IDAT chunks written.
+         */
+        void set_compression_buffer_size(size_t size) const
+        {
+            png_set_compression_buffer_size(m_png, size);
+        }
+
+        /**
+         * \brief Makes libpng's flush requests no-ops, leaving it to
+         * the caller to flush the stream when it sees fit.
+         */
+        void set_skip_flush(bool skip) const
+        {
+            png_set_write_fn(m_png, png_get_io_ptr(m_png), write_data,
+                             skip ? skip_flush_data : flush_data);
+        }
+
+        /**
+         * \brief Applies the settings made in \a options, leaving the
+         * rest at their defaults.  Must be called before writing rows.
+         */
+        void set_options(write_options const& options) const
+        {
+            if (options.get_compression_level() >= 0)
+            {
+                set_compression_level(options.get_compression_level());
+            }
+            if (options.has_compression_strategy())
+            {
+                set_compression_strategy(options.get_compression_strategy());
+            }
+            if (options.get_filter() >= 0)
+            {
+                set_filter(options.get_filter());
+            }
+            if (options.get_compression_buffer_size() > 0)
+            {
+                set_compression_buffer_size(options.get_compression_buffer_size());
+            }
+            set_skip_flush(options.get_skip_flush());
         }
 
     private:
@@ -141,23 +227,31 @@ namespace png
             writer* wr = static_cast< writer* >(io);
             wr->reset_error();
             ostream* stream = reinterpret_cast< ostream* >(png_get_io_ptr(png));
+#ifdef PNGPP_IO_STATS
+            detail::stats_mark mark = detail::stats_begin(wr->get_io_stats());
+#endif
             try
             {
                 stream->write(reinterpret_cast< char* >(data), length);
                 if (!stream->good())
                 {
-                    wr->set_error("ostream::write() failed");
+                    wr->set_error("ostream::write() failed", error_stream);
                 }
             }
             catch (std::exception const& error)
             {
-                wr->set_error(error.what());
+                wr->set_error(error.what(), error_stream);
             }
             catch (...)
             {
                 assert(!"caught something wrong");
-                wr->set_error("write_data: caught something wrong");
+                wr->set_error("write_data: caught something wrong",
+                              error_stream);
             }
+#ifdef PNGPP_IO_STATS
+            detail::stats_end(wr->get_io_stats(), mark, detail::stats_io,
+                              length);
+#endif
             if (wr->is_error())
             {
                 wr->raise_error();
@@ -170,28 +264,39 @@ namespace png
             writer* wr = static_cast< writer* >(io);
             wr->reset_error();
             ostream* stream = reinterpret_cast< ostream* >(png_get_io_ptr(png));
+#ifdef PNGPP_TRACE
+            double begin = detail::trace_begin(*wr);
+#endif
             try
             {
                 stream->flush();
                 if (!stream->good())
                 {
-                    wr->set_error("ostream::flush() failed");
+                    wr->set_error("ostream::flush() failed", error_stream);
                 }
             }
             catch (std::exception const& error)
             {
-                wr->set_error(error.what());
+                wr->set_error(error.what(), error_stream);
             }
             catch (...)
             {
                 assert(!"caught something wrong");
-                wr->set_error("flush_data: caught something wrong");
+                wr->set_error("flush_data: caught something wrong",
+                              error_stream);
             }
+#ifdef PNGPP_TRACE
+            detail::trace_end(*wr, "flush", begin);
+#endif
             if (wr->is_error())
             {
                 wr->raise_error();
             }
         }
+
+        static void skip_flush_data(png_struct*)
+        {
+        }
     };
 
 } // namespace png